@@ -1,2 +1,2 @@
-g++ -std=c++20 -I./include -L./lib -fcompare-debug-second src/stratosml/tests/main.cpp -o tests  -larmadillo -lblas -llapack -lstratosml
+g++ -std=c++20 -I./include -L./lib -fcompare-debug-second -pthread src/stratosml/tests/main.cpp -o tests  -larmadillo -lblas -llapack -lstratosml
 ./tests
\ No newline at end of file
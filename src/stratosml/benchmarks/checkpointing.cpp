@@ -0,0 +1,70 @@
+#include <stratosml/core.hpp>
+#include <armadillo>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace stratos;
+using namespace std;
+using namespace stratos::autodiff;
+using namespace stratos::layers;
+
+/*
+ * Activation checkpointing: memory / time trade-off on a deep stack of Dense layers.
+ *
+ * Every configuration runs in its own child process, so the peak resident set
+ * size it reports belongs to that configuration only.
+ */
+
+const size_t depth = 32;
+const size_t width = 256;
+const size_t rows = 2048;
+const size_t epochs = 3;
+
+void Run(size_t every) {
+    arma::arma_rng::set_seed(42);
+
+    constant x = Tensor<float>(arma::Mat<float>(rows, width, arma::fill::randn));
+    constant y = Tensor<float>(arma::Mat<float>(rows, 1, arma::fill::randn));
+
+    Model model;
+
+    for (size_t i = 0; i < depth; ++i) {
+        model.Add(new Dense(i + 1 < depth ? width : 1));
+    }
+
+    model.Checkpoint(every);
+
+    // Keep the epoch logs out of the report
+    streambuf* out = cout.rdbuf(nullptr);
+
+    auto start = chrono::high_resolution_clock::now();
+    model.Fit(x, y, epochs);
+    chrono::duration<double> time = chrono::high_resolution_clock::now() - start;
+
+    cout.rdbuf(out);
+
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    cout << left << setw(20) << (every ? "every " + to_string(every) + " layers" : "off")
+         << setw(16) << fixed << setprecision(3) << time.count() / epochs
+         << usage.ru_maxrss / 1024 << " MB" << endl;
+}
+
+int main() {
+
+    cout << depth << " Dense(" << width << ") layers, " << rows << " rows\n\n";
+    cout << left << setw(20) << "checkpoint" << setw(16) << "s / epoch" << "peak RSS" << endl;
+
+    for (size_t every : { 0, 2, 4, 6, 8 }) {
+        pid_t pid = fork();
+
+        if (pid == 0) {
+            Run(every);
+            return 0;
+        }
+
+        waitpid(pid, nullptr, 0);
+    }
+}
@@ -0,0 +1,114 @@
+#include <stratosml/core.hpp>
+#include <armadillo>
+
+using namespace stratos;
+using namespace std;
+using namespace stratos::autodiff;
+
+/*
+ * Convolution: im2col + GEMM and the direct small-kernel path against a naive
+ * loop over samples, filters, output pixels, channels and kernel taps.
+ *
+ * Forward times are compared with the naive loop, which also checks the
+ * outputs. Training times include the backward pass of the node.
+ */
+
+const size_t repeats = 5;
+
+struct Config {
+    string name;
+    size_t rows, channels, height, width, filters, kernel_h, kernel_w;
+    Layout layout;
+};
+
+arma::Mat<float> Naive(const arma::Mat<float>& x, const arma::Mat<float>& w, const arma::Mat<float>& b, const ConvGeometry& g) {
+    arma::Mat<float> out(x.n_rows, g.output_size());
+
+    for (size_t r = 0; r < x.n_rows; ++r)
+        for (size_t f = 0; f < g.filters; ++f)
+            for (size_t oh = 0; oh < g.out_h; ++oh)
+                for (size_t ow = 0; ow < g.out_w; ++ow) {
+                    float sum = b(f);
+
+                    for (size_t c = 0; c < g.channels; ++c)
+                        for (size_t i = 0; i < g.kernel_h; ++i)
+                            for (size_t j = 0; j < g.kernel_w; ++j) {
+                                size_t column;
+                                if (g.source(c, oh, ow, i, j, column))
+                                    sum += w((c * g.kernel_h + i) * g.kernel_w + j, f) * x(r, column);
+                            }
+
+                    out(r, g.output_column(f, oh * g.out_w + ow)) = sum;
+                }
+
+    return out;
+}
+
+template<typename F>
+double Time(F&& run) {
+    auto start = chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < repeats; ++i) run();
+    chrono::duration<double, milli> time = chrono::high_resolution_clock::now() - start;
+    return time.count() / repeats;
+}
+
+int main() {
+
+    arma::arma_rng::set_seed(42);
+
+    const vector<Config> configs = {
+        { "2D 3x3 NCHW", 64, 16, 32, 32, 32, 3, 3, Layout::NCHW },
+        { "2D 3x3 NHWC", 64, 16, 32, 32, 32, 3, 3, Layout::NHWC },
+        { "2D 5x5 NCHW", 64, 8, 28, 28, 16, 5, 5, Layout::NCHW },
+        { "1D 3 NCHW", 256, 8, 1, 1024, 16, 1, 3, Layout::NCHW },
+        { "1D 9 NHWC", 256, 8, 1, 1024, 16, 1, 9, Layout::NHWC },
+    };
+
+    static const Linear linear;
+
+    cout << left << setw(14) << "config" << setw(12) << "naive ms" << setw(12) << "im2col ms" << setw(12) << "direct ms"
+         << setw(16) << "im2col train" << setw(16) << "direct train" << "max error" << endl;
+
+    for (const Config& config : configs) {
+        ConvGeometry g;
+        g.channels = config.channels;
+        g.height = config.height;
+        g.width = config.width;
+        g.filters = config.filters;
+        g.kernel_h = config.kernel_h;
+        g.kernel_w = config.kernel_w;
+        g.out_h = config.height - config.kernel_h + 1;
+        g.out_w = config.width - config.kernel_w + 1;
+        g.layout = config.layout;
+
+        constant x = Tensor<float>(arma::Mat<float>(config.rows, g.input_size(), arma::fill::randn));
+        var kernel = Tensor<float>(arma::Mat<float>(g.channels * g.taps(), g.filters, arma::fill::randn));
+        var bias = Tensor<float>(arma::Mat<float>(g.filters, 1, arma::fill::randn));
+
+        arma::Mat<float> expected;
+        const double naive = Time([&] { expected = Naive(x->val.value, kernel->val.value, bias->val.value, g); });
+
+        float error = 0;
+        auto forward = [&](ConvAlgorithm algorithm) {
+            NodePtr<float> out = conv(x.expr, kernel.expr, bias.expr, g, &linear, algorithm);
+            error = max(error, arma::abs(out->val.value - expected).max());
+        };
+
+        auto train = [&](ConvAlgorithm algorithm) {
+            NodePtr<float> out = conv(x.expr, kernel.expr, bias.expr, g, &linear, algorithm);
+            out->derive(Tensor<float>(arma::Mat<float>(arma::size(out->val.value), arma::fill::ones)));
+            kernel->grad.value.zeros();
+            bias->grad.value.zeros();
+        };
+
+        const double im2col = Time([&] { forward(ConvAlgorithm::Im2col); });
+        const double direct = Time([&] { forward(ConvAlgorithm::Direct); });
+        const double im2col_train = Time([&] { train(ConvAlgorithm::Im2col); });
+        const double direct_train = Time([&] { train(ConvAlgorithm::Direct); });
+
+        cout << setw(14) << config.name << fixed << setprecision(2)
+             << setw(12) << naive << setw(12) << im2col << setw(12) << direct
+             << setw(16) << im2col_train << setw(16) << direct_train
+             << scientific << setprecision(1) << error << endl;
+    }
+}
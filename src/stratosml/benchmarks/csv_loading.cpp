@@ -0,0 +1,91 @@
+#include <stratosml/core.hpp>
+#include <armadillo>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+using namespace stratos;
+using namespace std;
+using namespace stratos::data;
+
+/*
+ * CSV loading: the getline / stringstream / stof stream parser against the
+ * memory mapped from_chars parser on one thread and on every core, and the
+ * same frame saved to the binary columnar format and mapped back.
+ *
+ * A random numeric CSV is written to a temporary file first, the first run
+ * of each loader warms the page cache. Both results are compared cell by cell.
+ */
+
+const size_t repeats = 3;
+
+template<typename F>
+double Time(F&& run) {
+    run();
+    auto start = chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < repeats; ++i) run();
+    chrono::duration<double, milli> time = chrono::high_resolution_clock::now() - start;
+    return time.count() / repeats;
+}
+
+int main(int argc, char** argv) {
+
+    const size_t rows = argc > 1 ? stoul(argv[1]) : 1000000;
+    const size_t cols = argc > 2 ? stoul(argv[2]) : 16;
+    const string filename = "csv_loading_benchmark.csv";
+    const string binary_filename = "csv_loading_benchmark.stratos";
+
+    arma::arma_rng::set_seed(42);
+    const arma::Mat<float> values(rows, cols, arma::fill::randn);
+
+    {
+        ofstream out(filename);
+        for (size_t c = 0; c < cols; ++c) out << "x" << c << (c + 1 < cols ? "," : "\n");
+
+        out << setprecision(7);
+        for (size_t r = 0; r < rows; ++r)
+            for (size_t c = 0; c < cols; ++c) out << values(r, c) << (c + 1 < cols ? "," : "\n");
+    }
+
+    const double megabytes = filesystem::file_size(filename) / 1e6;
+
+    DataFrame legacy, mapped;
+
+    const double stream_ms = Time([&] {
+        legacy = DataFrame();
+        fstream f(filename, fstream::in);
+        LoadCSV(f, legacy);
+    });
+
+    const double single_ms = Time([&] { mapped = DataFrame(); LoadCSV(filename, mapped, 1); });
+    const double parallel_ms = Time([&] { mapped = DataFrame(); LoadCSV(filename, mapped); });
+
+    SaveBinary(binary_filename, mapped);
+
+    DataFrame binary;
+    const double binary_ms = Time([&] { binary = DataFrame(); LoadBinary(binary_filename, binary); });
+
+    float error = 0;
+    for (size_t c = 0; c < cols; ++c) {
+        const string name = "x" + to_string(c);
+        error = max(error, arma::abs(legacy[name].data.value - mapped[name].data.value).max());
+        error = max(error, arma::abs(legacy[name].data.value - binary[name].data.value).max());
+    }
+
+    remove(filename.c_str());
+    remove(binary_filename.c_str());
+
+    cout << rows << " rows x " << cols << " columns, " << fixed << setprecision(1) << megabytes << " MB" << endl;
+    cout << left << setw(22) << "loader" << setw(12) << "ms" << "MB/s" << endl;
+
+    auto report = [&](const string& name, double ms) {
+        cout << setw(22) << name << setw(12) << ms << megabytes / (ms / 1000) << endl;
+    };
+
+    report("getline + stof", stream_ms);
+    report("mmap, 1 thread", single_ms);
+    report("mmap, " + to_string(max(1u, thread::hardware_concurrency())) + " threads", parallel_ms);
+    report("binary (mapped)", binary_ms);
+
+    cout << "max difference " << scientific << setprecision(1) << error << endl;
+}
@@ -11,6 +11,8 @@
 #include <chrono>
 
 #include <stratosml/core/data/data.hpp>
+#include <stratosml/core/data/batch.hpp>
+#include <stratosml/core/data/pipeline.hpp>
 #include <stratosml/core/autodiff/autodiff.hpp>
 // #include <stratosml/core/optimizers/optimizers.hpp>
 #include <stratosml/core/layers/layers.hpp>
@@ -21,17 +23,45 @@ using namespace stratos::layers;
 
 namespace stratos {
 
+    // When the learning rate scheduler is stepped during training
+    enum class ScheduleStep {
+        Epoch,
+        Batch
+    };
+
+    // How Fit trains the model. Auto solves single linear Dense models under
+    // MeanSquaredError in closed form and trains everything else iteratively.
+    enum class Solver {
+        Auto,
+        Iterative,
+        LeastSquares
+    };
+
     class Model : public Layer {
 
         
 
         std::vector<Layer*> layers;
 
+        bool built = false;
+
     public:
 
         Optimizer* optimizer;
         Loss* loss_fn;
 
+        ScheduleStep schedule_step = ScheduleStep::Epoch;
+        bool shuffle = true;
+        size_t seed = std::random_device{}();
+
+        // Number of micro-batches whose gradients are accumulated per optimizer step
+        size_t accumulation_steps = 1;
+
+        Solver solver = Solver::Auto;
+
+        // Ridge regularization of the closed-form solve
+        double ridge = 0;
+
         Model() {
             this->optimizer = new GradientDescent(0.001);
             this->loss_fn = new MeanSquaredError();
@@ -44,93 +74,473 @@ namespace stratos {
 
         var forward(ConstantOrVariable<float>& inputs) override {
             var output = inputs;
+            size_t begin = 0;
 
-            for (Layer* layer : layers) {
-                output = layer->forward(output);
+            // Every checkpointed layer closes a segment that is rematerialized on backward
+            for (size_t end = 0; end < layers.size(); ++end) {
+                if (!layers[end]->checkpointed) continue;
+
+                // The first run is the forward pass, later ones rematerialize
+                auto ran = std::make_shared<bool>(false);
+
+                output = autodiff::checkpoint<float>(output, [this, begin, end, ran](ConstantOrVariable<float>& x) {
+                    for (size_t i = begin; i <= end; ++i) layers[i]->rematerializing = *ran;
+
+                    var segment_output = this->forward(x, begin, end + 1);
+
+                    for (size_t i = begin; i <= end; ++i) layers[i]->rematerializing = false;
+                    *ran = true;
+
+                    return segment_output;
+                });
+
+                begin = end + 1;
             }
 
-            return output;
+            return this->forward(output, begin, layers.size());
         }
 
         void Add(Layer* layer) {
             this->layers.push_back(layer);
         }
 
-        void Fit(Series& x, Series& y, size_t epochs) {
+        // Checkpoint the output of every n-th layer, trading one extra forward
+        // pass for activation memory that no longer grows with depth.
+        void Checkpoint(size_t every) {
+            for (size_t i = 0; i < layers.size(); ++i) {
+                layers[i]->checkpointed = every > 0 && (i + 1) % every == 0;
+            }
+        }
 
-            constant x_train = x.data;
-            constant y_train = x.data;
+        void Fit(Series& x, Series& y, size_t epochs, size_t batch_size = 0) {
+            this->Fit(x.View(), y.View(), epochs, batch_size);
+        }
 
-            this->Fit(x_train, y_train, epochs);
+        // Trains on matrices such as DataFrame::Select views, which are used in
+        // place rather than copied into the input nodes.
+        void Fit(Tensor<float> x, Tensor<float> y, size_t epochs, size_t batch_size = 0) {
+            constant x_train = std::move(x);
+            constant y_train = std::move(y);
 
+            this->Fit(x_train, y_train, epochs, batch_size);
         }
 
-        void Fit(constant& x, const constant& y, size_t epochs) {
+        // Trains on mini-batches of batch_size rows, batch_size = 0 trains on the full batch.
+        void Fit(constant& x, const constant& y, size_t epochs, size_t batch_size = 0) {
 
-            TensorShape input_shape = x->val.shape;
+            std::vector<std::shared_ptr<var>> parameters = this->Build(x->val.shape);
+            this->SetTraining(true);
 
-            // Build layers with corresponding input shapes
-            for (Layer* layer : layers) {
-                layer->build(input_shape);
-                input_shape = TensorShape({ layer->units });
+            if (this->UseLeastSquares()) {
+                auto start = std::chrono::high_resolution_clock::now();
+
+                optimizers::LeastSquares problem(x->val.value.n_cols, y->val.value.n_cols, this->ridge);
+                problem.Add(x->val.value, y->val.value);
+
+                this->Solve(problem, start, &x, &y);
+                return;
             }
 
-            std::vector<std::shared_ptr<var>> parameters;
+            const size_t n_rows = x->val.value.n_rows;
 
-            for (const Layer* layer : layers) {
-                for (const auto& param : layer->weights) {
-                    parameters.push_back(param);
+            if (batch_size == 0 || batch_size > n_rows)
+                batch_size = n_rows;
+
+            const bool full_batch = batch_size == n_rows;
+
+            data::BatchSampler sampler(n_rows, batch_size, this->seed);
+
+            // Batches are gathered into the same two constant nodes every step
+            constant x_batch = Tensor<float>(arma::Mat<float>(batch_size, x->val.value.n_cols));
+            constant y_batch = Tensor<float>(arma::Mat<float>(batch_size, y->val.value.n_cols));
+
+            size_t step = 0;
+
+            for (int epoch = 1; epoch <= epochs; ++epoch) {
+                auto start = std::chrono::high_resolution_clock::now();
+
+                if (this->shuffle && !full_batch)
+                    sampler.Shuffle();
+
+                double epoch_loss = 0;
+
+                size_t micro_batches = 0;
+                size_t accumulated_rows = 0;
+
+                for (size_t batch = 0; batch < sampler.GetBatchCount(); ++batch) {
+                    size_t count;
+                    const size_t* rows = sampler.Batch(batch, count);
+
+                    if (!full_batch) {
+                        data::GatherRows(x->val, rows, count, x_batch.expr->val);
+                        data::GatherRows(y->val, rows, count, y_batch.expr->val);
+                    }
+
+                    constant& batch_x = full_batch ? x : x_batch;
+                    const constant& batch_y = full_batch ? y : y_batch;
+
+                    // Closure optimizers evaluate the batch themselves, as often as they need
+                    if (this->optimizer->uses_closure()) {
+                        epoch_loss += this->Step(parameters, batch_x, batch_y, count) * count;
+
+                        if (this->schedule_step == ScheduleStep::Batch)
+                            this->optimizer->lr_scheduler->step(++step);
+
+                        continue;
+                    }
+
+                    const float loss = this->Accumulate(batch_x, batch_y, count);
+
+                    epoch_loss += loss * count;
+                    accumulated_rows += count;
+
+                    if (++micro_batches < this->accumulation_steps && batch + 1 < sampler.GetBatchCount())
+                        continue;
+
+                    this->Step(parameters, accumulated_rows);
+
+                    micro_batches = 0;
+                    accumulated_rows = 0;
+
+                    // Update learning rate
+                    if (this->schedule_step == ScheduleStep::Batch)
+                        this->optimizer->lr_scheduler->step(++step);
                 }
+
+                // Perform validation here
+
+                auto end = std::chrono::high_resolution_clock::now();
+                std::chrono::duration<double> epoch_time = end - start;
+
+                std::cout << "Epoch " << epoch << "/" << epochs << "\n";
+                std::cout << std::fixed << epoch_time.count() << "s - loss: " << std::scientific << epoch_loss / n_rows << endl;
+
+                // Update learning rate
+                if (this->schedule_step == ScheduleStep::Epoch)
+                    this->optimizer->lr_scheduler->step(epoch);
             }
+        }
 
-            this->optimizer->build(parameters);
+        // Trains on the batches of a prefetching pipeline, the producer threads
+        // fill the next batches while the current one is being trained on.
+        void Fit(data::Pipeline& pipeline, size_t epochs) {
+
+            std::vector<std::shared_ptr<var>> parameters = this->Build(TensorShape({ 1, pipeline.GetFeatureCount() }));
+            this->SetTraining(true);
+
+            // The normal equations are accumulated over one pass of the batches
+            if (this->UseLeastSquares()) {
+                auto start = std::chrono::high_resolution_clock::now();
+
+                optimizers::LeastSquares problem(pipeline.GetFeatureCount(), pipeline.GetTargetCount(), this->ridge);
+
+                pipeline.BeginEpoch();
+
+                while (data::BatchBuffer* batch = pipeline.Next()) {
+                    problem.Add(batch->x.value, batch->y.value);
+                    pipeline.Release(batch);
+                }
+
+                this->Solve(problem, start);
+                return;
+            }
+
+            // Batch buffers are swapped in and out of these nodes, never copied
+            constant x_batch = Tensor<float>(arma::Mat<float>(1, pipeline.GetFeatureCount()));
+            constant y_batch = Tensor<float>(arma::Mat<float>(1, pipeline.GetTargetCount()));
+
+            size_t step = 0;
 
             for (int epoch = 1; epoch <= epochs; ++epoch) {
                 auto start = std::chrono::high_resolution_clock::now();
-                
-                // Forward pass
-                var output = forward(x);
 
-                // Calculate loss
-                var loss = (*loss_fn)(y, output);
+                pipeline.BeginEpoch();
 
-                // Backward pass
-                loss->derive(1.0);
+                double epoch_loss = 0;
 
-                // Optimize weights
-                this->optimizer->step(parameters);
+                size_t micro_batches = 0;
+                size_t accumulated_rows = 0;
 
-                // Perform validation here
+                while (data::BatchBuffer* batch = pipeline.Next()) {
+                    Tensor<float>& x = x_batch.expr->val;
+                    Tensor<float>& y = y_batch.expr->val;
+
+                    x.value.swap(batch->x.value);
+                    y.value.swap(batch->y.value);
+                    x.shape = batch->x.shape;
+                    y.shape = batch->y.shape;
+
+                    const bool closure = this->optimizer->uses_closure();
+
+                    if (closure) {
+                        epoch_loss += this->Step(parameters, x_batch, y_batch, batch->rows) * batch->rows;
+                    } else {
+                        epoch_loss += this->Accumulate(x_batch, y_batch, batch->rows) * batch->rows;
+                        accumulated_rows += batch->rows;
+                    }
+
+                    x.value.swap(batch->x.value);
+                    y.value.swap(batch->y.value);
+                    pipeline.Release(batch);
+
+                    if (closure) {
+                        if (this->schedule_step == ScheduleStep::Batch)
+                            this->optimizer->lr_scheduler->step(++step);
+
+                        continue;
+                    }
+
+                    if (++micro_batches < this->accumulation_steps)
+                        continue;
+
+                    this->Step(parameters, accumulated_rows);
+
+                    micro_batches = 0;
+                    accumulated_rows = 0;
+
+                    // Update learning rate
+                    if (this->schedule_step == ScheduleStep::Batch)
+                        this->optimizer->lr_scheduler->step(++step);
+                }
+
+                // Leftover micro-batches at the end of the epoch
+                if (micro_batches > 0) {
+                    this->Step(parameters, accumulated_rows);
+
+                    if (this->schedule_step == ScheduleStep::Batch)
+                        this->optimizer->lr_scheduler->step(++step);
+                }
 
                 auto end = std::chrono::high_resolution_clock::now();
                 std::chrono::duration<double> epoch_time = end - start;
 
                 std::cout << "Epoch " << epoch << "/" << epochs << "\n";
-                std::cout << std::fixed << epoch_time.count() << "s - loss: " << std::scientific << loss->val << endl;
+                std::cout << std::fixed << epoch_time.count() << "s - loss: " << std::scientific << epoch_loss / pipeline.GetSize() << endl;
+                std::cout << pipeline.GetStats() << endl;
 
                 // Update learning rate
-                this->optimizer->lr_scheduler->step(epoch);
+                if (this->schedule_step == ScheduleStep::Epoch)
+                    this->optimizer->lr_scheduler->step(epoch);
             }
         }
 
-        var Predict(const Series& x) {
-            constant x_pred = x.data;
+        var Predict(Series& x) {
+            return this->Predict(x.View());
+        }
+
+        var Predict(Tensor<float> x) {
+            constant x_pred = std::move(x);
             return this->Predict(x_pred);
         }
 
         var Predict(constant& x) {
+            this->SetTraining(false);
+
             var pred = forward(x);
             return pred;
         }
 
-        void Evaluate(Series& x_test, Series& y_test) {
-            constant x = x_test.data;
-            constant y = y_test.data;
-            this->Evaluate(x, y);
+        // Captures the training graph of one batch and plans buffer reuse over it
+        MemoryPlan PlanMemory(constant& x, const constant& y) {
+            if (!this->built)
+                this->Build(x->val.shape);
+
+            this->SetTraining(true);
+
+            var output = forward(x);
+            var loss = (*loss_fn)(y, output);
+
+            return autodiff::PlanMemory(loss);
+        }
+
+        // Inference optimization pass, folds every BatchNorm that directly follows a
+        // Dense layer without activation into that layer's kernel and bias. Predictions
+        // stay the same without the normalization pass. The folded model is meant for
+        // serving, not for further training.
+        void FoldBatchNorm() {
+            for (size_t i = 0; i + 1 < layers.size(); ++i) {
+                Dense* dense = dynamic_cast<Dense*>(layers[i]);
+                BatchNorm* norm = dynamic_cast<BatchNorm*>(layers[i + 1]);
+
+                if (!dense || !norm || !dynamic_cast<Linear*>(dense->activation))
+                    continue;
+
+                arma::Mat<float> scale, shift;
+                norm->affine(scale, shift);
+
+                dense->fold(scale, shift, norm->release_activation());
+                dense->checkpointed = dense->checkpointed || norm->checkpointed;
+
+                delete norm;
+                layers.erase(layers.begin() + i + 1);
+            }
+        }
+
+        float Evaluate(Series& x_test, Series& y_test) {
+            return this->Evaluate(x_test.View(), y_test.View());
+        }
+
+        float Evaluate(Tensor<float> x_test, Tensor<float> y_test) {
+            constant x = std::move(x_test);
+            constant y = std::move(y_test);
+            return this->Evaluate(x, y);
+        }
+
+        // Loss over the test data in inference mode
+        float Evaluate(constant& x_test, constant& y_test) {
+            this->SetTraining(false);
+
+            var loss = (*loss_fn)(y_test, forward(x_test));
+            const float value = loss->val.value(0, 0);
+
+            std::cout << "Evaluation over " << x_test->val.value.n_rows << " rows - loss: " << std::scientific << value << endl;
+
+            return value;
+        }
+
+    private:
+
+        // Single Dense layer without activation under MeanSquaredError
+        bool IsLinear() const {
+            return layers.size() == 1
+                && dynamic_cast<Dense*>(layers[0])
+                && dynamic_cast<Linear*>(layers[0]->activation)
+                && dynamic_cast<MeanSquaredError*>(loss_fn);
         }
 
-        void Evaluate(constant& x_test, constant& y_test) {
-            
+        bool UseLeastSquares() const {
+            if (this->solver == Solver::Iterative)
+                return false;
+
+            const bool linear = this->IsLinear();
+
+            if (this->solver == Solver::LeastSquares && !linear)
+                throw std::invalid_argument("The least squares solver needs a single linear Dense layer and MeanSquaredError.");
+
+            return linear;
+        }
+
+        // Solves the accumulated problem into the Dense layer, reporting the training
+        // loss when the data is at hand
+        void Solve(const optimizers::LeastSquares& problem, std::chrono::high_resolution_clock::time_point start,
+            constant* x = nullptr, const constant* y = nullptr) {
+
+            arma::Mat<float> kernel, bias;
+            problem.Solve(kernel, bias);
+
+            dynamic_cast<Dense*>(layers[0])->assign_weights(kernel, bias);
+
+            std::chrono::duration<double> time = std::chrono::high_resolution_clock::now() - start;
+
+            std::cout << "Least squares solve over " << problem.GetSize() << " rows\n";
+            std::cout << std::fixed << time.count() << "s";
+
+            if (x && y) {
+                var loss = (*loss_fn)(*y, forward(*x));
+                std::cout << " - loss: " << std::scientific << loss->val.value(0, 0);
+            }
+
+            std::cout << endl;
+        }
+
+        // Steps an optimizer that re-evaluates the loss, through a closure running the
+        // forward and backward pass of the batch at the current parameters
+        float Step(const std::vector<std::shared_ptr<var>>& parameters, ConstantOrVariable<float>& x, const ConstantOrVariable<float>& y, size_t rows) {
+
+            auto closure = [&]() {
+                for (const auto& param : parameters) {
+                    (*param)->zero_grad();
+                }
+
+                const float loss = this->Accumulate(x, y, rows);
+
+                for (const auto& param : parameters) {
+                    (*param)->scale_grad(1.0f / rows);
+                }
+
+                return loss;
+            };
+
+            const float loss = this->optimizer->step(parameters, closure);
+
+            for (const auto& param : parameters) {
+                (*param)->zero_grad();
+            }
+
+            return loss;
+        }
+
+        void SetTraining(bool training) {
+            for (Layer* layer : layers) {
+                layer->training = training;
+            }
+        }
+
+        var forward(ConstantOrVariable<float>& inputs, size_t begin, size_t end) {
+            var output = inputs;
+
+            for (size_t i = begin; i < end; ++i) {
+                output = layers[i]->forward(output);
+            }
+
+            return output;
+        }
+
+        // Builds layers with corresponding input shapes and the optimizer over their weights
+        std::vector<std::shared_ptr<var>> Build(TensorShape input_shape) {
+
+            // Per-sample shapes, rows are samples
+            input_shape = TensorShape({ input_shape[input_shape.rank() - 1] });
+
+            for (Layer* layer : layers) {
+                layer->build(input_shape);
+                input_shape = layer->output_shape();
+            }
+
+            std::vector<std::shared_ptr<var>> parameters;
+
+            for (const Layer* layer : layers) {
+                for (const auto& param : layer->weights) {
+                    parameters.push_back(param);
+                }
+            }
+
+            this->optimizer->build(parameters);
+            this->built = true;
+
+            return parameters;
+        }
+
+        // Forward and backward pass of one micro-batch. Gradients are weighted by the
+        // micro-batch row count and the graph is released as soon as this returns.
+        float Accumulate(ConstantOrVariable<float>& x, const ConstantOrVariable<float>& y, size_t rows) {
+
+            // Forward pass
+            var output = forward(x);
+
+            // Calculate loss
+            var loss = (*loss_fn)(y, output);
+
+            // Backward pass
+            loss->derive((float)rows);
+
+            return loss->val.value(0, 0);
+        }
+
+        // Averages the accumulated gradients over their rows, so K micro-batches
+        // give the same update as one batch of all their rows, then optimizes.
+        void Step(const std::vector<std::shared_ptr<var>>& parameters, size_t rows) {
+
+            for (const auto& param : parameters) {
+                (*param)->scale_grad(1.0f / rows);
+            }
+
+            // Optimize weights
+            this->optimizer->step(parameters);
+
+            for (const auto& param : parameters) {
+                (*param)->zero_grad();
+            }
         }
     };
 
@@ -3,9 +3,16 @@
 #include <stratosml/core/autodiff/tensor.hpp>
 #include <stratosml/core/autodiff/node.hpp>
 #include <stratosml/core/autodiff/ops.hpp>
+#include <stratosml/core/autodiff/checkpoint.hpp>
+#include <stratosml/core/autodiff/memory.hpp>
 
 #include <stratosml/core/autodiff/nn/losses.hpp>
 #include <stratosml/core/autodiff/nn/activations.hpp>
+#include <stratosml/core/autodiff/nn/dense.hpp>
+#include <stratosml/core/autodiff/nn/conv.hpp>
+#include <stratosml/core/autodiff/nn/embedding.hpp>
+#include <stratosml/core/autodiff/nn/recurrent.hpp>
+#include <stratosml/core/autodiff/nn/normalization.hpp>
 
 namespace stratos {
 
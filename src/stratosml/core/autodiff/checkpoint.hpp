@@ -0,0 +1,54 @@
+#pragma once
+
+#include <functional>
+
+#include <stratosml/core/autodiff/tensor.hpp>
+#include <stratosml/core/autodiff/node.hpp>
+#include <stratosml/core/autodiff/ops.hpp>
+
+namespace stratos {
+
+    namespace autodiff {
+
+        template<typename T>
+        using Segment = std::function<Variable<T>(ConstantOrVariable<T>&)>;
+
+        // Output of a rematerialized segment. Only the segment input (the previous
+        // checkpoint) and output are kept, the graph in between is rebuilt on
+        // backward and released again once its gradients have been passed on.
+        template<typename T>
+        struct CheckpointExprNode : UnaryExprNode<T> {
+
+            using UnaryExprNode<T>::x;
+
+            Segment<T> segment;
+
+            CheckpointExprNode(Tensor<T> v, const NodePtr<T>& x, const Segment<T>& segment) : UnaryExprNode<T>(std::move(v), x), segment(segment) {}
+
+            void derive(const Tensor<T>& grad) override {
+                Variable<T> input(x->val);
+                Variable<T> output = this->segment(input);
+
+                output.expr->derive(grad);
+                x->derive(input->grad);
+            }
+        };
+
+        // Runs the segment without keeping its intermediate activations
+        template<typename T>
+        NodePtr<T> checkpoint(const NodePtr<T>& x, const Segment<T>& segment) {
+            Tensor<T> output;
+
+            {
+                Constant<T> input(x->val);
+                output = segment(input).expr->val;
+            }
+
+            return std::make_shared<CheckpointExprNode<T>>(std::move(output), x, segment);
+        }
+
+        template<typename T> NodePtr<T> checkpoint(const ConstantOrVariable<T>& x, const Segment<T>& segment) { return checkpoint(x.expr, segment); }
+
+    }
+
+}
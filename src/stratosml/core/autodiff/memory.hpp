@@ -0,0 +1,199 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <numeric>
+#include <unordered_map>
+#include <vector>
+
+#include <stratosml/core/autodiff/node.hpp>
+
+/*
+ *
+ * MEMORY PLANNER - Liveness based buffer reuse for a captured graph
+ *
+ * The graph is replayed in execution order: the forward pass in topological
+ * order, then the backward pass in reverse. Every intermediate value and
+ * gradient gets a lifetime [first, last] over these steps and is placed at an
+ * offset of a shared arena, so tensors that are never alive at the same time
+ * share memory. Parameters, their gradients and input constants outlive the
+ * graph and are not planned.
+ *
+ */
+
+namespace stratos {
+
+    namespace autodiff {
+
+        struct TensorLifetime {
+            size_t bytes;
+            size_t first;       // step producing the tensor
+            size_t last;        // last step reading it
+            size_t offset = 0;  // placement in the arena
+            bool gradient;
+        };
+
+        struct MemoryPlan {
+            std::vector<TensorLifetime> tensors;
+            size_t steps = 0;
+
+            size_t persistent = 0;      // parameters, their gradients and inputs
+            size_t naive_peak = 0;      // every tensor owning its own buffer, as the graph runs today
+            size_t live_peak = 0;       // most bytes alive at one step, the lower bound of any plan
+            size_t planned_peak = 0;    // arena size of the offset assignment
+
+            friend std::ostream& operator<<(std::ostream& stream, const MemoryPlan& plan) {
+                auto mb = [](size_t bytes) { return bytes / (1024.0 * 1024.0); };
+
+                stream << std::fixed << std::setprecision(2);
+                stream << "Memory plan: " << plan.tensors.size() << " tensors over " << plan.steps << " steps\n";
+                stream << "  persistent:   " << mb(plan.persistent) << " MB\n";
+                stream << "  naive peak:   " << mb(plan.naive_peak) << " MB\n";
+                stream << "  live peak:    " << mb(plan.live_peak) << " MB\n";
+                stream << "  planned peak: " << mb(plan.planned_peak) << " MB";
+
+                if (plan.planned_peak)
+                    stream << " (" << (double)plan.naive_peak / plan.planned_peak << "x smaller)";
+
+                return stream << "\n";
+            }
+        };
+
+        // Best-fit offset assignment, largest tensors first. Each tensor goes in the
+        // smallest gap left between the tensors already placed that overlap it in time.
+        inline size_t AssignOffsets(std::vector<TensorLifetime>& tensors) {
+            std::vector<size_t> order(tensors.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return tensors[a].bytes > tensors[b].bytes; });
+
+            std::vector<size_t> placed;
+            size_t arena = 0;
+
+            for (size_t i : order) {
+                TensorLifetime& tensor = tensors[i];
+
+                std::vector<const TensorLifetime*> overlapping;
+                for (size_t j : placed) {
+                    const TensorLifetime& other = tensors[j];
+                    if (other.first <= tensor.last && tensor.first <= other.last)
+                        overlapping.push_back(&other);
+                }
+
+                std::sort(overlapping.begin(), overlapping.end(), [](auto a, auto b) { return a->offset < b->offset; });
+
+                size_t best = SIZE_MAX, best_gap = SIZE_MAX, cursor = 0;
+
+                for (const TensorLifetime* other : overlapping) {
+                    if (other->offset >= cursor + tensor.bytes) {
+                        const size_t gap = other->offset - cursor;
+                        if (gap < best_gap) { best_gap = gap; best = cursor; }
+                    }
+                    cursor = std::max(cursor, other->offset + other->bytes);
+                }
+
+                tensor.offset = best != SIZE_MAX ? best : cursor;
+                arena = std::max(arena, tensor.offset + tensor.bytes);
+                placed.push_back(i);
+            }
+
+            return arena;
+        }
+
+        // Plans the graph ending at root, training plans include the backward pass
+        template<typename T>
+        MemoryPlan PlanMemory(const NodePtr<T>& root, bool training = true) {
+
+            // Forward execution order, inputs before the nodes computed from them
+            std::vector<Node<T>*> order;
+            std::unordered_map<Node<T>*, size_t> index;
+            std::vector<std::pair<Node<T>*, bool>> stack = { { root.get(), false } };
+
+            while (!stack.empty()) {
+                auto [node, expanded] = stack.back();
+                stack.pop_back();
+
+                if (index.contains(node)) continue;
+
+                if (expanded) {
+                    index[node] = order.size();
+                    order.push_back(node);
+                    continue;
+                }
+
+                stack.push_back({ node, true });
+                for (const auto& input : node->inputs()) {
+                    if (!index.contains(input.get())) stack.push_back({ input.get(), false });
+                }
+            }
+
+            const size_t n = order.size();
+
+            std::vector<std::vector<size_t>> consumers(n);
+            std::vector<bool> persistent(n), needs_grad(n);
+
+            for (size_t i = 0; i < n; ++i) {
+                const bool parameter = dynamic_cast<IndependentVariableNode<T>*>(order[i]) != nullptr;
+                persistent[i] = parameter || dynamic_cast<ConstantNode<T>*>(order[i]) != nullptr;
+                needs_grad[i] = training && parameter;
+
+                for (const auto& input : order[i]->inputs()) {
+                    const size_t j = index[input.get()];
+                    consumers[j].push_back(i);
+                    needs_grad[i] = needs_grad[i] || needs_grad[j];
+                }
+            }
+
+            auto backward_step = [n](size_t i) { return 2 * n - 1 - i; };
+
+            MemoryPlan plan;
+            plan.steps = training ? 2 * n : n;
+
+            for (size_t i = 0; i < n; ++i) {
+                const size_t bytes = order[i]->val.value.n_elem * sizeof(T);
+
+                if (persistent[i]) {
+                    plan.persistent += needs_grad[i] ? 2 * bytes : bytes;
+                    continue;
+                }
+
+                // Values are read by their consumers on forward, and on backward by
+                // themselves and their consumers
+                size_t last = i;
+                if (needs_grad[i]) last = backward_step(i);
+
+                for (size_t c : consumers[i]) {
+                    last = std::max(last, needs_grad[c] ? backward_step(c) : c);
+                }
+
+                plan.tensors.push_back({ bytes, i, last, 0, false });
+
+                if (!needs_grad[i]) continue;
+
+                // Gradients are produced by the first consumer to run backward
+                size_t first = backward_step(i);
+                for (size_t c : consumers[i]) {
+                    if (needs_grad[c]) first = std::min(first, backward_step(c));
+                }
+
+                plan.tensors.push_back({ bytes, first, backward_step(i), 0, true });
+            }
+
+            std::vector<size_t> live(plan.steps + 1, 0);
+
+            for (const auto& tensor : plan.tensors) {
+                plan.naive_peak += tensor.bytes;
+                for (size_t step = tensor.first; step <= tensor.last; ++step) live[step] += tensor.bytes;
+            }
+
+            plan.live_peak = *std::max_element(live.begin(), live.end());
+            plan.planned_peak = AssignOffsets(plan.tensors);
+
+            return plan;
+        }
+
+        template<typename T> MemoryPlan PlanMemory(const ConstantOrVariable<T>& root, bool training = true) { return PlanMemory(root.expr, training); }
+
+    }
+
+}
@@ -1,34 +1,347 @@
-#include <stratosml/core/autodiff/autodiff.hpp>
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include <stratosml/core/autodiff/node.hpp>
 
 using namespace stratos::autodiff;
 
 namespace stratos {
 
+    namespace autodiff {
+
+        // Sets up the output buffer of an activation. In place, the input's value is
+        // taken over instead of allocating, which is only done when the input node
+        // never reads its own value on backward. Returns whether the input was taken,
+        // its value is left empty then.
+        inline bool take_input(const NodePtr<float>& x, bool inplace, arma::Mat<float>& out) {
+            if (inplace && !x->needs_value()) {
+                out = std::move(x->val.value);
+                return true;
+            }
+
+            out.set_size(arma::size(x->val.value));
+            return false;
+        }
+
+        // max(x, 0), backward only keeps one bit per element
+        struct ReluExprNode : Node<float> {
+
+            NodePtr<float> x;
+            std::vector<uint64_t> mask;
+
+            ReluExprNode(Tensor<float> v, const NodePtr<float>& x, std::vector<uint64_t>&& mask) : Node<float>(std::move(v)), x(x), mask(std::move(mask)) {}
+
+            void derive(const Tensor<float>& grad) override {
+                arma::Mat<float> dx(arma::size(this->val.value));
+                const float* g = grad.value.memptr();
+                float* out = dx.memptr();
+
+                for (size_t i = 0; i < dx.n_elem; ++i) {
+                    out[i] = (mask[i >> 6] >> (i & 63)) & 1 ? g[i] : 0.0f;
+                }
+
+                x->derive(Tensor<float>(std::move(dx)));
+            }
+
+            bool needs_value() const override { return false; }
+
+            std::vector<NodePtr<float>> inputs() const override { return { x }; }
+        };
+
+        // Element-wise activation whose derivative is a function of its output
+        template<typename Derivative>
+        struct OutputDerivedExprNode : Node<float> {
+
+            NodePtr<float> x;
+
+            OutputDerivedExprNode(Tensor<float> v, const NodePtr<float>& x) : Node<float>(std::move(v)), x(x) {}
+
+            void derive(const Tensor<float>& grad) override {
+                arma::Mat<float> dx(arma::size(this->val.value));
+                const float* g = grad.value.memptr();
+                const float* y = this->val.value.memptr();
+                float* out = dx.memptr();
+
+                for (size_t i = 0; i < dx.n_elem; ++i) {
+                    out[i] = g[i] * Derivative()(y[i]);
+                }
+
+                x->derive(Tensor<float>(std::move(dx)));
+            }
+
+            std::vector<NodePtr<float>> inputs() const override { return { x }; }
+        };
+
+        struct SigmoidDerivative { float operator()(float y) const { return y * (1.0f - y); } };
+        struct TanhDerivative { float operator()(float y) const { return 1.0f - y * y; } };
+
+        using SigmoidExprNode = OutputDerivedExprNode<SigmoidDerivative>;
+        using TanhExprNode = OutputDerivedExprNode<TanhDerivative>;
+
+        // Row-wise softmax, backward is y * (g - rowsum(g * y))
+        struct SoftMaxExprNode : Node<float> {
+
+            NodePtr<float> x;
+
+            SoftMaxExprNode(Tensor<float> v, const NodePtr<float>& x) : Node<float>(std::move(v)), x(x) {}
+
+            void derive(const Tensor<float>& grad) override {
+                const arma::Mat<float>& y = this->val.value;
+                arma::Mat<float> dx(arma::size(y));
+                std::vector<float> dot(y.n_rows, 0.0f);
+
+                for (size_t j = 0; j < y.n_cols; ++j) {
+                    const float* g = grad.value.colptr(j);
+                    const float* p = y.colptr(j);
+                    for (size_t i = 0; i < y.n_rows; ++i) dot[i] += g[i] * p[i];
+                }
+
+                for (size_t j = 0; j < y.n_cols; ++j) {
+                    const float* g = grad.value.colptr(j);
+                    const float* p = y.colptr(j);
+                    float* out = dx.colptr(j);
+                    for (size_t i = 0; i < y.n_rows; ++i) out[i] = p[i] * (g[i] - dot[i]);
+                }
+
+                x->derive(Tensor<float>(std::move(dx)));
+            }
+
+            std::vector<NodePtr<float>> inputs() const override { return { x }; }
+        };
+
+        /// ------------------------------------------
+        /// Kernels, plain loops over contiguous memory
+        /// ------------------------------------------
+
+        inline void relu_kernel(const float* in, float* out, uint64_t* mask, size_t n) {
+            for (size_t word = 0; word * 64 < n; ++word) {
+                const size_t begin = word * 64;
+                const size_t end = std::min(begin + 64, n);
+                uint64_t bits = 0;
+
+                for (size_t i = begin; i < end; ++i) {
+                    const bool positive = in[i] > 0.0f;
+                    bits |= (uint64_t)positive << (i - begin);
+                    out[i] = positive ? in[i] : 0.0f;
+                }
+
+                mask[word] = bits;
+            }
+        }
+
+        inline float sigmoid(float x) { return 1.0f / (1.0f + std::exp(-x)); }
+
+        inline void sigmoid_kernel(const float* in, float* out, size_t n) {
+            for (size_t i = 0; i < n; ++i) out[i] = sigmoid(in[i]);
+        }
+
+        inline void tanh_kernel(const float* in, float* out, size_t n) {
+            for (size_t i = 0; i < n; ++i) out[i] = std::tanh(in[i]);
+        }
+
+        // Stable row-wise softmax, column passes keep the accesses contiguous
+        inline void softmax_kernel(const arma::Mat<float>& in, arma::Mat<float>& out) {
+            std::vector<float> max(in.n_rows, -INFINITY), sum(in.n_rows, 0.0f);
+
+            for (size_t j = 0; j < in.n_cols; ++j) {
+                const float* x = in.colptr(j);
+                for (size_t i = 0; i < in.n_rows; ++i) max[i] = std::max(max[i], x[i]);
+            }
+
+            for (size_t j = 0; j < in.n_cols; ++j) {
+                const float* x = in.colptr(j);
+                float* y = out.colptr(j);
+                for (size_t i = 0; i < in.n_rows; ++i) {
+                    y[i] = std::exp(x[i] - max[i]);
+                    sum[i] += y[i];
+                }
+            }
+
+            for (float& s : sum) s = 1.0f / s;
+
+            for (size_t j = 0; j < out.n_cols; ++j) {
+                float* y = out.colptr(j);
+                for (size_t i = 0; i < out.n_rows; ++i) y[i] *= sum[i];
+            }
+        }
+
+        /// ---------
+        /// Functions
+        /// ---------
+
+        inline NodePtr<float> relu(const NodePtr<float>& x, bool inplace = false) {
+            arma::Mat<float> out;
+            const float* in = take_input(x, inplace, out) ? out.memptr() : x->val.value.memptr();
+
+            std::vector<uint64_t> mask((out.n_elem + 63) / 64);
+            relu_kernel(in, out.memptr(), mask.data(), out.n_elem);
+
+            return std::make_shared<ReluExprNode>(Tensor<float>(std::move(out)), x, std::move(mask));
+        }
+
+        inline NodePtr<float> sigmoid(const NodePtr<float>& x, bool inplace = false) {
+            arma::Mat<float> out;
+            const float* in = take_input(x, inplace, out) ? out.memptr() : x->val.value.memptr();
+
+            sigmoid_kernel(in, out.memptr(), out.n_elem);
+
+            return std::make_shared<SigmoidExprNode>(Tensor<float>(std::move(out)), x);
+        }
+
+        inline NodePtr<float> tanh(const NodePtr<float>& x, bool inplace = false) {
+            arma::Mat<float> out;
+            const float* in = take_input(x, inplace, out) ? out.memptr() : x->val.value.memptr();
+
+            tanh_kernel(in, out.memptr(), out.n_elem);
+
+            return std::make_shared<TanhExprNode>(Tensor<float>(std::move(out)), x);
+        }
+
+        inline NodePtr<float> softmax(const NodePtr<float>& x, bool inplace = false) {
+            arma::Mat<float> out;
+            const arma::Mat<float>& in = take_input(x, inplace, out) ? out : x->val.value;
+
+            softmax_kernel(in, out);
+
+            return std::make_shared<SoftMaxExprNode>(Tensor<float>(std::move(out)), x);
+        }
+
+    }
+
     namespace activations {
 
         struct Activation {
+
+            // Take over the input buffer when the input's producer does not need it,
+            // for inputs that are not read again by anything else.
+            bool inplace = false;
+
+            Activation(bool inplace = false) : inplace(inplace) {}
+
+            // Layers own their activation and delete it through this base
+            virtual ~Activation() {}
+
             virtual var operator()(const var& input) = 0;
+
+            // Element-wise activations can be fused into the layer computing their input
+            virtual bool elementwise() const { return true; }
+
+            /// Column kernels for layers that apply the activation inside their own node
+
+            // out[i] = f(out[i] + bias)
+            virtual void fused_forward(float* out, size_t n, float bias) const = 0;
+
+            // dz[i] = grad[i] * f'(z[i]) from the activation output, returns the column sum of dz
+            virtual float fused_backward(const float* grad, const float* out, float* dz, size_t n) const = 0;
         };
 
         struct Linear : Activation {
+            using Activation::Activation;
+
             var operator()(const var& input) override {
                 return input;
             }
+
+            void fused_forward(float* out, size_t n, float bias) const override {
+                for (size_t i = 0; i < n; ++i) out[i] += bias;
+            }
+
+            float fused_backward(const float* grad, const float*, float* dz, size_t n) const override {
+                float sum = 0;
+                for (size_t i = 0; i < n; ++i) {
+                    dz[i] = grad[i];
+                    sum += grad[i];
+                }
+                return sum;
+            }
         };
 
         struct Sigmoid : Activation {
+            using Activation::Activation;
+
+            var operator()(const var& input) override {
+                return autodiff::sigmoid(input.expr, inplace);
+            }
+
+            void fused_forward(float* out, size_t n, float bias) const override {
+                for (size_t i = 0; i < n; ++i) out[i] = autodiff::sigmoid(out[i] + bias);
+            }
+
+            float fused_backward(const float* grad, const float* out, float* dz, size_t n) const override {
+                float sum = 0;
+                for (size_t i = 0; i < n; ++i) {
+                    dz[i] = grad[i] * out[i] * (1.0f - out[i]);
+                    sum += dz[i];
+                }
+                return sum;
+            }
+        };
+
+        struct Tanh : Activation {
+            using Activation::Activation;
 
+            var operator()(const var& input) override {
+                return autodiff::tanh(input.expr, inplace);
+            }
+
+            void fused_forward(float* out, size_t n, float bias) const override {
+                for (size_t i = 0; i < n; ++i) out[i] = std::tanh(out[i] + bias);
+            }
+
+            float fused_backward(const float* grad, const float* out, float* dz, size_t n) const override {
+                float sum = 0;
+                for (size_t i = 0; i < n; ++i) {
+                    dz[i] = grad[i] * (1.0f - out[i] * out[i]);
+                    sum += dz[i];
+                }
+                return sum;
+            }
         };
 
         struct Relu : Activation {
+            using Activation::Activation;
 
+            var operator()(const var& input) override {
+                return autodiff::relu(input.expr, inplace);
+            }
+
+            void fused_forward(float* out, size_t n, float bias) const override {
+                for (size_t i = 0; i < n; ++i) out[i] = std::max(out[i] + bias, 0.0f);
+            }
+
+            float fused_backward(const float* grad, const float* out, float* dz, size_t n) const override {
+                float sum = 0;
+                for (size_t i = 0; i < n; ++i) {
+                    dz[i] = out[i] > 0.0f ? grad[i] : 0.0f;
+                    sum += dz[i];
+                }
+                return sum;
+            }
         };
 
+        // Row-wise, so it cannot be fused into a column pass
         struct SoftMax : Activation {
+            using Activation::Activation;
 
-        };
+            var operator()(const var& input) override {
+                return autodiff::softmax(input.expr, inplace);
+            }
+
+            bool elementwise() const override { return false; }
+
+            void fused_forward(float*, size_t, float) const override {
+                throw std::logic_error("SoftMax is not element-wise.");
+            }
 
+            float fused_backward(const float*, const float*, float*, size_t) const override {
+                throw std::logic_error("SoftMax is not element-wise.");
+            }
+        };
 
     }
 
-}
\ No newline at end of file
+}
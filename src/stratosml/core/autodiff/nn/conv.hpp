@@ -0,0 +1,291 @@
+#pragma once
+#include <algorithm>
+#include <armadillo>
+#include <cstring>
+#include <stdexcept>
+
+#include <stratosml/core/autodiff/node.hpp>
+#include <stratosml/core/autodiff/nn/activations.hpp>
+
+using namespace stratos::activations;
+
+/*
+ *
+ * CONVOLUTION - 2D convolution over batches of flattened samples
+ *
+ * Samples are rows, a (C, H, W) sample is stored as C * H * W columns ordered
+ * by the layout. Every column then holds one (channel, pixel) of the whole
+ * batch contiguously, so both paths below work on runs of n floats:
+ *  - im2col copies the input runs each output pixel reads into an (n * P, C * K)
+ *    matrix and computes all filters with one GEMM, P output pixels and K taps.
+ *  - direct accumulates the taps of small kernels straight into the output runs,
+ *    without the im2col buffer.
+ * 1D convolutions are 2D convolutions of height 1.
+ *
+ */
+
+namespace stratos {
+
+    namespace autodiff {
+
+        enum class Layout { NCHW, NHWC };
+
+        enum class ConvAlgorithm { Auto, Im2col, Direct };
+
+        struct ConvGeometry {
+            size_t channels = 0, height = 0, width = 0;
+            size_t filters = 0, kernel_h = 0, kernel_w = 0;
+            size_t stride_h = 1, stride_w = 1;
+            size_t pad_top = 0, pad_left = 0;
+            size_t out_h = 0, out_w = 0;
+            Layout layout = Layout::NCHW;
+
+            size_t taps() const { return kernel_h * kernel_w; }
+            size_t pixels() const { return out_h * out_w; }
+            size_t input_size() const { return channels * height * width; }
+            size_t output_size() const { return filters * pixels(); }
+
+            size_t input_column(size_t c, size_t h, size_t w) const {
+                return layout == Layout::NCHW ? (c * height + h) * width + w : (h * width + w) * channels + c;
+            }
+
+            size_t output_column(size_t f, size_t p) const {
+                return layout == Layout::NCHW ? f * pixels() + p : p * filters + f;
+            }
+
+            // Input column read by tap (i, j) of output pixel (oh, ow), or false inside the padding
+            bool source(size_t c, size_t oh, size_t ow, size_t i, size_t j, size_t& column) const {
+                const long h = (long)(oh * stride_h + i) - (long)pad_top;
+                const long w = (long)(ow * stride_w + j) - (long)pad_left;
+
+                if (h < 0 || w < 0 || h >= (long)height || w >= (long)width)
+                    return false;
+
+                column = input_column(c, h, w);
+                return true;
+            }
+
+            // 3x3 and 3x1 kernels at unit stride have too few taps to make the im2col copy pay off
+            bool direct() const {
+                return stride_h == 1 && stride_w == 1 && taps() <= 9 && (kernel_h == 1 || kernel_w == 1 || (kernel_h == 3 && kernel_w == 3));
+            }
+        };
+
+        // (n * P, C * K) matrix of the input runs, row block p holds output pixel p
+        inline void im2col(const arma::Mat<float>& x, const ConvGeometry& g, arma::Mat<float>& cols) {
+            const size_t n = x.n_rows;
+            cols.set_size(n * g.pixels(), g.channels * g.taps());
+
+            for (size_t c = 0; c < g.channels; ++c) {
+                for (size_t i = 0; i < g.kernel_h; ++i) {
+                    for (size_t j = 0; j < g.kernel_w; ++j) {
+                        float* out = cols.colptr((c * g.kernel_h + i) * g.kernel_w + j);
+
+                        for (size_t oh = 0; oh < g.out_h; ++oh) {
+                            for (size_t ow = 0; ow < g.out_w; ++ow, out += n) {
+                                size_t column;
+                                if (g.source(c, oh, ow, i, j, column))
+                                    std::memcpy(out, x.colptr(column), n * sizeof(float));
+                                else
+                                    std::fill(out, out + n, 0.0f);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        // Adds the im2col gradient back onto the input columns it was copied from
+        inline void col2im(const arma::Mat<float>& cols, const ConvGeometry& g, arma::Mat<float>& dx) {
+            const size_t n = dx.n_rows;
+
+            for (size_t c = 0; c < g.channels; ++c) {
+                for (size_t i = 0; i < g.kernel_h; ++i) {
+                    for (size_t j = 0; j < g.kernel_w; ++j) {
+                        const float* in = cols.colptr((c * g.kernel_h + i) * g.kernel_w + j);
+
+                        for (size_t oh = 0; oh < g.out_h; ++oh) {
+                            for (size_t ow = 0; ow < g.out_w; ++ow, in += n) {
+                                size_t column;
+                                if (!g.source(c, oh, ow, i, j, column)) continue;
+
+                                float* out = dx.colptr(column);
+                                for (size_t r = 0; r < n; ++r) out[r] += in[r];
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        // activation(conv(x, kernel) + bias) as a single node.
+        // x is (n, C * H * W), kernel (C * K, filters), bias (filters, 1).
+        struct ConvExprNode : Node<float> {
+
+            NodePtr<float> x, kernel, bias;
+            ConvGeometry geometry;
+            bool direct;
+            const Activation* activation;
+
+            ConvExprNode(Tensor<float> v, const NodePtr<float>& x, const NodePtr<float>& kernel, const NodePtr<float>& bias,
+                const ConvGeometry& geometry, bool direct, const Activation* activation)
+                : Node<float>(std::move(v)), x(x), kernel(kernel), bias(bias), geometry(geometry), direct(direct), activation(activation) {}
+
+            void derive(const Tensor<float>& grad) override {
+                const ConvGeometry& g = this->geometry;
+                const arma::Mat<float>& out = this->val.value;
+                const size_t n = out.n_rows;
+
+                arma::Mat<float> spread;
+                if (grad.is_scalar() && out.n_elem > 1)
+                    spread = arma::Mat<float>(arma::size(out), arma::fill::value(grad(0, 0)));
+
+                const arma::Mat<float>& gr = spread.n_elem ? spread : grad.value;
+
+                // dz in im2col row order, (n * P, filters), and the bias gradient in the same pass
+                arma::Mat<float> dz(n * g.pixels(), g.filters);
+                arma::Mat<float> db(g.filters, 1, arma::fill::zeros);
+
+                for (size_t f = 0; f < g.filters; ++f) {
+                    for (size_t p = 0; p < g.pixels(); ++p) {
+                        const size_t column = g.output_column(f, p);
+                        db(f) += activation->fused_backward(gr.colptr(column), out.colptr(column), dz.colptr(f) + n * p, n);
+                    }
+                }
+
+                const bool input_grad = requires_grad(x);
+                const arma::Mat<float>& w = kernel->val.value;
+                arma::Mat<float> dx, dw;
+
+                if (direct) {
+                    const arma::Mat<float>& in = x->val.value;
+                    dw.zeros(arma::size(w));
+                    if (input_grad) dx.zeros(arma::size(in));
+
+                    for (size_t f = 0; f < g.filters; ++f) {
+                        for (size_t c = 0; c < g.channels; ++c) {
+                            for (size_t i = 0; i < g.kernel_h; ++i) {
+                                for (size_t j = 0; j < g.kernel_w; ++j) {
+                                    const size_t tap = (c * g.kernel_h + i) * g.kernel_w + j;
+                                    const float weight = w(tap, f);
+                                    float sum = 0;
+
+                                    for (size_t oh = 0; oh < g.out_h; ++oh) {
+                                        for (size_t ow = 0; ow < g.out_w; ++ow) {
+                                            size_t column;
+                                            if (!g.source(c, oh, ow, i, j, column)) continue;
+
+                                            const float* d = dz.colptr(f) + n * (oh * g.out_w + ow);
+                                            const float* src = in.colptr(column);
+
+                                            for (size_t r = 0; r < n; ++r) sum += src[r] * d[r];
+
+                                            if (input_grad) {
+                                                float* dst = dx.colptr(column);
+                                                for (size_t r = 0; r < n; ++r) dst[r] += weight * d[r];
+                                            }
+                                        }
+                                    }
+
+                                    dw(tap, f) = sum;
+                                }
+                            }
+                        }
+                    }
+                } else {
+                    arma::Mat<float> cols;
+                    im2col(x->val.value, g, cols);
+                    dw = cols.t() * dz;
+
+                    if (input_grad) {
+                        cols = dz * w.t();
+                        dx.zeros(arma::size(x->val.value));
+                        col2im(cols, g, dx);
+                    }
+                }
+
+                if (input_grad) x->derive(Tensor<float>(std::move(dx)));
+
+                kernel->derive(Tensor<float>(std::move(dw)));
+                bias->derive(Tensor<float>(std::move(db)));
+            }
+
+            std::vector<NodePtr<float>> inputs() const override { return { x, kernel, bias }; }
+        };
+
+        inline NodePtr<float> conv(const NodePtr<float>& x, const NodePtr<float>& kernel, const NodePtr<float>& bias,
+            const ConvGeometry& g, const Activation* activation, ConvAlgorithm algorithm = ConvAlgorithm::Auto) {
+
+            const arma::Mat<float>& in = x->val.value;
+            const arma::Mat<float>& w = kernel->val.value;
+            const float* b = bias->val.value.memptr();
+            const size_t n = in.n_rows;
+
+            if (in.n_cols != g.input_size())
+                throw std::invalid_argument("Convolution input has " + std::to_string(in.n_cols) + " columns, expected " + std::to_string(g.input_size()) + ".");
+
+            const bool direct = algorithm == ConvAlgorithm::Direct || (algorithm == ConvAlgorithm::Auto && g.direct());
+
+            arma::Mat<float> out(n, g.output_size());
+
+            if (direct) {
+                out.zeros();
+
+                for (size_t f = 0; f < g.filters; ++f) {
+                    for (size_t oh = 0; oh < g.out_h; ++oh) {
+                        for (size_t ow = 0; ow < g.out_w; ++ow) {
+                            float* dst = out.colptr(g.output_column(f, oh * g.out_w + ow));
+
+                            for (size_t c = 0; c < g.channels; ++c) {
+                                for (size_t i = 0; i < g.kernel_h; ++i) {
+                                    for (size_t j = 0; j < g.kernel_w; ++j) {
+                                        size_t column;
+                                        if (!g.source(c, oh, ow, i, j, column)) continue;
+
+                                        const float weight = w((c * g.kernel_h + i) * g.kernel_w + j, f);
+                                        const float* src = in.colptr(column);
+
+                                        for (size_t r = 0; r < n; ++r) dst[r] += weight * src[r];
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+
+                for (size_t f = 0; f < g.filters; ++f) {
+                    for (size_t p = 0; p < g.pixels(); ++p) {
+                        activation->fused_forward(out.colptr(g.output_column(f, p)), n, b[f]);
+                    }
+                }
+            } else {
+                arma::Mat<float> cols;
+                im2col(in, g, cols);
+
+                // In NCHW the (n * P, filters) GEMM result is already the output's memory
+                if (g.layout == Layout::NCHW) {
+                    arma::Mat<float> result(out.memptr(), n * g.pixels(), g.filters, false, true);
+                    result = cols * w;
+
+                    for (size_t f = 0; f < g.filters; ++f) {
+                        activation->fused_forward(result.colptr(f), result.n_rows, b[f]);
+                    }
+                } else {
+                    arma::Mat<float> result = cols * w;
+
+                    for (size_t f = 0; f < g.filters; ++f) {
+                        for (size_t p = 0; p < g.pixels(); ++p) {
+                            float* dst = out.colptr(g.output_column(f, p));
+                            std::memcpy(dst, result.colptr(f) + n * p, n * sizeof(float));
+                            activation->fused_forward(dst, n, b[f]);
+                        }
+                    }
+                }
+            }
+
+            return std::make_shared<ConvExprNode>(Tensor<float>(std::move(out)), x, kernel, bias, g, direct, activation);
+        }
+
+    }
+
+}
@@ -0,0 +1,131 @@
+#pragma once
+#include <algorithm>
+#include <armadillo>
+
+#include <stratosml/core/autodiff/node.hpp>
+#include <stratosml/core/autodiff/nn/activations.hpp>
+
+using namespace stratos::activations;
+
+namespace stratos {
+
+    namespace autodiff {
+
+        // Bytes of output a column tile should span to stay cache resident
+        constexpr size_t dense_tile_bytes = 256 * 1024;
+
+        // activation(x * kernel + bias) as a single node.
+        // x is (n, in), kernel (in, units), bias (units, 1).
+        struct DenseExprNode : Node<float> {
+
+            NodePtr<float> x, kernel, bias;
+            const Activation* activation;
+
+            // Pre-activation values, kept only with a Sigmoid for the logits of a
+            // binary cross-entropy, see DenseLogitsExprNode
+            arma::Mat<float> logits;
+
+            DenseExprNode(Tensor<float> v, const NodePtr<float>& x, const NodePtr<float>& kernel, const NodePtr<float>& bias, const Activation* activation)
+                : Node<float>(std::move(v)), x(x), kernel(kernel), bias(bias), activation(activation) {}
+
+            // One pass over grad and the output gives both dz and the bias gradient,
+            // then a GEMM each for the kernel and input gradients.
+            void derive(const Tensor<float>& grad) override {
+                const arma::Mat<float>& out = this->val.value;
+                arma::Mat<float> dz(arma::size(out));
+                arma::Mat<float> db(out.n_cols, 1);
+
+                // Scalar gradients (the node being the loss itself) are spread over the output
+                arma::Mat<float> spread;
+                if (grad.is_scalar() && out.n_elem > 1)
+                    spread = arma::Mat<float>(arma::size(out), arma::fill::value(grad(0, 0)));
+
+                const arma::Mat<float>& g = spread.n_elem ? spread : grad.value;
+
+                for (size_t j = 0; j < out.n_cols; ++j) {
+                    db(j) = activation->fused_backward(g.colptr(j), out.colptr(j), dz.colptr(j), out.n_rows);
+                }
+
+                this->backward(dz, std::move(db));
+            }
+
+            // Gradient of the pre-activation, the activation is skipped
+            void derive_logits(const arma::Mat<float>& dz) {
+                this->backward(dz, arma::Mat<float>(arma::sum(dz, 0).t()));
+            }
+
+            std::vector<NodePtr<float>> inputs() const override { return { x, kernel, bias }; }
+
+        private:
+
+            void backward(const arma::Mat<float>& dz, arma::Mat<float>&& db) {
+                // Inputs without a gradient (e.g. the training data) skip their GEMM
+                if (requires_grad(x)) {
+                    x->derive(Tensor<float>(arma::Mat<float>(dz * kernel->val.value.t())));
+                }
+
+                kernel->derive(Tensor<float>(arma::Mat<float>(x->val.value.t() * dz)));
+                bias->derive(Tensor<float>(std::move(db)));
+            }
+        };
+
+        // The pre-activation of a DenseExprNode as a node of its own, viewing the
+        // kept logits. Gradients entering here go straight to the GEMM.
+        struct DenseLogitsExprNode : Node<float> {
+
+            std::shared_ptr<DenseExprNode> dense;
+
+            DenseLogitsExprNode(const std::shared_ptr<DenseExprNode>& dense)
+                : Node<float>(Tensor<float>(dense->logits.memptr(), TensorShape({ dense->logits.n_rows, dense->logits.n_cols }))), dense(dense) {}
+
+            void derive(const Tensor<float>& grad) override {
+                dense->derive_logits(grad.value);
+            }
+
+            std::vector<NodePtr<float>> inputs() const override { return dense->inputs(); }
+        };
+
+        // The GEMM is computed in tiles of output columns, each tile gets the bias and
+        // activation applied right after its GEMM while it is still in cache.
+        inline NodePtr<float> dense(const NodePtr<float>& x, const NodePtr<float>& kernel, const NodePtr<float>& bias, const Activation* activation) {
+            const arma::Mat<float>& in = x->val.value;
+            const arma::Mat<float>& w = kernel->val.value;
+            const float* b = bias->val.value.memptr();
+
+            arma::Mat<float> out(in.n_rows, w.n_cols), logits;
+
+            const bool keep_logits = dynamic_cast<const Sigmoid*>(activation) != nullptr;
+            if (keep_logits) logits.set_size(in.n_rows, w.n_cols);
+
+            const size_t tile = std::min<size_t>(std::max<size_t>(dense_tile_bytes / (sizeof(float) * std::max<size_t>(in.n_rows, 1)), 8), w.n_cols);
+
+            for (size_t begin = 0; begin < w.n_cols; begin += tile) {
+                const size_t cols = std::min(tile, w.n_cols - begin);
+
+                // Views over the kernel and output columns, the GEMM writes straight into out
+                const arma::Mat<float> w_tile(const_cast<float*>(w.colptr(begin)), w.n_rows, cols, false, true);
+                arma::Mat<float> out_tile(out.colptr(begin), out.n_rows, cols, false, true);
+
+                out_tile = in * w_tile;
+
+                for (size_t j = 0; j < cols; ++j) {
+                    float* column = out_tile.colptr(j);
+
+                    if (keep_logits) {
+                        float* z = logits.colptr(begin + j);
+                        for (size_t i = 0; i < out.n_rows; ++i) z[i] = column[i] + b[begin + j];
+                    }
+
+                    activation->fused_forward(column, out.n_rows, b[begin + j]);
+                }
+            }
+
+            auto node = std::make_shared<DenseExprNode>(Tensor<float>(std::move(out)), x, kernel, bias, activation);
+            node->logits = std::move(logits);
+
+            return node;
+        }
+
+    }
+
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include <armadillo>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include <stratosml/core/autodiff/node.hpp>
+
+namespace stratos {
+
+    namespace autodiff {
+
+        // Rows of a (vocabulary, dim) table looked up by the (n, k) integer indices of
+        // x, output (n, k * dim) with the k embeddings side by side. Backward writes
+        // only the looked-up rows of a sparse table's gradient.
+        struct EmbeddingExprNode : Node<float> {
+
+            NodePtr<float> x, table;
+            std::vector<uint32_t> indices;  // column-major (n, k)
+
+            EmbeddingExprNode(Tensor<float> v, const NodePtr<float>& x, const NodePtr<float>& table, std::vector<uint32_t>&& indices)
+                : Node<float>(std::move(v)), x(x), table(table), indices(std::move(indices)) {}
+
+            void derive(const Tensor<float>& grad) override {
+                const arma::Mat<float>& g = grad.value;
+                const size_t n = this->val.value.n_rows;
+                const size_t dim = table->val.value.n_cols;
+
+                if (auto sparse = std::dynamic_pointer_cast<SparseVariableNode<float>>(table)) {
+                    RowSparseGrad<float>& out = sparse->sparse_grad;
+
+                    for (size_t i = 0; i < indices.size(); ++i) {
+                        const size_t r = i % n, k = i / n;
+                        float* row = out.at(indices[i]);
+
+                        for (size_t d = 0; d < dim; ++d) row[d] += g(r, k * dim + d);
+                    }
+
+                    return;
+                }
+
+                arma::Mat<float> dt(arma::size(table->val.value), arma::fill::zeros);
+
+                for (size_t i = 0; i < indices.size(); ++i) {
+                    const size_t r = i % n, k = i / n;
+                    for (size_t d = 0; d < dim; ++d) dt(indices[i], d) += g(r, k * dim + d);
+                }
+
+                table->derive(Tensor<float>(std::move(dt)));
+            }
+
+            // The indices are not differentiable, x gets no gradient. Lookups by
+            // integer codes have no x at all.
+            std::vector<NodePtr<float>> inputs() const override {
+                if (!x) return { table };
+                return { x, table };
+            }
+        };
+
+        // Output of the (n, k) column-major indices, x is the node they came from if any
+        inline NodePtr<float> embedding_lookup(const NodePtr<float>& x, std::vector<uint32_t>&& indices, size_t n, const NodePtr<float>& table) {
+            const arma::Mat<float>& t = table->val.value;
+            const size_t dim = t.n_cols, k_count = n ? indices.size() / n : 0;
+
+            arma::Mat<float> out(n, k_count * dim);
+
+            for (size_t k = 0; k < k_count; ++k) {
+                const uint32_t* index = indices.data() + k * n;
+
+                for (size_t d = 0; d < dim; ++d) {
+                    const float* src = t.colptr(d);
+                    float* dst = out.colptr(k * dim + d);
+
+                    for (size_t r = 0; r < n; ++r) dst[r] = src[index[r]];
+                }
+            }
+
+            return std::make_shared<EmbeddingExprNode>(Tensor<float>(std::move(out)), x, table, std::move(indices));
+        }
+
+        inline NodePtr<float> embedding(const NodePtr<float>& x, const NodePtr<float>& table) {
+            const arma::Mat<float>& in = x->val.value;
+            const size_t vocabulary = table->val.value.n_rows;
+
+            std::vector<uint32_t> indices(in.n_elem);
+
+            for (size_t i = 0; i < in.n_elem; ++i) {
+                if (in(i) < 0 || in(i) >= vocabulary)
+                    throw std::invalid_argument("Embedding index " + std::to_string(in(i)) + " out of range.");
+
+                indices[i] = (uint32_t)in(i);
+            }
+
+            return embedding_lookup(x, std::move(indices), in.n_rows, table);
+        }
+
+        // Lookups straight from integer codes, e.g. of a categorical column, as
+        // (n, k) column-major indices without a float index tensor
+        inline NodePtr<float> embedding(std::vector<uint32_t>&& codes, size_t n, const NodePtr<float>& table) {
+            const size_t vocabulary = table->val.value.n_rows;
+
+            if (n == 0 || codes.size() % n != 0)
+                throw std::invalid_argument("Embedding codes do not form whole rows.");
+
+            for (uint32_t code : codes) {
+                if (code >= vocabulary)
+                    throw std::invalid_argument("Embedding index " + std::to_string(code) + " out of range.");
+            }
+
+            return embedding_lookup(nullptr, std::move(codes), n, table);
+        }
+
+    }
+
+}
@@ -1,9 +1,260 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
 #include <stratosml/core/autodiff/node.hpp>
+#include <stratosml/core/autodiff/nn/activations.hpp>
+#include <stratosml/core/autodiff/nn/dense.hpp>
 
 using namespace stratos::autodiff;
 
 namespace stratos {
 
+    namespace autodiff {
+
+        // Targets of a cross-entropy for (n, k) predictions, either one class label
+        // per row or a (n, k) matrix of target probabilities. Labels are never
+        // expanded to one-hot. Binary targets are always probabilities.
+        struct CrossEntropyTargets {
+            NodePtr<float> targets;
+            std::vector<uint32_t> labels;
+
+            CrossEntropyTargets(const NodePtr<float>& y_true, size_t n_rows, size_t n_classes, bool binary = false) {
+                const arma::Mat<float>& t = y_true->val.value;
+
+                if (t.n_rows != n_rows)
+                    throw std::invalid_argument("Cross-entropy targets must have one row per prediction.");
+
+                if (binary || t.n_cols != 1 || n_classes == 1) {
+                    if (t.n_cols != n_classes)
+                        throw std::invalid_argument("Cross-entropy targets must match the predictions shape.");
+
+                    targets = y_true;
+                    return;
+                }
+
+                labels.resize(t.n_rows);
+
+                for (size_t i = 0; i < t.n_rows; ++i) {
+                    if (!(t(i) >= 0 && t(i) < n_classes) || t(i) != std::floor(t(i)))
+                        throw std::invalid_argument("Class labels must be integers in [0, k).");
+
+                    labels[i] = (uint32_t)t(i);
+                }
+            }
+
+            float operator()(size_t row, size_t col) const {
+                return labels.empty() ? targets->val.value(row, col) : (float)(labels[row] == col);
+            }
+        };
+
+        // Softmax + categorical cross-entropy from logits. Forward keeps only the
+        // per-row logsumexp, the gradient softmax - targets is rebuilt from the logits.
+        struct SoftmaxCrossEntropyExprNode : Node<float> {
+
+            NodePtr<float> logits;
+            CrossEntropyTargets targets;
+            std::vector<float> lse;
+
+            SoftmaxCrossEntropyExprNode(Tensor<float> v, const NodePtr<float>& logits, CrossEntropyTargets&& targets, std::vector<float>&& lse)
+                : Node<float>(std::move(v)), logits(logits), targets(std::move(targets)), lse(std::move(lse)) {}
+
+            void derive(const Tensor<float>& grad) override {
+                const arma::Mat<float>& z = logits->val.value;
+                const float scale = grad(0, 0) / z.n_rows;
+                arma::Mat<float> dz(arma::size(z));
+
+                for (size_t j = 0; j < z.n_cols; ++j) {
+                    const float* in = z.colptr(j);
+                    float* out = dz.colptr(j);
+
+                    if (targets.labels.empty()) {
+                        const float* t = targets.targets->val.value.colptr(j);
+                        for (size_t i = 0; i < z.n_rows; ++i) out[i] = (std::exp(in[i] - lse[i]) - t[i]) * scale;
+                    } else {
+                        const uint32_t* label = targets.labels.data();
+                        for (size_t i = 0; i < z.n_rows; ++i) out[i] = (std::exp(in[i] - lse[i]) - (float)(label[i] == j)) * scale;
+                    }
+                }
+
+                logits->derive(Tensor<float>(std::move(dz)));
+            }
+
+            std::vector<NodePtr<float>> inputs() const override { return { logits }; }
+        };
+
+        // Sigmoid + binary cross-entropy from logits, gradient sigmoid(z) - y
+        struct SigmoidCrossEntropyExprNode : Node<float> {
+
+            NodePtr<float> logits, targets;
+
+            SigmoidCrossEntropyExprNode(Tensor<float> v, const NodePtr<float>& logits, const NodePtr<float>& targets)
+                : Node<float>(std::move(v)), logits(logits), targets(targets) {}
+
+            void derive(const Tensor<float>& grad) override {
+                const arma::Mat<float>& z = logits->val.value;
+                const float* in = z.memptr();
+                const float* y = targets->val.value.memptr();
+                const float scale = grad(0, 0) / z.n_elem;
+
+                arma::Mat<float> dz(arma::size(z));
+                float* out = dz.memptr();
+
+                for (size_t i = 0; i < z.n_elem; ++i) out[i] = (sigmoid(in[i]) - y[i]) * scale;
+
+                logits->derive(Tensor<float>(std::move(dz)));
+            }
+
+            std::vector<NodePtr<float>> inputs() const override { return { logits }; }
+        };
+
+        // Cross-entropies of probabilities that did not come straight from a
+        // softmax/sigmoid node, clamped away from log(0)
+        struct ProbabilityCrossEntropyExprNode : Node<float> {
+
+            static constexpr float epsilon = 1e-7f;
+
+            NodePtr<float> probs;
+            CrossEntropyTargets targets;
+            bool binary;
+
+            ProbabilityCrossEntropyExprNode(Tensor<float> v, const NodePtr<float>& probs, CrossEntropyTargets&& targets, bool binary)
+                : Node<float>(std::move(v)), probs(probs), targets(std::move(targets)), binary(binary) {}
+
+            void derive(const Tensor<float>& grad) override {
+                const arma::Mat<float>& p = probs->val.value;
+                const float scale = grad(0, 0) / (binary ? p.n_elem : p.n_rows);
+                arma::Mat<float> dp(arma::size(p));
+
+                for (size_t j = 0; j < p.n_cols; ++j) {
+                    for (size_t i = 0; i < p.n_rows; ++i) {
+                        const float q = std::clamp(p(i, j), epsilon, 1.0f - epsilon);
+                        const float t = targets(i, j);
+
+                        dp(i, j) = binary ? (q - t) / (q * (1.0f - q)) * scale : -t / q * scale;
+                    }
+                }
+
+                probs->derive(Tensor<float>(std::move(dp)));
+            }
+
+            std::vector<NodePtr<float>> inputs() const override { return { probs }; }
+        };
+
+        // Input of a NodeType node, looking through variable wrappers. Only returned
+        // while it still holds its value (in-place activations take it over).
+        template<typename NodeType>
+        NodePtr<float> activation_input(NodePtr<float> node) {
+            while (auto dependent = std::dynamic_pointer_cast<DependentVariableNode<float>>(node))
+                node = dependent->expr;
+
+            auto activation = std::dynamic_pointer_cast<NodeType>(node);
+
+            if (activation && activation->x->val.value.n_elem == activation->val.value.n_elem)
+                return activation->x;
+
+            return nullptr;
+        }
+
+        // Logits of predictions from a Sigmoid activation. A Dense node with the
+        // Sigmoid fused in hands out the pre-activation it kept on forward.
+        inline NodePtr<float> sigmoid_logits(NodePtr<float> node) {
+            if (auto logits = activation_input<SigmoidExprNode>(node))
+                return logits;
+
+            while (auto dependent = std::dynamic_pointer_cast<DependentVariableNode<float>>(node))
+                node = dependent->expr;
+
+            auto fused = std::dynamic_pointer_cast<DenseExprNode>(node);
+
+            if (!fused || !dynamic_cast<const Sigmoid*>(fused->activation) || fused->logits.n_elem != fused->val.value.n_elem)
+                return nullptr;
+
+            return std::make_shared<DenseLogitsExprNode>(fused);
+        }
+
+        inline NodePtr<float> softmax_cross_entropy(const NodePtr<float>& logits, const NodePtr<float>& y_true) {
+            const arma::Mat<float>& z = logits->val.value;
+            const size_t n = z.n_rows;
+
+            CrossEntropyTargets targets(y_true, n, z.n_cols);
+
+            // Online logsumexp, a single pass over the logits
+            std::vector<float> max(n, -INFINITY), lse(n, 0.0f);
+
+            for (size_t j = 0; j < z.n_cols; ++j) {
+                const float* in = z.colptr(j);
+
+                for (size_t i = 0; i < n; ++i) {
+                    if (in[i] > max[i]) {
+                        lse[i] = lse[i] * std::exp(max[i] - in[i]) + 1.0f;
+                        max[i] = in[i];
+                    } else {
+                        lse[i] += std::exp(in[i] - max[i]);
+                    }
+                }
+            }
+
+            double loss = 0;
+
+            for (size_t i = 0; i < n; ++i) {
+                lse[i] = max[i] + std::log(lse[i]);
+            }
+
+            if (targets.labels.empty()) {
+                for (size_t j = 0; j < z.n_cols; ++j) {
+                    const float* in = z.colptr(j);
+                    const float* t = y_true->val.value.colptr(j);
+                    for (size_t i = 0; i < n; ++i) loss += t[i] * (lse[i] - in[i]);
+                }
+            } else {
+                for (size_t i = 0; i < n; ++i) loss += lse[i] - z(i, targets.labels[i]);
+            }
+
+            return std::make_shared<SoftmaxCrossEntropyExprNode>(Tensor<float>((float)(loss / n)), logits, std::move(targets), std::move(lse));
+        }
+
+        inline NodePtr<float> sigmoid_cross_entropy(const NodePtr<float>& logits, const NodePtr<float>& y_true) {
+            const arma::Mat<float>& z = logits->val.value;
+            const arma::Mat<float>& y = y_true->val.value;
+
+            if (z.n_elem != y.n_elem)
+                throw std::invalid_argument("Binary cross-entropy targets must match the predictions shape.");
+
+            // max(z, 0) - z * y + log(1 + exp(-|z|)), never overflows
+            double loss = 0;
+            for (size_t i = 0; i < z.n_elem; ++i) {
+                loss += std::max(z(i), 0.0f) - z(i) * y(i) + std::log1p(std::exp(-std::abs(z(i))));
+            }
+
+            return std::make_shared<SigmoidCrossEntropyExprNode>(Tensor<float>((float)(loss / z.n_elem)), logits, y_true);
+        }
+
+        inline NodePtr<float> probability_cross_entropy(const NodePtr<float>& probs, const NodePtr<float>& y_true, bool binary) {
+            const arma::Mat<float>& p = probs->val.value;
+            const float epsilon = ProbabilityCrossEntropyExprNode::epsilon;
+
+            CrossEntropyTargets targets(y_true, p.n_rows, p.n_cols, binary);
+
+            double loss = 0;
+            for (size_t j = 0; j < p.n_cols; ++j) {
+                for (size_t i = 0; i < p.n_rows; ++i) {
+                    const float q = std::clamp(p(i, j), epsilon, 1.0f - epsilon);
+                    const float t = targets(i, j);
+
+                    loss -= binary ? t * std::log(q) + (1.0f - t) * std::log(1.0f - q) : t * std::log(q);
+                }
+            }
+
+            loss /= binary ? p.n_elem : p.n_rows;
+
+            return std::make_shared<ProbabilityCrossEntropyExprNode>(Tensor<float>((float)loss), probs, std::move(targets), binary);
+        }
+
+    }
+
     namespace losses {
 
         struct Loss {
@@ -22,8 +273,44 @@ namespace stratos {
             }
         };
 
-        struct BinaryCrossentropy : public Loss {};
-        struct CategoricalCrossentropy : public Loss {};
+        // Predictions straight from a Sigmoid activation, fused into Dense or not (or
+        // logits with from_logits), are computed with the fused, overflow-free sigmoid + cross-entropy node
+        struct BinaryCrossentropy : public Loss {
+
+            bool from_logits;
+
+            BinaryCrossentropy(bool from_logits = false) : from_logits(from_logits) {}
+
+            var operator()(const const_or_var& y_true, const const_or_var& y_pred) const override {
+                if (from_logits)
+                    return sigmoid_cross_entropy(y_pred.expr, y_true.expr);
+
+                if (auto logits = sigmoid_logits(y_pred.expr))
+                    return sigmoid_cross_entropy(logits, y_true.expr);
+
+                return probability_cross_entropy(y_pred.expr, y_true.expr, true);
+            }
+        };
+
+        // y_true holds either one integer class label per row or a row of target
+        // probabilities. Predictions straight from a SoftMax activation (or logits
+        // with from_logits) are computed with the fused softmax + cross-entropy node.
+        struct CategoricalCrossentropy : public Loss {
+
+            bool from_logits;
+
+            CategoricalCrossentropy(bool from_logits = false) : from_logits(from_logits) {}
+
+            var operator()(const const_or_var& y_true, const const_or_var& y_pred) const override {
+                if (from_logits)
+                    return softmax_cross_entropy(y_pred.expr, y_true.expr);
+
+                if (auto logits = activation_input<SoftMaxExprNode>(y_pred.expr))
+                    return softmax_cross_entropy(logits, y_true.expr);
+
+                return probability_cross_entropy(y_pred.expr, y_true.expr, false);
+            }
+        };
 
         // template<typename T>
         // Variable<T> mean_squared_error(const ConstantOrVariable<T>& y_true, const ConstantOrVariable<T>& y_pred) {
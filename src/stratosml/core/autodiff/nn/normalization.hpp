@@ -0,0 +1,249 @@
+#pragma once
+#include <armadillo>
+#include <cmath>
+#include <vector>
+
+#include <stratosml/core/autodiff/node.hpp>
+#include <stratosml/core/autodiff/nn/activations.hpp>
+
+using namespace stratos::activations;
+
+namespace stratos {
+
+    namespace autodiff {
+
+        // activation(gamma * (x - mean) / sqrt(var + epsilon) + beta) per column over
+        // the batch. Training uses the batch statistics, inference the given running
+        // ones. x is (n, features), gamma and beta (features, 1).
+        struct BatchNormExprNode : Node<float> {
+
+            NodePtr<float> x, gamma, beta;
+            std::vector<float> mean, inv_std;
+            bool training;
+            const Activation* activation;
+
+            BatchNormExprNode(Tensor<float> v, const NodePtr<float>& x, const NodePtr<float>& gamma, const NodePtr<float>& beta,
+                std::vector<float>&& mean, std::vector<float>&& inv_std, bool training, const Activation* activation)
+                : Node<float>(std::move(v)), x(x), gamma(gamma), beta(beta), mean(std::move(mean)), inv_std(std::move(inv_std)), training(training), activation(activation) {}
+
+            // Per column: dz and dbeta from the activation, dgamma with the normalized input
+            // recomputed from x, then dx in a second pass. With batch statistics
+            // dx = gamma * inv_std / n * (n * dz - dbeta - x_hat * dgamma).
+            void derive(const Tensor<float>& grad) override {
+                const arma::Mat<float>& in = x->val.value;
+                const arma::Mat<float>& out = this->val.value;
+                const float* w = gamma->val.value.memptr();
+                const size_t n = in.n_rows;
+
+                arma::Mat<float> spread;
+                if (grad.is_scalar() && out.n_elem > 1)
+                    spread = arma::Mat<float>(arma::size(out), arma::fill::value(grad(0, 0)));
+
+                const arma::Mat<float>& g = spread.n_elem ? spread : grad.value;
+
+                arma::Mat<float> dz(n, 1);
+                arma::Mat<float> dx(arma::size(in));
+                arma::Mat<float> dgamma(in.n_cols, 1), dbeta(in.n_cols, 1);
+
+                for (size_t j = 0; j < in.n_cols; ++j) {
+                    const float* col = in.colptr(j);
+                    float* d = dz.memptr();
+
+                    const float m = mean[j], s = inv_std[j];
+                    const float db = activation->fused_backward(g.colptr(j), out.colptr(j), d, n);
+
+                    float dw = 0;
+                    for (size_t r = 0; r < n; ++r) dw += d[r] * (col[r] - m) * s;
+
+                    dgamma(j) = dw;
+                    dbeta(j) = db;
+
+                    float* dcol = dx.colptr(j);
+
+                    if (training) {
+                        const float scale = w[j] * s / n;
+                        for (size_t r = 0; r < n; ++r) dcol[r] = scale * (n * d[r] - db - (col[r] - m) * s * dw);
+                    } else {
+                        const float scale = w[j] * s;
+                        for (size_t r = 0; r < n; ++r) dcol[r] = scale * d[r];
+                    }
+                }
+
+                if (requires_grad(x)) x->derive(Tensor<float>(std::move(dx)));
+
+                gamma->derive(Tensor<float>(std::move(dgamma)));
+                beta->derive(Tensor<float>(std::move(dbeta)));
+            }
+
+            std::vector<NodePtr<float>> inputs() const override { return { x, gamma, beta }; }
+        };
+
+        // Column mean and variance in one pass, accumulated in double
+        inline void column_moments(const arma::Mat<float>& x, std::vector<float>& mean, std::vector<float>& variance) {
+            mean.resize(x.n_cols);
+            variance.resize(x.n_cols);
+
+            for (size_t j = 0; j < x.n_cols; ++j) {
+                const float* col = x.colptr(j);
+                double sum = 0, sum_sq = 0;
+
+                for (size_t r = 0; r < x.n_rows; ++r) {
+                    sum += col[r];
+                    sum_sq += (double)col[r] * col[r];
+                }
+
+                const double m = sum / x.n_rows;
+                mean[j] = m;
+                variance[j] = std::max(sum_sq / x.n_rows - m * m, 0.0);
+            }
+        }
+
+        // Training normalizes with the batch statistics and returns them through
+        // batch_mean and batch_variance, inference uses the running statistics.
+        inline NodePtr<float> batch_norm(const NodePtr<float>& x, const NodePtr<float>& gamma, const NodePtr<float>& beta,
+            const arma::Mat<float>& running_mean, const arma::Mat<float>& running_variance, float epsilon, bool training,
+            const Activation* activation, std::vector<float>* batch_mean = nullptr, std::vector<float>* batch_variance = nullptr) {
+
+            const arma::Mat<float>& in = x->val.value;
+            const float* w = gamma->val.value.memptr();
+            const float* b = beta->val.value.memptr();
+
+            std::vector<float> mean, variance;
+
+            if (training) {
+                column_moments(in, mean, variance);
+            } else {
+                mean.assign(running_mean.begin(), running_mean.end());
+                variance.assign(running_variance.begin(), running_variance.end());
+            }
+
+            std::vector<float> inv_std(in.n_cols);
+            for (size_t j = 0; j < in.n_cols; ++j) inv_std[j] = 1.0f / std::sqrt(variance[j] + epsilon);
+
+            arma::Mat<float> out(arma::size(in));
+
+            for (size_t j = 0; j < in.n_cols; ++j) {
+                const float* col = in.colptr(j);
+                float* dst = out.colptr(j);
+                const float scale = w[j] * inv_std[j], shift = -mean[j] * scale;
+
+                for (size_t r = 0; r < in.n_rows; ++r) dst[r] = col[r] * scale + shift;
+
+                activation->fused_forward(dst, in.n_rows, b[j]);
+            }
+
+            if (batch_mean) *batch_mean = mean;
+            if (batch_variance) *batch_variance = std::move(variance);
+
+            return std::make_shared<BatchNormExprNode>(Tensor<float>(std::move(out)), x, gamma, beta, std::move(mean), std::move(inv_std), training, activation);
+        }
+
+        // activation(gamma * (x - mean) / sqrt(var + epsilon) + beta) per row over the
+        // features. Row statistics are accumulated column by column into per-row sums.
+        struct LayerNormExprNode : Node<float> {
+
+            NodePtr<float> x, gamma, beta;
+            std::vector<float> mean, inv_std;
+            const Activation* activation;
+
+            LayerNormExprNode(Tensor<float> v, const NodePtr<float>& x, const NodePtr<float>& gamma, const NodePtr<float>& beta,
+                std::vector<float>&& mean, std::vector<float>&& inv_std, const Activation* activation)
+                : Node<float>(std::move(v)), x(x), gamma(gamma), beta(beta), mean(std::move(mean)), inv_std(std::move(inv_std)), activation(activation) {}
+
+            // dx = inv_std / d * (d * dx_hat - sum(dx_hat) - x_hat * sum(dx_hat * x_hat))
+            // with dx_hat = dz * gamma, the row sums and the parameter gradients in one pass.
+            void derive(const Tensor<float>& grad) override {
+                const arma::Mat<float>& in = x->val.value;
+                const arma::Mat<float>& out = this->val.value;
+                const float* w = gamma->val.value.memptr();
+                const size_t n = in.n_rows, d = in.n_cols;
+
+                arma::Mat<float> spread;
+                if (grad.is_scalar() && out.n_elem > 1)
+                    spread = arma::Mat<float>(arma::size(out), arma::fill::value(grad(0, 0)));
+
+                const arma::Mat<float>& g = spread.n_elem ? spread : grad.value;
+
+                arma::Mat<float> dx(arma::size(in));
+                arma::Mat<float> dgamma(d, 1), dbeta(d, 1);
+                std::vector<float> sum(n, 0.0f), sum_hat(n, 0.0f);
+
+                // dx holds dx_hat until the second pass
+                for (size_t j = 0; j < d; ++j) {
+                    const float* col = in.colptr(j);
+                    float* dhat = dx.colptr(j);
+
+                    dbeta(j) = activation->fused_backward(g.colptr(j), out.colptr(j), dhat, n);
+
+                    float dw = 0;
+                    for (size_t r = 0; r < n; ++r) {
+                        const float x_hat = (col[r] - mean[r]) * inv_std[r];
+                        dw += dhat[r] * x_hat;
+
+                        dhat[r] *= w[j];
+                        sum[r] += dhat[r];
+                        sum_hat[r] += dhat[r] * x_hat;
+                    }
+
+                    dgamma(j) = dw;
+                }
+
+                for (size_t j = 0; j < d; ++j) {
+                    const float* col = in.colptr(j);
+                    float* dcol = dx.colptr(j);
+
+                    for (size_t r = 0; r < n; ++r) {
+                        const float x_hat = (col[r] - mean[r]) * inv_std[r];
+                        dcol[r] = inv_std[r] / d * (d * dcol[r] - sum[r] - x_hat * sum_hat[r]);
+                    }
+                }
+
+                if (requires_grad(x)) x->derive(Tensor<float>(std::move(dx)));
+
+                gamma->derive(Tensor<float>(std::move(dgamma)));
+                beta->derive(Tensor<float>(std::move(dbeta)));
+            }
+
+            std::vector<NodePtr<float>> inputs() const override { return { x, gamma, beta }; }
+        };
+
+        inline NodePtr<float> layer_norm(const NodePtr<float>& x, const NodePtr<float>& gamma, const NodePtr<float>& beta, float epsilon, const Activation* activation) {
+            const arma::Mat<float>& in = x->val.value;
+            const float* w = gamma->val.value.memptr();
+            const float* b = beta->val.value.memptr();
+            const size_t n = in.n_rows, d = in.n_cols;
+
+            std::vector<double> sum(n, 0.0), sum_sq(n, 0.0);
+
+            for (size_t j = 0; j < d; ++j) {
+                const float* col = in.colptr(j);
+                for (size_t r = 0; r < n; ++r) {
+                    sum[r] += col[r];
+                    sum_sq[r] += (double)col[r] * col[r];
+                }
+            }
+
+            std::vector<float> mean(n), inv_std(n);
+            for (size_t r = 0; r < n; ++r) {
+                const double m = sum[r] / d;
+                mean[r] = m;
+                inv_std[r] = 1.0f / std::sqrt((float)std::max(sum_sq[r] / d - m * m, 0.0) + epsilon);
+            }
+
+            arma::Mat<float> out(arma::size(in));
+
+            for (size_t j = 0; j < d; ++j) {
+                const float* col = in.colptr(j);
+                float* dst = out.colptr(j);
+
+                for (size_t r = 0; r < n; ++r) dst[r] = (col[r] - mean[r]) * inv_std[r] * w[j];
+
+                activation->fused_forward(dst, n, b[j]);
+            }
+
+            return std::make_shared<LayerNormExprNode>(Tensor<float>(std::move(out)), x, gamma, beta, std::move(mean), std::move(inv_std), activation);
+        }
+
+    }
+
+}
@@ -0,0 +1,376 @@
+#pragma once
+#include <armadillo>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include <stratosml/core/autodiff/node.hpp>
+#include <stratosml/core/autodiff/nn/activations.hpp>
+
+/*
+ *
+ * RECURRENT - LSTM and GRU over batches of flattened sequences
+ *
+ * x is (n, steps * features), step-major: the features of step t are columns
+ * t * features to (t + 1) * features. The input projection of all steps is a
+ * single GEMM up front, each step then runs one GEMM of the previous hidden
+ * state against the recurrent weights of all gates, followed by one fused
+ * loop computing every gate and the new state.
+ *
+ * Truncated BPTT splits the sequence into chunks of bptt steps. Gradients do
+ * not cross chunk boundaries, so only the state entering each chunk is kept;
+ * a chunk's gate activations are recomputed into the workspace on backward.
+ *
+ */
+
+namespace stratos {
+
+    namespace autodiff {
+
+        // (rows, width) view of block index of a matrix made of equal column blocks
+        inline arma::Mat<float> block(arma::Mat<float>& m, size_t index, size_t width) {
+            return arma::Mat<float>(m.colptr(index * width), m.n_rows, width, false, true);
+        }
+
+        // Buffers of one chunk, allocated once per sequence batch and reused by every chunk
+        struct RecurrentWorkspace {
+            arma::Mat<float> h;         // (n, (bptt + 1) * units) hidden states, block 0 enters the chunk
+            arma::Mat<float> c;         // (n, (bptt + 1) * units) LSTM cell states
+            arma::Mat<float> gates;     // (n, bptt * gates * units) gate activations
+            arma::Mat<float> hn;        // (n, bptt * units) GRU recurrent candidate term
+            arma::Mat<float> gh;        // (n, gates * units) recurrent projection of a step
+            arma::Mat<float> dah;       // (n, gates * units) recurrent pre-activation gradients of a step
+        };
+
+        struct RecurrentExprNode : Node<float> {
+
+            NodePtr<float> x, kernel, recurrent_kernel, bias, recurrent_bias;
+
+            size_t steps, features, units, n_gates;
+            size_t bptt;
+            bool return_sequences;
+
+            arma::Mat<float> gx;                    // (n * steps, gates * units) input projection, row r + n * t
+            std::vector<arma::Mat<float>> h0, c0;   // states entering each chunk
+            RecurrentWorkspace ws;
+            size_t cached = SIZE_MAX;               // chunk held by the workspace
+
+            RecurrentExprNode(const NodePtr<float>& x, const NodePtr<float>& kernel, const NodePtr<float>& recurrent_kernel, const NodePtr<float>& bias,
+                const NodePtr<float>& recurrent_bias, size_t steps, size_t n_gates, size_t bptt, bool return_sequences)
+                : Node<float>(Tensor<float>()), x(x), kernel(kernel), recurrent_kernel(recurrent_kernel), bias(bias), recurrent_bias(recurrent_bias),
+                  steps(steps), units(recurrent_kernel->val.value.n_rows), n_gates(n_gates), bptt(bptt && bptt < steps ? bptt : steps), return_sequences(return_sequences) {
+
+                if (steps < 1 || x->val.value.n_cols % steps)
+                    throw std::invalid_argument("Recurrent input columns are not a multiple of the sequence length.");
+
+                features = x->val.value.n_cols / steps;
+            }
+
+            size_t rows() const { return x->val.value.n_rows; }
+            size_t chunks() const { return (steps + bptt - 1) / bptt; }
+
+            // Pre-activation column pointers of gate k of unit j at step t
+            const float* input_gate(size_t k, size_t j, size_t t) const { return gx.colptr(k * units + j) + rows() * t; }
+            const float* recurrent_gate(size_t k, size_t j) const { return ws.gh.colptr(k * units + j); }
+            float* gate(size_t k, size_t j, size_t s) { return ws.gates.colptr((s * n_gates + k) * units + j); }
+
+            // Computes the gates and state of step t, local step s of the workspace chunk
+            virtual void step_forward(size_t t, size_t s) = 0;
+
+            // Pre-activation gradients of step t from the gradient of its hidden state dh.
+            // Writes the input side into dgx and the recurrent side into ws.dah, dc carries
+            // the cell state gradient and dh_prev receives the gradient not passing through
+            // the recurrent weights.
+            virtual void step_backward(size_t t, size_t s, const arma::Mat<float>& dh, arma::Mat<float>& dc, arma::Mat<float>& dgx, arma::Mat<float>& dh_prev) = 0;
+
+            // (n * steps, features) stack of the steps, row r + n * t
+            arma::Mat<float> stack_steps() const {
+                const arma::Mat<float>& in = x->val.value;
+                const size_t n = rows();
+                arma::Mat<float> xs(n * steps, features);
+
+                for (size_t t = 0; t < steps; ++t)
+                    for (size_t f = 0; f < features; ++f)
+                        std::memcpy(xs.colptr(f) + n * t, in.colptr(t * features + f), n * sizeof(float));
+
+                return xs;
+            }
+
+            void run_chunk(size_t chunk) {
+                const size_t t0 = chunk * bptt, length = std::min(bptt, steps - t0);
+                const arma::Mat<float>& wh = recurrent_kernel->val.value;
+
+                block(ws.h, 0, units) = h0[chunk];
+                if (ws.c.n_elem) block(ws.c, 0, units) = c0[chunk];
+
+                for (size_t s = 0; s < length; ++s) {
+                    ws.gh = block(ws.h, s, units) * wh;
+
+                    if (recurrent_bias)
+                        ws.gh.each_row() += recurrent_bias->val.value.t();
+
+                    step_forward(t0 + s, s);
+                }
+
+                cached = chunk;
+            }
+
+            void forward() {
+                const size_t n = rows(), width = n_gates * units;
+
+                gx = stack_steps() * kernel->val.value;
+
+                ws.h.set_size(n, (bptt + 1) * units);
+                ws.gates.set_size(n, bptt * width);
+                ws.gh.set_size(n, width);
+
+                this->val.value.set_size(n, return_sequences ? steps * units : units);
+
+                h0.assign(chunks(), arma::Mat<float>());
+                c0.assign(chunks(), arma::Mat<float>());
+
+                for (size_t chunk = 0; chunk < chunks(); ++chunk) {
+                    const size_t t0 = chunk * bptt, length = std::min(bptt, steps - t0);
+
+                    h0[chunk] = chunk ? arma::Mat<float>(block(ws.h, bptt, units)) : arma::Mat<float>(n, units, arma::fill::zeros);
+                    if (ws.c.n_elem) c0[chunk] = chunk ? arma::Mat<float>(block(ws.c, bptt, units)) : arma::Mat<float>(n, units, arma::fill::zeros);
+
+                    run_chunk(chunk);
+
+                    if (return_sequences) {
+                        for (size_t s = 0; s < length; ++s)
+                            std::memcpy(this->val.value.colptr((t0 + s) * units), ws.h.colptr((s + 1) * units), n * units * sizeof(float));
+                    } else if (chunk + 1 == chunks()) {
+                        std::memcpy(this->val.value.memptr(), ws.h.colptr(length * units), n * units * sizeof(float));
+                    }
+                }
+
+                this->val.shape = { this->val.value.n_rows, this->val.value.n_cols };
+            }
+
+            void derive(const Tensor<float>& grad) override {
+                const size_t n = rows(), width = n_gates * units;
+                const arma::Mat<float>& wh = recurrent_kernel->val.value;
+
+                arma::Mat<float> spread;
+                if (grad.is_scalar() && this->val.value.n_elem > 1)
+                    spread = arma::Mat<float>(arma::size(this->val.value), arma::fill::value(grad(0, 0)));
+
+                arma::Mat<float>& g = spread.n_elem ? spread : const_cast<arma::Mat<float>&>(grad.value);
+
+                arma::Mat<float> dgx(n * steps, width, arma::fill::zeros);
+                arma::Mat<float> dwh(arma::size(wh), arma::fill::zeros);
+                arma::Mat<float> drb(width, 1, arma::fill::zeros);
+                arma::Mat<float> dh(n, units), dh_prev(n, units), dc(n, units);
+
+                ws.dah.set_size(n, width);
+
+                for (size_t chunk = chunks(); chunk-- > 0;) {
+                    const size_t t0 = chunk * bptt, length = std::min(bptt, steps - t0);
+
+                    // Only the last step is an output, earlier chunks get no gradient
+                    if (!return_sequences && chunk + 1 != chunks()) break;
+
+                    if (cached != chunk) run_chunk(chunk);
+
+                    dh_prev.zeros();
+                    dc.zeros();
+
+                    for (size_t s = length; s-- > 0;) {
+                        const size_t t = t0 + s;
+
+                        dh = dh_prev;
+                        if (return_sequences) dh += block(g, t, units);
+                        else if (t + 1 == steps) dh += g;
+
+                        step_backward(t, s, dh, dc, dgx, dh_prev);
+
+                        dwh += block(ws.h, s, units).t() * ws.dah;
+                        if (recurrent_bias) drb += arma::sum(ws.dah, 0).t();
+
+                        dh_prev += ws.dah * wh.t();
+                    }
+                }
+
+                recurrent_kernel->derive(Tensor<float>(std::move(dwh)));
+                if (recurrent_bias) recurrent_bias->derive(Tensor<float>(std::move(drb)));
+
+                bias->derive(Tensor<float>(arma::Mat<float>(arma::sum(dgx, 0).t())));
+
+                arma::Mat<float> xs = stack_steps();
+                kernel->derive(Tensor<float>(arma::Mat<float>(xs.t() * dgx)));
+
+                if (requires_grad(x)) {
+                    xs = dgx * kernel->val.value.t();
+                    arma::Mat<float> dx(n, steps * features);
+
+                    for (size_t t = 0; t < steps; ++t)
+                        for (size_t f = 0; f < features; ++f)
+                            std::memcpy(dx.colptr(t * features + f), xs.colptr(f) + n * t, n * sizeof(float));
+
+                    x->derive(Tensor<float>(std::move(dx)));
+                }
+            }
+
+            std::vector<NodePtr<float>> inputs() const override {
+                if (recurrent_bias) return { x, kernel, recurrent_kernel, bias, recurrent_bias };
+                return { x, kernel, recurrent_kernel, bias };
+            }
+        };
+
+        // Gates i, f, g, o: c = f * c_prev + i * g, h = o * tanh(c)
+        struct LSTMExprNode : RecurrentExprNode {
+
+            LSTMExprNode(const NodePtr<float>& x, const NodePtr<float>& kernel, const NodePtr<float>& recurrent_kernel, const NodePtr<float>& bias,
+                size_t steps, size_t bptt, bool return_sequences)
+                : RecurrentExprNode(x, kernel, recurrent_kernel, bias, nullptr, steps, 4, bptt, return_sequences) {}
+
+            void step_forward(size_t t, size_t s) override {
+                const size_t n = rows();
+                const float* b = bias->val.value.memptr();
+
+                for (size_t j = 0; j < units; ++j) {
+                    const float *xi = input_gate(0, j, t), *xf = input_gate(1, j, t), *xg = input_gate(2, j, t), *xo = input_gate(3, j, t);
+                    const float *hi = recurrent_gate(0, j), *hf = recurrent_gate(1, j), *hg = recurrent_gate(2, j), *ho = recurrent_gate(3, j);
+                    const float bi = b[j], bf = b[units + j], bg = b[2 * units + j], bo = b[3 * units + j];
+
+                    float *gi = gate(0, j, s), *gf = gate(1, j, s), *gg = gate(2, j, s), *go = gate(3, j, s);
+                    const float* c_prev = ws.c.colptr(s * units + j);
+                    float* c = ws.c.colptr((s + 1) * units + j);
+                    float* h = ws.h.colptr((s + 1) * units + j);
+
+                    for (size_t r = 0; r < n; ++r) {
+                        gi[r] = sigmoid(xi[r] + hi[r] + bi);
+                        gf[r] = sigmoid(xf[r] + hf[r] + bf);
+                        gg[r] = std::tanh(xg[r] + hg[r] + bg);
+                        go[r] = sigmoid(xo[r] + ho[r] + bo);
+
+                        c[r] = gf[r] * c_prev[r] + gi[r] * gg[r];
+                        h[r] = go[r] * std::tanh(c[r]);
+                    }
+                }
+            }
+
+            void step_backward(size_t t, size_t s, const arma::Mat<float>& dh, arma::Mat<float>& dc, arma::Mat<float>& dgx, arma::Mat<float>& dh_prev) override {
+                const size_t n = rows();
+
+                for (size_t j = 0; j < units; ++j) {
+                    const float *gi = gate(0, j, s), *gf = gate(1, j, s), *gg = gate(2, j, s), *go = gate(3, j, s);
+                    const float* c_prev = ws.c.colptr(s * units + j);
+                    const float* c = ws.c.colptr((s + 1) * units + j);
+                    const float* d = dh.colptr(j);
+                    float* dcj = dc.colptr(j);
+
+                    float *ai = ws.dah.colptr(j), *af = ws.dah.colptr(units + j), *ag = ws.dah.colptr(2 * units + j), *ao = ws.dah.colptr(3 * units + j);
+
+                    for (size_t r = 0; r < n; ++r) {
+                        const float tc = std::tanh(c[r]);
+                        const float dct = dcj[r] + d[r] * go[r] * (1.0f - tc * tc);
+
+                        ai[r] = dct * gg[r] * gi[r] * (1.0f - gi[r]);
+                        af[r] = dct * c_prev[r] * gf[r] * (1.0f - gf[r]);
+                        ag[r] = dct * gi[r] * (1.0f - gg[r] * gg[r]);
+                        ao[r] = d[r] * tc * go[r] * (1.0f - go[r]);
+
+                        dcj[r] = dct * gf[r];
+                    }
+
+                    for (size_t k = 0; k < 4; ++k)
+                        std::memcpy(dgx.colptr(k * units + j) + n * t, ws.dah.colptr(k * units + j), n * sizeof(float));
+                }
+
+                dh_prev.zeros();
+            }
+        };
+
+        // Gates r, z, n with the reset gate applied after the recurrent GEMM, so one
+        // GEMM serves all three: n = tanh(x_n + r * (h_prev * W_n + b_n)),
+        // h = (1 - z) * n + z * h_prev
+        struct GRUExprNode : RecurrentExprNode {
+
+            GRUExprNode(const NodePtr<float>& x, const NodePtr<float>& kernel, const NodePtr<float>& recurrent_kernel, const NodePtr<float>& bias,
+                const NodePtr<float>& recurrent_bias, size_t steps, size_t bptt, bool return_sequences)
+                : RecurrentExprNode(x, kernel, recurrent_kernel, bias, recurrent_bias, steps, 3, bptt, return_sequences) {}
+
+            void step_forward(size_t t, size_t s) override {
+                const size_t n = rows();
+                const float* b = bias->val.value.memptr();
+
+                for (size_t j = 0; j < units; ++j) {
+                    const float *xr = input_gate(0, j, t), *xz = input_gate(1, j, t), *xn = input_gate(2, j, t);
+                    const float *hr = recurrent_gate(0, j), *hz = recurrent_gate(1, j), *hn = recurrent_gate(2, j);
+                    const float br = b[j], bz = b[units + j], bn = b[2 * units + j];
+
+                    float *gr = gate(0, j, s), *gz = gate(1, j, s), *gn = gate(2, j, s);
+                    float* hn_saved = ws.hn.colptr(s * units + j);
+                    const float* h_prev = ws.h.colptr(s * units + j);
+                    float* h = ws.h.colptr((s + 1) * units + j);
+
+                    for (size_t r = 0; r < n; ++r) {
+                        gr[r] = sigmoid(xr[r] + hr[r] + br);
+                        gz[r] = sigmoid(xz[r] + hz[r] + bz);
+                        gn[r] = std::tanh(xn[r] + bn + gr[r] * hn[r]);
+                        hn_saved[r] = hn[r];
+
+                        h[r] = (1.0f - gz[r]) * gn[r] + gz[r] * h_prev[r];
+                    }
+                }
+            }
+
+            void step_backward(size_t t, size_t s, const arma::Mat<float>& dh, arma::Mat<float>&, arma::Mat<float>& dgx, arma::Mat<float>& dh_prev) override {
+                const size_t n = rows();
+
+                for (size_t j = 0; j < units; ++j) {
+                    const float *gr = gate(0, j, s), *gz = gate(1, j, s), *gn = gate(2, j, s);
+                    const float* hn = ws.hn.colptr(s * units + j);
+                    const float* h_prev = ws.h.colptr(s * units + j);
+                    const float* d = dh.colptr(j);
+
+                    float *ar = ws.dah.colptr(j), *az = ws.dah.colptr(units + j), *ahn = ws.dah.colptr(2 * units + j);
+                    float* xn = dgx.colptr(2 * units + j) + n * t;
+                    float* direct = dh_prev.colptr(j);
+
+                    for (size_t r = 0; r < n; ++r) {
+                        const float an = d[r] * (1.0f - gz[r]) * (1.0f - gn[r] * gn[r]);
+                        const float dz = d[r] * (h_prev[r] - gn[r]);
+
+                        ar[r] = an * hn[r] * gr[r] * (1.0f - gr[r]);
+                        az[r] = dz * gz[r] * (1.0f - gz[r]);
+                        ahn[r] = an * gr[r];
+                        xn[r] = an;
+
+                        direct[r] = d[r] * gz[r];
+                    }
+
+                    std::memcpy(dgx.colptr(j) + n * t, ar, n * sizeof(float));
+                    std::memcpy(dgx.colptr(units + j) + n * t, az, n * sizeof(float));
+                }
+            }
+        };
+
+        inline NodePtr<float> lstm(const NodePtr<float>& x, const NodePtr<float>& kernel, const NodePtr<float>& recurrent_kernel, const NodePtr<float>& bias,
+            size_t steps, size_t bptt = 0, bool return_sequences = false) {
+
+            auto node = std::make_shared<LSTMExprNode>(x, kernel, recurrent_kernel, bias, steps, bptt, return_sequences);
+
+            node->ws.c.set_size(x->val.value.n_rows, (node->bptt + 1) * node->units);
+            node->forward();
+
+            return node;
+        }
+
+        inline NodePtr<float> gru(const NodePtr<float>& x, const NodePtr<float>& kernel, const NodePtr<float>& recurrent_kernel, const NodePtr<float>& bias,
+            const NodePtr<float>& recurrent_bias, size_t steps, size_t bptt = 0, bool return_sequences = false) {
+
+            auto node = std::make_shared<GRUExprNode>(x, kernel, recurrent_kernel, bias, recurrent_bias, steps, bptt, return_sequences);
+
+            node->ws.hn.set_size(x->val.value.n_rows, node->bptt * node->units);
+            node->forward();
+
+            return node;
+        }
+
+    }
+
+}
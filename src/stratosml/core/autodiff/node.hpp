@@ -1,5 +1,9 @@
 #pragma once
 
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
 #include <stratosml/core/autodiff/tensor.hpp>
 
 namespace stratos {
@@ -14,7 +18,16 @@ namespace stratos {
 
             Node(const Tensor<T>& v) : val(v) {}
 
+            Node(Tensor<T>&& v) : val(std::move(v)) {}
+
             virtual void derive(const Tensor<T>&) = 0;
+
+            // Nodes this node was computed from
+            virtual std::vector<std::shared_ptr<Node<T>>> inputs() const { return {}; }
+
+            // Whether derive() reads this node's own value. If not, a consumer computing
+            // in place may take the value over.
+            virtual bool needs_value() const { return true; }
         };
 
         template<typename T>
@@ -29,6 +42,10 @@ namespace stratos {
             VariableNode(const Tensor<T>& v) : Node<T>(v) {
                 grad = Tensor<T>(v, arma::fill::zeros);
             }
+
+            virtual void scale_grad(T factor) { grad.value *= factor; }
+
+            virtual void zero_grad() { grad.value.zeros(); }
         };
 
         // Node with gradient and without ancestors.
@@ -44,6 +61,75 @@ namespace stratos {
             }
         };
 
+        // Gradient of a parameter of which only some rows are used per step, e.g. an
+        // embedding table. Rows are stored once each, in the order they were first hit.
+        template<typename T>
+        struct RowSparseGrad {
+            size_t cols = 0;
+            std::vector<uint32_t> rows;     // parameter row of every gradient row
+            std::vector<T> values;          // gradient rows, cols values each
+            std::vector<int32_t> slot;      // position of a parameter row in rows, -1 if absent
+
+            RowSparseGrad() {}
+            RowSparseGrad(size_t n_rows, size_t cols) : cols(cols), slot(n_rows, -1) {}
+
+            size_t size() const { return rows.size(); }
+
+            T* row(size_t i) { return values.data() + i * cols; }
+            const T* row(size_t i) const { return values.data() + i * cols; }
+
+            // Gradient row of a parameter row, zero-initialized the first time
+            T* at(uint32_t row) {
+                if (slot[row] < 0) {
+                    slot[row] = (int32_t)rows.size();
+                    rows.push_back(row);
+                    values.resize(values.size() + cols, T(0));
+                }
+
+                return this->row(slot[row]);
+            }
+
+            // Only the rows that were hit are reset
+            void clear() {
+                for (uint32_t row : rows) slot[row] = -1;
+                rows.clear();
+                values.clear();
+            }
+        };
+
+        // Parameter with a row-sparse gradient, the dense grad is never allocated.
+        // Optimizers update only the rows the gradient holds.
+        template<typename T>
+        struct SparseVariableNode : IndependentVariableNode<T> {
+
+            RowSparseGrad<T> sparse_grad;
+
+            SparseVariableNode(const Tensor<T>& v) : IndependentVariableNode<T>(v), sparse_grad(v.value.n_rows, v.value.n_cols) {
+                this->grad.value.reset();
+            }
+
+            // Dense gradients (the table used outside a lookup) add every non-zero row
+            void derive(const Tensor<T>& grad) override {
+                const arma::Mat<T>& g = grad.value;
+
+                for (size_t r = 0; r < g.n_rows; ++r) {
+                    size_t c = 0;
+                    while (c < g.n_cols && g(r, c) == T(0)) ++c;
+
+                    if (c == g.n_cols) continue;
+
+                    T* out = sparse_grad.at(r);
+                    for (c = 0; c < g.n_cols; ++c) out[c] += g(r, c);
+                }
+            }
+
+            void scale_grad(T factor) override {
+                for (T& value : sparse_grad.values) value *= factor;
+            }
+
+            void zero_grad() override { sparse_grad.clear(); }
+        };
+
         // Node with gradient and with ancestors.
         template<typename T>
         struct DependentVariableNode : VariableNode<T> {
@@ -58,6 +144,10 @@ namespace stratos {
                 this->grad += grad;
                 this->expr->derive(grad);
             }
+
+            std::vector<NodePtr<T>> inputs() const override { return { expr }; }
+
+            bool needs_value() const override { return false; }
         };
 
         /// Constant node i.e. without gradient
@@ -69,6 +159,19 @@ namespace stratos {
             void derive(const Tensor<T>& grad) override {}
         };
 
+        // Whether a gradient passed to the node can reach any variable, constants
+        // wrapped into variables (e.g. the model inputs) cannot.
+        template<typename T>
+        bool requires_grad(const NodePtr<T>& node) {
+            if (std::dynamic_pointer_cast<ConstantNode<T>>(node))
+                return false;
+
+            if (auto dependent = std::dynamic_pointer_cast<DependentVariableNode<T>>(node))
+                return requires_grad(dependent->expr);
+
+            return true;
+        }
+
         template<typename T> class Variable;
         template<typename T> class Constant;
 
@@ -101,6 +204,9 @@ namespace stratos {
 
             Constant(const Tensor<T>& x) : ConstantOrVariable<T>(std::make_shared<ConstantNode<T>>(x)) {}
 
+            // Takes the tensor over, a view stays a view of the same memory
+            Constant(Tensor<T>&& x) : ConstantOrVariable<T>(std::make_shared<ConstantNode<T>>(std::move(x))) {}
+
             Constant(std::initializer_list<T> v) : ConstantOrVariable<T>(std::make_shared<ConstantNode<T>>(Tensor(v))) {}
 
             Constant(std::initializer_list<std::initializer_list<T>> v) : ConstantOrVariable<T>(std::make_shared<ConstantNode<T>>(Tensor(v))) {}
@@ -13,14 +13,18 @@ namespace stratos {
         struct UnaryExprNode : Node<T> {
             NodePtr<T> x;
 
-            UnaryExprNode(const Tensor<T>& v, const NodePtr<T>& x) : Node<T>(v), x(x) {}
+            UnaryExprNode(Tensor<T> v, const NodePtr<T>& x) : Node<T>(std::move(v)), x(x) {}
+
+            std::vector<NodePtr<T>> inputs() const override { return { x }; }
         };
 
         template<typename T>
         struct BinaryExprNode : Node<T> {
             NodePtr<T> l, r;
 
-            BinaryExprNode(const Tensor<T>& v, const NodePtr<T>& l, const NodePtr<T>& r) : Node<T>(v), l(l), r(r) {}
+            BinaryExprNode(Tensor<T> v, const NodePtr<T>& l, const NodePtr<T>& r) : Node<T>(std::move(v)), l(l), r(r) {}
+
+            std::vector<NodePtr<T>> inputs() const override { return { l, r }; }
         };
         
         template<typename T>
@@ -34,6 +38,8 @@ namespace stratos {
                 l->derive(grad);
                 r->derive(grad);
             }
+
+            bool needs_value() const override { return false; }
         };
 
         template<typename T>
@@ -47,6 +53,8 @@ namespace stratos {
                 l->derive(grad);
                 r->derive(-grad);
             }
+
+            bool needs_value() const override { return false; }
         };
 
         template<typename T>
@@ -57,8 +65,21 @@ namespace stratos {
             using BinaryExprNode<T>::BinaryExprNode;
 
             void derive(const Tensor<T>& grad) override {
-                l->derive(grad * r->val);
-                r->derive(grad * l->val);
+                l->derive(grad % r->val);
+                r->derive(grad % l->val);
+            }
+        };
+
+        template<typename T>
+        struct MatMulExprNode : BinaryExprNode<T> {
+
+            using BinaryExprNode<T>::l;
+            using BinaryExprNode<T>::r;
+            using BinaryExprNode<T>::BinaryExprNode;
+
+            void derive(const Tensor<T>& grad) override {
+                l->derive(grad * r->val.t());
+                r->derive(l->val.t() * grad);
             }
         };
 
@@ -102,13 +123,17 @@ namespace stratos {
             using BinaryExprNode<T>::BinaryExprNode;
 
             void derive(const Tensor<T>& grad) override {
-                const auto aux = grad * pow(l->val, r->val - 1); // grad * l^(r-1)
-                l->derive(aux * r->val);
+                const auto aux = grad % pow(l->val, r->val - 1); // grad * l^(r-1)
+                l->derive(aux % r->val);
+
+                // Constant exponents (e.g. squares in losses) have no gradient
+                if (std::dynamic_pointer_cast<ConstantNode<T>>(r)) return;
+
                 // cout << "l->val" << l->val << endl;
                 // cout << "log(l->val)" << log(l->val) << endl;
                 const auto auxr = l->val % log(l->val); // l*log(l)
                 // cout << auxr << endl;
-                r->derive(aux * auxr); // grad * l^(r)*log(l)
+                r->derive(aux % auxr); // grad * l^(r)*log(l)
             }
 
         };
@@ -119,8 +144,9 @@ namespace stratos {
             using UnaryExprNode<T>::x;
             using UnaryExprNode<T>::UnaryExprNode;
 
+            // Column means, every element gets 1/n_rows of its column gradient
             void derive(const Tensor<T>& grad) override {
-                x->derive(grad);
+                x->derive(grad / (T)x->val.value.n_rows);
             }
         };  
 
@@ -238,7 +264,7 @@ namespace stratos {
         /// Non Element-wise Operations
         /// ---------------------------
 
-        template<typename T> NodePtr<T> operator*(const NodePtr<T>& l, const NodePtr<T>& r) { return std::make_shared<MulExprNode<T>>(l->val * r->val, l, r); }
+        template<typename T> NodePtr<T> operator*(const NodePtr<T>& l, const NodePtr<T>& r) { return std::make_shared<MatMulExprNode<T>>(l->val * r->val, l, r); }
 
         template<typename T> NodePtr<T> operator*(const ConstantOrVariable<T>& l, const ConstantOrVariable<T>& r) { return l.expr * r.expr; }
         template<typename T> NodePtr<T> operator*(const NodePtr<T>& l, const ConstantOrVariable<T>& r) { return l * r.expr; }
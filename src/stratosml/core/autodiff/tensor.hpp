@@ -25,6 +25,7 @@ namespace stratos {
 
             TensorShape() {}
             TensorShape(const TensorShape& other) : dims(other.dims) {}
+            TensorShape& operator=(const TensorShape& other) = default;
 
             TensorShape(std::initializer_list<size_t> dims) : dims(dims) {}
 
@@ -32,6 +33,13 @@ namespace stratos {
                 return dims.size();
             }
 
+            // Number of elements, the product of all dimensions
+            size_t size() const {
+                size_t n = 1;
+                for (size_t dim : dims) n *= dim;
+                return n;
+            }
+
             const size_t operator[](size_t dim) const {
                 return dims[dim];
             }
@@ -51,12 +59,14 @@ namespace stratos {
             Tensor() {}
 
             Tensor(const TensorShape& shape) {
-                value = mat<T>(shape[0], shape[1] || 1);
+                value = mat<T>(shape[0], shape.dims.size() > 1 ? shape[1] : 1);
                 this->shape = shape;
             }
 
             Tensor(const Tensor<T>& tensor): value(tensor.value), shape(tensor.shape) {}
 
+            Tensor(Tensor<T>&& tensor) noexcept : value(std::move(tensor.value)), shape(tensor.shape) {}
+
             template<typename FillForm>
             Tensor(const arma::SizeMat& size, const arma::fill::fill_class<FillForm> fill_form) {
                 shape = { size.n_rows, size.n_cols };
@@ -78,7 +88,13 @@ namespace stratos {
                 shape = {value.n_rows, value.n_cols};
             }
 
-            Tensor(arma::Mat<T> matrix): value(matrix), shape{matrix.n_rows, matrix.n_cols} {}
+            Tensor(arma::Mat<T> matrix): value(std::move(matrix)), shape{matrix.n_rows, matrix.n_cols} {}
+
+            // View over memory owned elsewhere (a DataFrame block, a mapped file).
+            // Writes go through to the memory and the size is fixed; copies are deep,
+            // moves keep viewing the same memory.
+            Tensor(T* memory, const TensorShape& shape)
+                : shape(shape), value(memory, shape[0], shape.dims.size() > 1 ? shape[1] : 1, false, true) {}
 
             ~Tensor() {
                 // vector.~Col();
@@ -90,6 +106,12 @@ namespace stratos {
                 return *this;
             }
 
+            Tensor<T>& operator=(Tensor<T>&& other) noexcept {
+                this->shape = other.shape;
+                this->value = std::move(other.value);
+                return *this;
+            }
+
             bool is_scalar() const {
                 return value.n_cols == 1 && value.n_rows == 1;
             }
@@ -114,7 +136,7 @@ namespace stratos {
             /// Arma Methods
             /// ------------
 
-            Tensor<T> t() {
+            Tensor<T> t() const {
                 return Tensor<T>(this->value.t());
             }
 
@@ -138,11 +160,11 @@ namespace stratos {
                 return this->value;
             }
 
-            T min() {
+            T min() const {
                 return this->value.min();
             }
 
-            T max() {
+            T max() const {
                 return this->value.max();
             }
 
@@ -188,6 +210,11 @@ namespace stratos {
                 if (this->is_row_vector() && this->value.n_cols == t.value.n_rows) {
                     return arma::sum(t.value, 1).t();
                 }
+
+                // Column vector broadcast over the rows of t (e.g. a bias), reduce over the rows
+                if (this->is_col_vector() && this->value.n_rows == t.value.n_cols && t.value.n_rows != this->value.n_rows) {
+                    return arma::sum(t.value, 0).t();
+                }
                 
                 return t;
 
@@ -230,6 +257,11 @@ namespace stratos {
                 t2_broadcasted = t2_broadcasted.t();
             }
 
+            // Row vector against every row of t1
+            if (t2_broadcasted.n_rows == 1 && t1.value.n_rows > 1 && t2_broadcasted.n_cols == t1.value.n_cols) {
+                t2_broadcasted = arma::repmat(t2_broadcasted, t1.value.n_rows, 1);
+            }
+
             // if (t2.is_col_vector()) {
             //     cout << "t2 col vector\n";
             //     t2_broadcasted = arma::repmat(t2_broadcasted, 1, t1.value.n_cols);
@@ -0,0 +1,80 @@
+#pragma once
+#include <armadillo>
+#include <vector>
+#include <numeric>
+#include <random>
+#include <algorithm>
+
+#include <stratosml/core/autodiff/tensor.hpp>
+
+using namespace stratos::autodiff;
+
+namespace stratos {
+    namespace data {
+
+        // Walks a dataset in mini-batches through a permutation index.
+        // Shuffling only permutes the index, rows are never moved.
+        class BatchSampler {
+
+            std::vector<size_t> index;
+            size_t batch_size;
+            std::mt19937_64 rng;
+
+        public:
+
+            BatchSampler(size_t n_rows, size_t batch_size, size_t seed = std::random_device{}())
+                : index(n_rows), batch_size(batch_size), rng(seed) {
+                if (batch_size < 1)
+                    throw std::invalid_argument("Batch size should be bigger than zero.");
+
+                std::iota(index.begin(), index.end(), 0);
+            }
+
+            void Shuffle() {
+                std::shuffle(index.begin(), index.end(), this->rng);
+            }
+
+            size_t GetSize() const {
+                return index.size();
+            }
+
+            size_t GetBatchSize() const {
+                return batch_size;
+            }
+
+            size_t GetBatchCount() const {
+                return (index.size() + batch_size - 1) / batch_size;
+            }
+
+            // Row indices of the batch, the last batch may be partial.
+            const size_t* Batch(size_t batch, size_t& count) const {
+                const size_t begin = batch * batch_size;
+                count = std::min(batch_size, index.size() - begin);
+                return index.data() + begin;
+            }
+        };
+
+        // Copies the given rows of src into dst, column by column.
+        // dst keeps its allocation between calls, so refilling a batch buffer
+        // (or shrinking it for the last batch) does not reallocate.
+        template<typename T>
+        void GatherRows(const Tensor<T>& src, const size_t* rows, size_t count, Tensor<T>& dst) {
+            const arma::Mat<T>& from = src.value;
+            arma::Mat<T>& to = dst.value;
+
+            to.set_size(count, from.n_cols);
+
+            for (size_t col = 0; col < from.n_cols; ++col) {
+                const T* in = from.colptr(col);
+                T* out = to.colptr(col);
+
+                for (size_t i = 0; i < count; ++i) {
+                    out[i] = in[rows[i]];
+                }
+            }
+
+            dst.shape = { count, from.n_cols };
+        }
+
+    }
+}
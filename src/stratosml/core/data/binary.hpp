@@ -0,0 +1,277 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <stratosml/core/data/data.hpp>
+#include <stratosml/core/data/mmap.hpp>
+
+/*
+ *
+ * BINARY - Memory mapped columnar DataFrame files (.stratos)
+ *
+ * Layout, little endian:
+ *
+ *   BinaryHeader                       magic, version, column count, rows, stride
+ *   BinaryColumn + name, per column    dtype, name length, offsets of the blob and bitmap
+ *   zero padding up to 64 bytes
+ *   column blobs                       stride values each, stride = rows rounded up to 16
+ *   validity bitmaps                   of the columns with nulls, 64-byte aligned
+ *
+ * Every blob starts on a 64-byte boundary and the blobs follow each other, so
+ * the data section is one column-major (stride, columns) block. Loading maps
+ * the file copy-on-write and attaches the frame to the block, nothing is read
+ * until a column is touched. Only the bitmaps are copied into their Series.
+ *
+ * Version 1 files have no bitmaps, their column entries end before
+ * validity_offset.
+ *
+ * Categorical columns have no place in the format, saving a frame that has
+ * them throws.
+ *
+ */
+
+namespace stratos {
+
+    namespace data {
+
+        enum class DType : uint32_t {
+            Float32 = 0
+        };
+
+        struct BinaryHeader {
+            char magic[8];
+            uint32_t version;
+            uint32_t n_columns;
+            uint64_t rows;
+            uint64_t stride;
+        };
+
+        struct BinaryColumn {
+            uint32_t dtype;
+            uint32_t name_length;
+            uint64_t offset;
+            uint64_t validity_offset;       // 0 without nulls
+        };
+
+        inline constexpr char binary_magic[8] = { 'S', 'T', 'R', 'A', 'T', 'O', 'S', 'D' };
+        inline constexpr uint32_t binary_version = 2;
+        inline constexpr size_t binary_alignment = 64;
+
+        inline size_t AlignUp(size_t n, size_t alignment) {
+            return (n + alignment - 1) / alignment * alignment;
+        }
+
+        inline bool SaveBinary(const std::string& filename, const DataFrame& df) {
+            // The format has no dictionary section, leaving them out would lose data silently
+            if (!df.GetCategoricalColumns().empty())
+                throw std::invalid_argument("SaveBinary: Categorical column '" + df.GetCategoricalColumns()[0] + "' cannot be written to a .stratos file.");
+
+            // Encoded columns are written decoded, as float32 like the others
+            const std::vector<std::string> columns = df.GetColumns();
+
+            const size_t rows = df.GetShape().first, n_cols = columns.size();
+
+            const size_t stride = AlignUp(rows, binary_alignment / sizeof(float));
+
+            size_t table_end = sizeof(BinaryHeader);
+            for (const std::string& name : columns) table_end += sizeof(BinaryColumn) + name.size();
+
+            const size_t data_offset = AlignUp(table_end, binary_alignment);
+
+            // Bitmaps follow the block, each padded to the alignment
+            const size_t bitmap_bytes = ValidityWords(rows) * sizeof(uint64_t);
+            std::vector<const uint64_t*> validity(n_cols);
+            std::vector<uint64_t> validity_offset(n_cols, 0);
+
+            size_t position = data_offset + n_cols * stride * sizeof(float);
+
+            for (size_t c = 0; c < n_cols; ++c) {
+                validity[c] = df.GetSource(columns[c]).GetValidity();
+                if (!validity[c]) continue;
+
+                validity_offset[c] = position;
+                position += AlignUp(bitmap_bytes, binary_alignment);
+            }
+
+            std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+
+            if (!out.is_open())
+                return false;
+
+            BinaryHeader header;
+            std::memcpy(header.magic, binary_magic, sizeof(binary_magic));
+            header.version = binary_version;
+            header.n_columns = n_cols;
+            header.rows = rows;
+            header.stride = stride;
+
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+            for (size_t c = 0; c < n_cols; ++c) {
+                BinaryColumn column;
+                column.dtype = (uint32_t)DType::Float32;
+                column.name_length = columns[c].size();
+                column.offset = data_offset + c * stride * sizeof(float);
+                column.validity_offset = validity_offset[c];
+
+                out.write(reinterpret_cast<const char*>(&column), sizeof(column));
+                out.write(columns[c].data(), columns[c].size());
+            }
+
+            const std::vector<char> padding(std::max({ data_offset - table_end, (stride - rows) * sizeof(float), binary_alignment }), 0);
+            out.write(padding.data(), data_offset - table_end);
+
+            std::vector<float> decoded;
+
+            for (const std::string& name : columns) {
+                if (!df.IsEncoded(name)) {
+                    out.write(reinterpret_cast<const char*>(df[name].data.value.memptr()), rows * sizeof(float));
+                } else {
+                    const EncodedColumn& column = df.GetEncoded(name);
+                    decoded.resize(std::min<size_t>(rows, 1 << 16));
+
+                    for (size_t begin = 0; begin < rows; begin += decoded.size()) {
+                        const size_t count = std::min(decoded.size(), rows - begin);
+                        column.Decode(begin, count, decoded.data());
+                        out.write(reinterpret_cast<const char*>(decoded.data()), count * sizeof(float));
+                    }
+                }
+
+                out.write(padding.data(), (stride - rows) * sizeof(float));
+            }
+
+            for (size_t c = 0; c < n_cols; ++c) {
+                if (!validity[c]) continue;
+
+                out.write(reinterpret_cast<const char*>(validity[c]), bitmap_bytes);
+                out.write(padding.data(), AlignUp(bitmap_bytes, binary_alignment) - bitmap_bytes);
+            }
+
+            return out.good();
+        }
+
+        // Validates the header and column table of a mapped file, the bitmap offsets
+        // are 0 for columns without nulls. Returns nullptr or the reason the file
+        // cannot be used.
+        inline const char* ReadBinaryLayout(const MappedFile& file, BinaryHeader& header, std::vector<std::string>& names, size_t& data_offset,
+            std::vector<size_t>* validity_offsets = nullptr) {
+            if (file.size() < sizeof(BinaryHeader))
+                return "truncated header.";
+
+            std::memcpy(&header, file.begin(), sizeof(header));
+
+            if (std::memcmp(header.magic, binary_magic, sizeof(binary_magic)) != 0)
+                return "not a stratos binary file.";
+
+            if (header.version != 1 && header.version != binary_version)
+                return "unsupported binary format version.";
+
+            const size_t entry = header.version == 1 ? offsetof(BinaryColumn, validity_offset) : sizeof(BinaryColumn);
+            const size_t bitmap_bytes = ValidityWords(header.rows) * sizeof(uint64_t);
+
+            if (header.stride < header.rows)
+                return "column stride smaller than the row count.";
+
+            size_t position = sizeof(BinaryHeader);
+            data_offset = 0;
+
+            for (size_t c = 0; c < header.n_columns; ++c) {
+                BinaryColumn column{};
+
+                if (position + entry > file.size())
+                    return "truncated column table.";
+
+                std::memcpy(&column, file.begin() + position, entry);
+                position += entry;
+
+                if (position + column.name_length > file.size())
+                    return "truncated column table.";
+
+                names.emplace_back(file.begin() + position, column.name_length);
+                position += column.name_length;
+
+                if (column.dtype != (uint32_t)DType::Float32)
+                    return "unsupported column type.";
+
+                if (c == 0) data_offset = column.offset;
+
+                // The blobs have to form one block to be attached
+                if (column.offset % binary_alignment != 0 || column.offset != data_offset + c * header.stride * sizeof(float))
+                    return "column blobs are not laid out as one block.";
+
+                if (column.validity_offset != 0 && (column.validity_offset % alignof(uint64_t) != 0 || column.validity_offset + bitmap_bytes > file.size()))
+                    return "truncated validity bitmap.";
+
+                if (validity_offsets) validity_offsets->push_back(column.validity_offset);
+            }
+
+            if ((header.n_columns > 0 && data_offset < position) || data_offset + header.n_columns * header.stride * sizeof(float) > file.size())
+                return "truncated column data.";
+
+            return nullptr;
+        }
+
+        inline bool LoadBinary(const std::string& filename, DataFrame& df) {
+            auto file = std::make_shared<MappedFile>(filename, true);
+
+            if (!file->IsOpen())
+                return false;
+
+            auto invalid = [](const char* reason) {
+                std::cerr << "Error loading the dataset: " << reason << std::endl;
+                return false;
+            };
+
+            BinaryHeader header;
+            std::vector<std::string> names;
+            std::vector<size_t> validity_offsets;
+            size_t data_offset;
+
+            if (const char* error = ReadBinaryLayout(*file, header, names, data_offset, &validity_offsets))
+                return invalid(error);
+
+            float* block = reinterpret_cast<float*>(file->data() + data_offset);
+
+            auto attach_validity = [&](size_t c) {
+                if (validity_offsets[c] == 0) return;
+
+                const uint64_t* bits = reinterpret_cast<const uint64_t*>(file->data() + validity_offsets[c]);
+                df[names[c]].SetValidity(std::vector<uint64_t>(bits, bits + ValidityWords(header.rows)));
+            };
+
+            // An empty frame, not one that only holds categorical columns
+            if (df.GetShape().second == 0 && df.GetShape().first == 0) {
+                auto owner = file;
+                df.Attach(block, header.rows, header.stride, names, std::move(owner));
+
+                for (size_t c = 0; c < names.size(); ++c) attach_validity(c);
+                return true;
+            }
+
+            if (df.GetShape().first != header.rows)
+                return invalid("row count does not match the frame.");
+
+            // Columns added to a frame that already has some are copied in
+            const size_t first = df.GetBlockColumns();
+            df.Reserve(first + names.size());
+
+            for (size_t c = 0; c < names.size(); ++c) {
+                df.AddColumn(names[c], header.rows);
+                std::copy(block + c * header.stride, block + c * header.stride + header.rows, df.GetColumnData(first + c));
+                attach_validity(c);
+            }
+
+            return true;
+        }
+
+    }
+
+}
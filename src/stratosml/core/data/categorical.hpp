@@ -0,0 +1,211 @@
+#pragma once
+#include <armadillo>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+/*
+ *
+ * CATEGORICAL - Dictionary encoded string columns
+ *
+ * Every distinct string of a column is interned once into a StringDictionary
+ * and the rows store its code, in the narrowest unsigned type holding the
+ * cardinality. Codes feed Embedding lookups or sparse one-hot matrices, the
+ * column is never expanded into floats.
+ *
+ */
+
+namespace stratos {
+
+    namespace data {
+
+        // 64-bit hash over 8 bytes at a time
+        inline uint64_t HashBytes(const char* data, size_t n) {
+            uint64_t h = 0x9E3779B97F4A7C15ull ^ n;
+
+            for (; n >= 8; data += 8, n -= 8) {
+                uint64_t word;
+                std::memcpy(&word, data, 8);
+
+                h = (h ^ word) * 0xBF58476D1CE4E5B9ull;
+                h ^= h >> 31;
+            }
+
+            uint64_t tail = 0;
+            std::memcpy(&tail, data, n);
+
+            h = (h ^ tail) * 0x94D049BB133111EBull;
+            return h ^ (h >> 29);
+        }
+
+        // Open-addressing intern table, linear probing over a power-of-two slot array
+        // kept at most half full. The strings live back to back in one arena and
+        // codes are assigned in first-seen order.
+        class StringDictionary {
+
+            static constexpr uint32_t empty = UINT32_MAX;
+
+            std::vector<uint32_t> slots;
+            std::vector<uint64_t> hashes;       // per code, for probing and rehashing
+            std::vector<size_t> offsets { 0 };  // code c spans [offsets[c], offsets[c + 1]) of the arena
+            std::string arena;
+
+        public:
+
+            StringDictionary() : slots(16, empty) {}
+
+            size_t GetSize() const {
+                return hashes.size();
+            }
+
+            std::string_view Get(uint32_t code) const {
+                return std::string_view(arena.data() + offsets[code], offsets[code + 1] - offsets[code]);
+            }
+
+            // Code of the string, added when it is new
+            uint32_t Intern(std::string_view value) {
+                const uint64_t hash = HashBytes(value.data(), value.size());
+
+                size_t slot = this->Probe(value, hash);
+                if (slots[slot] != empty) return slots[slot];
+
+                const uint32_t code = hashes.size();
+
+                hashes.push_back(hash);
+                arena.append(value);
+                offsets.push_back(arena.size());
+                slots[slot] = code;
+
+                if (2 * hashes.size() > slots.size()) this->Grow();
+
+                return code;
+            }
+
+            // Code of the string, or -1 when it was never interned
+            int64_t Find(std::string_view value) const {
+                const size_t slot = this->Probe(value, HashBytes(value.data(), value.size()));
+                return slots[slot] == empty ? -1 : (int64_t)slots[slot];
+            }
+
+        private:
+
+            // Slot holding the string, or the empty slot it would go into
+            size_t Probe(std::string_view value, uint64_t hash) const {
+                const size_t mask = slots.size() - 1;
+
+                for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+                    const uint32_t code = slots[slot];
+
+                    if (code == empty || (hashes[code] == hash && this->Get(code) == value))
+                        return slot;
+                }
+            }
+
+            void Grow() {
+                std::vector<uint32_t> grown(slots.size() * 2, empty);
+                const size_t mask = grown.size() - 1;
+
+                for (uint32_t code = 0; code < hashes.size(); ++code) {
+                    size_t slot = hashes[code] & mask;
+                    while (grown[slot] != empty) slot = (slot + 1) & mask;
+                    grown[slot] = code;
+                }
+
+                slots = std::move(grown);
+            }
+        };
+
+        /*
+         * Codes of a categorical column over a shared dictionary. Embedding takes
+         * the codes of a batch directly:
+         *
+         *   std::vector<uint32_t> codes = column.Codes(rows, count);
+         *   var out = embedding_layer.lookup(std::move(codes), count);
+         */
+        class CategoricalColumn {
+
+            std::string name;
+            std::shared_ptr<StringDictionary> dictionary;
+            std::variant<std::vector<uint8_t>, std::vector<uint16_t>, std::vector<uint32_t>> codes;
+
+        public:
+
+            CategoricalColumn() {}
+
+            // Narrows codes to uint8 or uint16 when the cardinality allows it
+            CategoricalColumn(std::string name, std::shared_ptr<StringDictionary> dictionary, const std::vector<uint32_t>& wide)
+                : name(std::move(name)), dictionary(std::move(dictionary)) {
+                const size_t cardinality = this->dictionary->GetSize();
+
+                if (cardinality <= UINT8_MAX + 1) {
+                    codes = std::vector<uint8_t>(wide.begin(), wide.end());
+                } else if (cardinality <= UINT16_MAX + 1) {
+                    codes = std::vector<uint16_t>(wide.begin(), wide.end());
+                } else {
+                    codes = wide;
+                }
+            }
+
+            std::string GetName() const {
+                return name;
+            }
+
+            size_t GetSize() const {
+                return std::visit([](const auto& c) { return c.size(); }, codes);
+            }
+
+            size_t GetCardinality() const {
+                return dictionary->GetSize();
+            }
+
+            // Bytes per stored code
+            size_t GetCodeSize() const {
+                return std::visit([](const auto& c) { return sizeof(c[0]); }, codes);
+            }
+
+            const StringDictionary& GetDictionary() const {
+                return *dictionary;
+            }
+
+            uint32_t Code(size_t row) const {
+                return std::visit([row](const auto& c) { return (uint32_t)c[row]; }, codes);
+            }
+
+            std::string_view Label(size_t row) const {
+                return dictionary->Get(this->Code(row));
+            }
+
+            // Codes of the given rows, all rows without an index
+            std::vector<uint32_t> Codes(const size_t* rows = nullptr, size_t count = 0) const {
+                return std::visit([&](const auto& c) {
+                    if (!rows) return std::vector<uint32_t>(c.begin(), c.end());
+
+                    std::vector<uint32_t> out(count);
+                    for (size_t i = 0; i < count; ++i) out[i] = c[rows[i]];
+                    return out;
+                }, codes);
+            }
+
+            // Sparse (count, cardinality) one-hot matrix of the given rows, all rows
+            // without an index
+            arma::SpMat<float> OneHot(const size_t* rows = nullptr, size_t count = 0) const {
+                const std::vector<uint32_t> selected = this->Codes(rows, count);
+
+                arma::umat locations(2, selected.size());
+                for (size_t i = 0; i < selected.size(); ++i) {
+                    locations(0, i) = i;
+                    locations(1, i) = selected[i];
+                }
+
+                return arma::SpMat<float>(locations, arma::Col<float>(selected.size(), arma::fill::ones), selected.size(), this->GetCardinality());
+            }
+        };
+
+    }
+
+}
@@ -0,0 +1,267 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <thread>
+#include <vector>
+
+/*
+ *
+ * COLUMN - One-pass column statistics and in-place column kernels
+ *
+ * Missing values are marked in an optional validity bitmap, one bit per row
+ * and 64 rows per word, a cleared bit is a null. Kernels taking a bitmap
+ * skip nulls a word at a time: full words take the dense path, empty words
+ * are skipped and only mixed words are walked bit by bit. A null bitmap
+ * pointer means every row is valid.
+ *
+ */
+
+namespace stratos {
+
+    namespace data {
+
+        inline size_t ValidityWords(size_t n) {
+            return (n + 63) / 64;
+        }
+
+        // Bits of the rows of word w in a column of n rows
+        inline uint64_t RowMask(size_t w, size_t n) {
+            const size_t tail = n - w * 64;
+            return tail >= 64 ? ~0ull : (1ull << tail) - 1;
+        }
+
+        // Validity word w of a column of n rows, bits past the last row cleared
+        inline uint64_t ValidWord(const uint64_t* validity, size_t w, size_t n) {
+            return validity[w] & RowMask(w, n);
+        }
+
+        inline size_t CountNulls(const uint64_t* validity, size_t n) {
+            if (!validity) return 0;
+
+            size_t valid = 0;
+            for (size_t w = 0; w < ValidityWords(n); ++w) valid += std::popcount(ValidWord(validity, w, n));
+
+            return n - valid;
+        }
+
+        // Count, min, max, mean and the sum of squared deviations of a column,
+        // accumulated in double. Blocks small enough to stay in cache get their
+        // own mean and deviations, and are merged with Chan's parallel update of
+        // Welford's algorithm, so the column is read once and the inner loops
+        // vectorize.
+        struct ColumnStats {
+
+            size_t count = 0;
+            double min = std::numeric_limits<double>::infinity();
+            double max = -std::numeric_limits<double>::infinity();
+            double mean = 0;
+            double m2 = 0;
+
+            static constexpr size_t block = 4096;
+
+            ColumnStats() {}
+
+            // Nulls of the validity bitmap, if any, are left out
+            ColumnStats(const float* values, size_t n, const uint64_t* validity = nullptr) {
+                float gathered[block];
+
+                for (size_t begin = 0; begin < n; begin += block) {
+                    const size_t count = std::min(block, n - begin);
+                    const size_t first = begin / 64, last = ValidityWords(begin + count);
+
+                    bool dense = true;
+                    for (size_t w = first; validity && w < last; ++w) dense = dense && ValidWord(validity, w, n) == RowMask(w, n);
+
+                    if (dense) {
+                        this->AddBlock(values + begin, count);
+                        continue;
+                    }
+
+                    // Valid values of the block packed to the front
+                    size_t kept = 0;
+
+                    for (size_t w = first; w < last; ++w) {
+                        const uint64_t word = ValidWord(validity, w, n);
+                        const float* src = values + w * 64;
+
+                        if (word == ~0ull) {
+                            std::memcpy(gathered + kept, src, 64 * sizeof(float));
+                            kept += 64;
+                        } else {
+                            for (uint64_t bits = word; bits; bits &= bits - 1) gathered[kept++] = src[std::countr_zero(bits)];
+                        }
+                    }
+
+                    this->AddBlock(gathered, kept);
+                }
+            }
+
+            void AddBlock(const float* values, size_t n) {
+                if (n == 0) return;
+
+                double sum = 0;
+                float lo = values[0], hi = values[0];
+
+                for (size_t i = 0; i < n; ++i) {
+                    sum += values[i];
+                    lo = std::min(lo, values[i]);
+                    hi = std::max(hi, values[i]);
+                }
+
+                const double block_mean = sum / n;
+                double block_m2 = 0;
+
+                for (size_t i = 0; i < n; ++i) {
+                    const double d = values[i] - block_mean;
+                    block_m2 += d * d;
+                }
+
+                ColumnStats other;
+                other.count = n;
+                other.min = lo;
+                other.max = hi;
+                other.mean = block_mean;
+                other.m2 = block_m2;
+
+                this->Merge(other);
+            }
+
+            void Merge(const ColumnStats& other) {
+                if (other.count == 0) return;
+
+                const size_t total = count + other.count;
+                const double delta = other.mean - mean;
+
+                mean += delta * other.count / total;
+                m2 += other.m2 + delta * delta * ((double)count * other.count / total);
+
+                min = std::min(min, other.min);
+                max = std::max(max, other.max);
+                count = total;
+            }
+
+            // Sample variance, like arma::stddev
+            double Variance() const {
+                return count > 1 ? m2 / (count - 1) : 0;
+            }
+
+            double MaxAbs() const {
+                return std::max(std::abs(min), std::abs(max));
+            }
+        };
+
+        // Statistics of values[rows[0]], ..., values[rows[n - 1]], gathered a block
+        // at a time. Rows that are null in the validity bitmap are left out.
+        inline ColumnStats GatherStats(const float* values, const size_t* rows, size_t n, const uint64_t* validity = nullptr) {
+            ColumnStats stats;
+            float gathered[ColumnStats::block];
+
+            for (size_t begin = 0; begin < n; begin += ColumnStats::block) {
+                const size_t count = std::min(ColumnStats::block, n - begin);
+                size_t kept = 0;
+
+                if (!validity) {
+                    for (size_t i = 0; i < count; ++i) gathered[i] = values[rows[begin + i]];
+                    kept = count;
+                } else {
+                    for (size_t i = 0; i < count; ++i) {
+                        const size_t row = rows[begin + i];
+                        if (validity[row / 64] >> (row % 64) & 1) gathered[kept++] = values[row];
+                    }
+                }
+
+                stats.AddBlock(gathered, kept);
+            }
+
+            return stats;
+        }
+
+        // Median of the valid values, NaN without any
+        inline float Median(const float* values, size_t n, const uint64_t* validity = nullptr) {
+            std::vector<float> kept;
+            kept.reserve(n - CountNulls(validity, n));
+
+            for (size_t w = 0; w < ValidityWords(n); ++w) {
+                const uint64_t word = validity ? ValidWord(validity, w, n) : RowMask(w, n);
+                const float* src = values + w * 64;
+
+                if (word == ~0ull) {
+                    kept.insert(kept.end(), src, src + 64);
+                } else {
+                    for (uint64_t bits = word; bits; bits &= bits - 1) kept.push_back(src[std::countr_zero(bits)]);
+                }
+            }
+
+            if (kept.empty()) return NAN;
+
+            const size_t half = kept.size() / 2;
+            std::nth_element(kept.begin(), kept.begin() + half, kept.end());
+
+            if (kept.size() % 2) return kept[half];
+
+            // Even count, the mean of the two middle values
+            const float upper = kept[half];
+            const float lower = *std::max_element(kept.begin(), kept.begin() + half);
+            return lower + (upper - lower) / 2;
+        }
+
+        // Writes fill into every null row. Words that are entirely null are filled
+        // 64 values at a time.
+        inline void ImputeColumn(float* values, size_t n, const uint64_t* validity, float fill) {
+            if (!validity) return;
+
+            for (size_t w = 0; w < ValidityWords(n); ++w) {
+                const size_t count = std::min<size_t>(64, n - w * 64);
+                const uint64_t word = ValidWord(validity, w, n);
+                float* dst = values + w * 64;
+
+                if (word == 0) {
+                    std::fill(dst, dst + count, fill);
+                } else {
+                    for (uint64_t bits = ~word & RowMask(w, n); bits; bits &= bits - 1) dst[std::countr_zero(bits)] = fill;
+                }
+            }
+        }
+
+        // values = (values - shift) / divisor in one pass, a zero divisor (a constant
+        // column) leaves the scale at 1
+        inline void ScaleColumn(float* values, size_t n, float shift, float divisor) {
+            const float factor = divisor != 0 ? 1.0f / divisor : 1.0f;
+
+            for (size_t i = 0; i < n; ++i) {
+                values[i] = (values[i] - shift) * factor;
+            }
+        }
+
+        // Runs fn(0) ... fn(n - 1) over the cores, work is the element count of one
+        // item and small jobs stay on the calling thread
+        template<typename F>
+        void ParallelFor(size_t n, size_t work, F&& fn) {
+            constexpr size_t min_work = 1 << 18;
+
+            const size_t threads = std::min<size_t>(n, std::max(1u, std::thread::hardware_concurrency()));
+
+            if (threads <= 1 || n * work < min_work) {
+                for (size_t i = 0; i < n; ++i) fn(i);
+                return;
+            }
+
+            std::atomic<size_t> next { 0 };
+            auto run = [&] {
+                for (size_t i; (i = next.fetch_add(1)) < n;) fn(i);
+            };
+
+            std::vector<std::thread> workers;
+            for (size_t t = 1; t < threads; ++t) workers.emplace_back(run);
+            run();
+            for (auto& worker : workers) worker.join();
+        }
+
+    }
+
+}
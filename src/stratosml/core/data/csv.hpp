@@ -0,0 +1,337 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <stratosml/core/data/data.hpp>
+#include <stratosml/core/data/mmap.hpp>
+
+/*
+ *
+ * CSV - Memory mapped, multithreaded CSV parsing
+ *
+ * The file is mapped instead of read through a stream and the body is split
+ * into newline-aligned chunks, one per thread. A memchr scan counts the rows
+ * of every chunk so the columns are allocated once and each chunk knows the
+ * row it starts at, then every thread parses its chunk with std::from_chars
+ * straight into the column buffers. Empty or non-numeric cells are nulls:
+ * their bits are cleared in the column's validity bitmap and they read as NaN.
+ *
+ * Columns that are named categorical, or hold text in the first row, are
+ * dictionary encoded instead: each thread interns its cells into its own
+ * dictionaries and the codes are remapped onto one merged dictionary.
+ *
+ */
+
+namespace stratos {
+
+    namespace data {
+
+        // Rows in [begin, end), a last line without newline counts too
+        inline size_t CountLines(const char* begin, const char* end) {
+            size_t lines = 0;
+            const char* p = begin;
+
+            while (p < end) {
+                const char* newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+                if (!newline) return lines + 1;
+
+                ++lines;
+                p = newline + 1;
+            }
+
+            return lines;
+        }
+
+        // Parses one cell at p, returns the position after it (on the delimiter or line end).
+        // Empty or non-numeric cells, and numbers followed by anything but
+        // whitespace (e.g. "12abc"), are not valid and read as NaN.
+        inline const char* ParseCell(const char* p, const char* end, float& value, bool& valid) {
+            while (p < end && *p == ' ') ++p;
+            if (p < end && *p == '+') ++p;
+
+            auto [next, error] = std::from_chars(p, end, value);
+            valid = error == std::errc() && next != p;
+
+            const char* rest = next;
+            while (rest < end && (*rest == ' ' || *rest == '\t' || *rest == '\r')) ++rest;
+            if (rest < end && *rest != ',' && *rest != '\n') valid = false;
+
+            if (!valid) {
+                value = NAN;
+                next = p;
+            }
+
+            // Skip whatever is left of a malformed cell
+            while (next < end && *next != ',' && *next != '\n') ++next;
+
+            return next;
+        }
+
+        inline const char* ParseCell(const char* p, const char* end, float& value) {
+            bool valid;
+            return ParseCell(p, end, value, valid);
+        }
+
+        // Where the cells of a column go, a float column or the codes of a
+        // categorical column interned into a (per thread) dictionary
+        struct CellSink {
+            float* values = nullptr;
+            uint64_t* validity = nullptr;
+            size_t nulls = 0;
+
+            uint32_t* codes = nullptr;
+            StringDictionary* dictionary = nullptr;
+
+            // Chunks of neighbouring threads can share a bitmap word
+            void SetNull(size_t row) {
+                std::atomic_ref<uint64_t>(validity[row / 64]).fetch_and(~(1ull << (row % 64)), std::memory_order_relaxed);
+                ++nulls;
+            }
+        };
+
+        // Interns the cell at p, returns the position after it
+        inline const char* InternCell(const char* p, const char* end, uint32_t& code, StringDictionary& dictionary) {
+            const char* cell_end = p;
+            while (cell_end < end && *cell_end != ',' && *cell_end != '\n') ++cell_end;
+
+            const char* text_end = cell_end;
+            if (text_end > p && text_end[-1] == '\r') --text_end;
+
+            code = dictionary.Intern(std::string_view(p, text_end - p));
+            return cell_end;
+        }
+
+        // Parses the lines of [begin, end) into the sinks from row on
+        inline void ParseChunk(const char* begin, const char* end, std::vector<CellSink>& sinks, size_t row) {
+            const size_t n_cols = sinks.size();
+            const char* p = begin;
+
+            while (p < end) {
+                size_t col = 0;
+
+                while (true) {
+                    if (col < n_cols && sinks[col].codes) {
+                        p = InternCell(p, end, sinks[col].codes[row], *sinks[col].dictionary);
+                    } else {
+                        float value;
+                        bool valid;
+                        p = ParseCell(p, end, value, valid);
+
+                        if (col < n_cols) {
+                            sinks[col].values[row] = value;
+                            if (!valid) sinks[col].SetNull(row);
+                        }
+                    }
+
+                    ++col;
+
+                    if (p >= end || *p == '\n') break;
+                    ++p;
+                }
+
+                // Short rows are padded with NaN, or the empty category
+                for (; col < n_cols; ++col) {
+                    if (sinks[col].codes) {
+                        sinks[col].codes[row] = sinks[col].dictionary->Intern("");
+                    } else {
+                        sinks[col].values[row] = NAN;
+                        sinks[col].SetNull(row);
+                    }
+                }
+
+                ++p;
+                ++row;
+            }
+        }
+
+        // Whether a cell holds text rather than a number or nothing
+        inline bool IsTextCell(const char* p, const char* end) {
+            const char* cell_end = p;
+            while (cell_end < end && *cell_end != ',' && *cell_end != '\n') ++cell_end;
+            if (cell_end > p && cell_end[-1] == '\r') --cell_end;
+
+            while (p < cell_end && *p == ' ') ++p;
+            if (p < cell_end && *p == '+') ++p;
+            if (p == cell_end) return false;
+
+            float value;
+            auto [next, error] = std::from_chars(p, cell_end, value);
+            while (next < cell_end && *next == ' ') ++next;
+
+            return error != std::errc() || next != cell_end;
+        }
+
+        inline std::vector<std::string> SplitLabels(const char* begin, const char* end) {
+            std::vector<std::string> labels;
+
+            if (end > begin && end[-1] == '\r') --end;
+
+            const char* p = begin;
+            while (true) {
+                const char* comma = std::find(p, end, ',');
+                labels.emplace_back(p, comma);
+
+                if (comma == end) break;
+                p = comma + 1;
+            }
+
+            return labels;
+        }
+
+        inline bool LoadCSV(const std::string& filename, DataFrame& df, size_t threads, const std::vector<std::string>& categorical) {
+            MappedFile file(filename);
+
+            if (!file.IsOpen())
+                return false;
+
+            file.Advise(MADV_SEQUENTIAL);
+
+            const char* header_end = static_cast<const char*>(std::memchr(file.begin(), '\n', file.size()));
+            if (!header_end) header_end = file.end();
+
+            const std::vector<std::string> labels = SplitLabels(file.begin(), header_end);
+
+            // A file holding only the header has no newline after it
+            const char* body = header_end == file.end() ? file.end() : header_end + 1;
+            const char* end = file.end();
+
+            // Trailing empty lines are not rows
+            while (end > body && (end[-1] == '\n' || end[-1] == '\r')) --end;
+
+            // Named columns are categorical, and so are the ones holding text in the first row
+            std::vector<bool> is_categorical(labels.size(), false);
+
+            for (size_t c = 0; c < labels.size(); ++c) {
+                is_categorical[c] = std::find(categorical.begin(), categorical.end(), labels[c]) != categorical.end();
+            }
+
+            const char* cell = body;
+            for (size_t c = 0; c < labels.size() && cell < end && *cell != '\n'; ++c) {
+                if (IsTextCell(cell, end)) is_categorical[c] = true;
+
+                while (cell < end && *cell != ',' && *cell != '\n') ++cell;
+                if (cell < end && *cell == ',') ++cell;
+            }
+
+            if (threads == 0)
+                threads = std::max(1u, std::thread::hardware_concurrency());
+
+            // Small files are not worth the threads
+            constexpr size_t min_chunk_bytes = 1 << 20;
+            threads = std::max<size_t>(1, std::min<size_t>(threads, (end - body) / min_chunk_bytes));
+
+            // Chunk boundaries moved forward to the next line start
+            std::vector<const char*> bounds(threads + 1, end);
+            bounds[0] = body;
+
+            for (size_t t = 1; t < threads; ++t) {
+                const char* guess = std::max(body + (end - body) * t / threads, bounds[t - 1]);
+                const char* newline = static_cast<const char*>(std::memchr(guess, '\n', end - guess));
+                bounds[t] = newline ? newline + 1 : end;
+            }
+
+            auto parallel = [threads](auto&& work) {
+                std::vector<std::thread> workers;
+                for (size_t t = 1; t < threads; ++t) workers.emplace_back(work, t);
+                work(0);
+                for (auto& worker : workers) worker.join();
+            };
+
+            std::vector<size_t> rows(threads + 1, 0);
+            parallel([&](size_t t) { rows[t + 1] = CountLines(bounds[t], bounds[t + 1]); });
+
+            for (size_t t = 0; t < threads; ++t) rows[t + 1] += rows[t];
+
+            const size_t total = rows[threads];
+            const size_t n_numeric = std::count(is_categorical.begin(), is_categorical.end(), false);
+
+            // Column buffers are allocated once and filled in place
+            const size_t first = df.GetBlockColumns();
+            df.Reserve(first + n_numeric);
+
+            for (size_t c = 0; c < labels.size(); ++c) {
+                if (!is_categorical[c]) df.AddColumn(labels[c], total);
+            }
+
+            // Every thread interns into dictionaries of its own, merged afterwards
+            std::vector<std::vector<uint32_t>> codes;
+            codes.reserve(labels.size() - n_numeric);
+            std::vector<std::vector<StringDictionary>> dictionaries(threads);
+            std::vector<std::vector<CellSink>> sinks(threads, std::vector<CellSink>(labels.size()));
+
+            // Validity bitmaps start all valid, the parser clears the bits of nulls
+            std::vector<std::vector<uint64_t>> validity(n_numeric, std::vector<uint64_t>(ValidityWords(total), ~0ull));
+
+            for (size_t t = 0; t < threads; ++t) {
+                dictionaries[t].resize(labels.size() - n_numeric);
+            }
+
+            for (size_t c = 0, numeric = 0, text = 0; c < labels.size(); ++c) {
+                if (!is_categorical[c]) {
+                    float* values = df.GetColumnData(first + numeric);
+
+                    for (size_t t = 0; t < threads; ++t) {
+                        sinks[t][c].values = values;
+                        sinks[t][c].validity = validity[numeric].data();
+                    }
+
+                    ++numeric;
+                    continue;
+                }
+
+                codes.emplace_back(total);
+
+                for (size_t t = 0; t < threads; ++t) {
+                    sinks[t][c].codes = codes.back().data();
+                    sinks[t][c].dictionary = &dictionaries[t][text];
+                }
+
+                ++text;
+            }
+
+            parallel([&](size_t t) { ParseChunk(bounds[t], bounds[t + 1], sinks[t], rows[t]); });
+
+            // Only columns with nulls keep their bitmap
+            for (size_t c = 0, numeric = 0; c < labels.size(); ++c) {
+                if (is_categorical[c]) continue;
+
+                size_t nulls = 0;
+                for (size_t t = 0; t < threads; ++t) nulls += sinks[t][c].nulls;
+
+                if (nulls > 0) df[labels[c]].SetValidity(std::move(validity[numeric]));
+                ++numeric;
+            }
+
+            // Thread dictionaries merged in thread order keep first-seen code order
+            for (size_t c = 0, text = 0; c < labels.size(); ++c) {
+                if (!is_categorical[c]) continue;
+
+                auto global = std::make_shared<StringDictionary>();
+                std::vector<uint32_t>& column = codes[text];
+
+                for (size_t t = 0; t < threads; ++t) {
+                    const StringDictionary& local = dictionaries[t][text];
+
+                    std::vector<uint32_t> remap(local.GetSize());
+                    for (uint32_t code = 0; code < remap.size(); ++code) remap[code] = global->Intern(local.Get(code));
+
+                    for (size_t row = rows[t]; row < rows[t + 1]; ++row) column[row] = remap[column[row]];
+                }
+
+                df.AddCategorical(CategoricalColumn(labels[c], std::move(global), column));
+                ++text;
+            }
+
+            return true;
+        }
+
+    }
+
+}
@@ -1,15 +1,21 @@
 #pragma once
 #include <iostream>
+#include <algorithm>
 #include <armadillo>
 #include <vector>
 #include <memory>
 #include <map>
 #include <unordered_map>
+#include <utility>
 #include <ranges>
 #include <iomanip>
 #include <variant>
+#include <optional>
 
 #include <stratosml/core/autodiff/tensor.hpp>
+#include <stratosml/core/data/column.hpp>
+#include <stratosml/core/data/categorical.hpp>
+#include <stratosml/core/data/encoding.hpp>
 
 // using namespace std;
 
@@ -27,6 +33,29 @@ namespace stratos {
             Mean
         };
 
+        // Value written into the null rows of a column
+        enum class Imputer {
+            Mean,
+            Median,
+            Constant
+        };
+
+        // Shift and divisor of a scaler for the given statistics, x' = (x - shift) / divisor
+        inline std::pair<float, float> ScaleParams(const ColumnStats& stats, Scaler scaler) {
+            switch (scaler) {
+                case Scaler::MaxAbs:
+                    return { 0, stats.MaxAbs() };
+                case Scaler::MinMax:
+                    return { stats.min, stats.max - stats.min };
+                case Scaler::Standart:
+                    return { stats.mean, std::sqrt(stats.Variance()) };
+                case Scaler::Mean:
+                    return { stats.mean, stats.max - stats.min };
+                default:
+                    throw std::invalid_argument("Invalid scaler.");
+            }
+        }
+
 
 
         class Series {
@@ -35,6 +64,8 @@ namespace stratos {
 
             std::string name;
 
+            // One bit per row, a cleared bit is a null. Empty while every row is valid.
+            std::vector<uint64_t> validity;
 
             // arma::vec data;
 
@@ -63,7 +94,7 @@ namespace stratos {
                 return *this;
             }
 
-            std::string GetName() {
+            std::string GetName() const {
                 return name;
             }
 
@@ -71,23 +102,70 @@ namespace stratos {
                 return data.shape[0];
             }
 
+            // (size, 1) view of the values, nothing is copied
+            Tensor<float> View() {
+                return Tensor<float>(data.value.memptr(), TensorShape({ data.value.n_rows, 1 }));
+            }
+
+            // Validity bitmap, nullptr without nulls
+            const uint64_t* GetValidity() const {
+                return validity.empty() ? nullptr : validity.data();
+            }
+
+            // Takes a bitmap of ValidityWords(GetSize()) words
+            void SetValidity(std::vector<uint64_t> bits) {
+                if (!bits.empty() && bits.size() != ValidityWords(this->GetSize()))
+                    throw std::invalid_argument("SetValidity: Bitmap size does not match the column.");
+
+                validity = std::move(bits);
+            }
+
+            bool IsValid(size_t row) const {
+                return validity.empty() || (validity[row / 64] >> (row % 64) & 1);
+            }
+
+            // Marks a row missing, its value becomes NaN
+            void SetNull(size_t row) {
+                if (validity.empty()) validity.assign(ValidityWords(this->GetSize()), ~0ull);
+
+                validity[row / 64] &= ~(1ull << (row % 64));
+                data(row) = NAN;
+            }
+
+            size_t GetNullCount() const {
+                return CountNulls(this->GetValidity(), this->GetSize());
+            }
+
+            // Statistics of the valid values in one pass
+            ColumnStats GetStats() const {
+                return ColumnStats(data.value.memptr(), data.value.n_elem, this->GetValidity());
+            }
+
+            float GetMedian() const {
+                return Median(data.value.memptr(), data.value.n_elem, this->GetValidity());
+            }
+
+            // Fills the null rows in place and drops the bitmap
+            void Impute(Imputer imputer, float constant = 0) {
+                if (validity.empty()) return;
+
+                float fill = constant;
+                if (imputer == Imputer::Mean) fill = this->GetStats().mean;
+                if (imputer == Imputer::Median) fill = this->GetMedian();
+
+                ImputeColumn(data.value.memptr(), data.value.n_elem, validity.data(), fill);
+                validity.clear();
+            }
+
+            // Shift and divisor applied by Scale, x' = (x - shift) / divisor
+            std::pair<float, float> GetScaleParams(Scaler scaler) const {
+                return ScaleParams(this->GetStats(), scaler);
+            }
+
+            // In place, without temporaries
             void Scale(Scaler scaler) {
-                switch (scaler) {
-                    case Scaler::MaxAbs:
-                        data = data / abs(data).max();
-                        break;
-                    case Scaler::MinMax:
-                        data = (data - data.min()) / (data.max() - data.min());
-                        break;
-                    case Scaler::Standart:
-                        data = (data - mean(data)) / stddev(data);
-                        break;
-                    case Scaler::Mean:
-                        data = (data - mean(data)) / (data.max() - data.min());
-                        break;
-                    default:
-                        throw std::invalid_argument("Invalid scaler.");
-                }
+                auto [shift, divisor] = this->GetScaleParams(scaler);
+                ScaleColumn(data.value.memptr(), data.value.n_elem, shift, divisor);
             }
 
             friend std::ostream& operator<<(ostream& stream, const Series& series) {
@@ -105,81 +183,552 @@ namespace stratos {
             }
         };
 
+        // A numeric column wherever it is stored, read in place from a Series or
+        // decoded from an EncodedColumn
+        struct ColumnSource {
+
+            const Series* series = nullptr;
+            const EncodedColumn* encoded = nullptr;
+
+            size_t GetSize() const {
+                return series ? series->GetSize() : encoded->GetSize();
+            }
+
+            const uint64_t* GetValidity() const {
+                return series ? series->GetValidity() : encoded->GetValidity();
+            }
+
+            // out[i] = value of row rows[i], rows 0 ... count - 1 without an index
+            void Gather(const size_t* rows, size_t count, float* out) const {
+                if (encoded) {
+                    rows ? encoded->Gather(rows, count, out) : encoded->Decode(0, count, out);
+                    return;
+                }
+
+                const float* in = series->data.value.memptr();
+
+                if (!rows) {
+                    std::copy(in, in + count, out);
+                    return;
+                }
+
+                for (size_t i = 0; i < count; ++i) out[i] = in[rows[i]];
+            }
+
+            // Statistics of the valid values of the given rows, all rows without an index
+            ColumnStats GetStats(const size_t* rows = nullptr, size_t n = 0) const {
+                if (encoded) return rows ? encoded->GetStats(rows, n) : encoded->GetStats();
+
+                return rows ? GatherStats(series->data.value.memptr(), rows, n, series->GetValidity()) : series->GetStats();
+            }
+        };
+
+        /*
+         * Columns live side by side in one column-major block of (rows, capacity)
+         * floats. Every Series of the frame is a view of its block column, so the
+         * frame can also be handed out as one matrix without copying. Columns are
+         * looked up by name through an index map, cells by plain index arithmetic.
+         *
+         * An attached block (a mapped binary file) may pad its columns beyond the
+         * row count, block.n_rows is the column stride.
+         *
+         * Compress() moves low precision or low cardinality columns out of the
+         * block into EncodedColumns, which are decoded only when a batch reads them.
+         */
         class DataFrame {
 
-            std::unordered_map<std::string, Series> data;
-            std::vector<string> columns;
-            std::pair<size_t, size_t> shape;
+            arma::Mat<float> block;
+            size_t rows = 0;
+
+            // Keeps attached memory alive, empty while the block owns its memory
+            std::shared_ptr<void> storage;
+
+            std::vector<std::string> columns;
+            std::unordered_map<std::string, size_t> index;
+            std::vector<std::unique_ptr<Series>> series;
+
+            // Dictionary encoded columns, kept beside the numeric block
+            std::vector<CategoricalColumn> categorical;
+            std::unordered_map<std::string, size_t> categorical_index;
+
+            // Compressed numeric columns, also beside the block
+            std::vector<EncodedColumn> encoded;
+            std::unordered_map<std::string, size_t> encoded_index;
 
         public:
 
+            DataFrame() {}
+
+            DataFrame(const DataFrame& other) { *this = other; }
+            DataFrame(DataFrame&& other) noexcept { *this = std::move(other); }
+
+            DataFrame& operator=(const DataFrame& other) {
+                if (this == &other) return *this;
+
+                block.reset();
+                block = other.block;
+                storage.reset();
+                rows = other.rows;
+                columns = other.columns;
+                index = other.index;
+                categorical = other.categorical;
+                categorical_index = other.categorical_index;
+                encoded = other.encoded;
+                encoded_index = other.encoded_index;
+
+                series.clear();
+                for (const auto& s : other.series) {
+                    series.push_back(std::make_unique<Series>(s->name));
+                    series.back()->validity = s->validity;
+                }
+
+                this->Bind();
+                return *this;
+            }
+
+            // Small blocks are copied rather than stolen by Armadillo, so the views are rebound
+            DataFrame& operator=(DataFrame&& other) noexcept {
+                block.reset();
+                block = std::move(other.block);
+                storage = std::move(other.storage);
+                rows = std::exchange(other.rows, 0);
+                columns = std::move(other.columns);
+                index = std::move(other.index);
+                series = std::move(other.series);
+                categorical = std::move(other.categorical);
+                categorical_index = std::move(other.categorical_index);
+                encoded = std::move(other.encoded);
+                encoded_index = std::move(other.encoded_index);
+
+                this->Bind();
+                return *this;
+            }
+
             float& operator()(size_t row, size_t col) {
-                return data.at(columns.at(col))[row];
+                return block.at(row, col);
             }
 
             const float& operator()(size_t row, size_t col) const {
-                return data.at(columns.at(col))[row];
+                return block.at(row, col);
             }
 
 
+            // An encoded column is decoded back into the block first, see Decompress
             Series& operator[](const string& col) {
-                bool column_exists = data.contains(col);
+                if (this->IsEncoded(col)) this->Decompress(col);
 
-                if (!column_exists)
-                    throw std::invalid_argument("Column does not exist");
+                return *series[this->GetColumnIndex(col)];
+            }
 
-                return data[col];
+            // Encoded columns have no Series to hand out here, read them through GetSource
+            const Series& operator[](const string& col) const {
+                if (this->IsEncoded(col))
+                    throw std::invalid_argument("Column '" + col + "' is encoded, read it through GetSource.");
+
+                return *series[this->GetColumnIndex(col)];
             }
 
-            // vector<Series*> operator[](string cols[]) {
-            //     int n_cols = sizeof(cols) / sizeof(cols[0]);
-            //     vector<Series*> series(n_cols);
+            size_t GetColumnIndex(const string& col) const {
+                auto it = index.find(col);
+
+                if (it == index.end())
+                    throw std::invalid_argument("Column does not exist");
 
-            //     for (int i = 0; i < n_cols; i++) {
-            //         series.push_back(&data.at(cols[i]));
-            //     }
+                return it->second;
+            }
 
-            //     return series;
-            // }
+            bool HasColumn(const string& col) const {
+                return index.contains(col) || encoded_index.contains(col);
+            }
+
+            // Numeric columns, the block's in frame order followed by the encoded ones
+            std::vector<std::string> GetColumns() const {
+                std::vector<std::string> names = columns;
+                for (const auto& column : encoded) names.push_back(column.GetName());
+                return names;
+            }
 
-            std::vector<std::string> GetColumns() {
-                return columns;
+            // Columns held in the block, GetColumnData(0) ... GetColumnData(n - 1)
+            size_t GetBlockColumns() const {
+                return columns.size();
             }
 
             
             std::pair<size_t, size_t> GetShape() const {
-                return std::make_pair<size_t, size_t>(data.at(columns.at(0)).GetSize(), columns.size());
+                return std::make_pair(rows, columns.size() + encoded.size());
+            }
+
+            // All columns as one (rows, columns) matrix viewing the frame's storage.
+            // Adding or removing columns invalidates it. With encoded columns or a
+            // padded block it is a copy.
+            Tensor<float> GetMatrix() {
+                if (block.n_rows != rows || !encoded.empty())
+                    return this->Select(this->GetColumns());
+
+                return Tensor<float>(block.memptr(), TensorShape({ rows, columns.size() }));
+            }
+
+            // The columns as one (rows, n) matrix. Columns adjacent in frame order are
+            // a zero-copy view of the block like GetMatrix, other selections are
+            // gathered into a new matrix.
+            Tensor<float> Select(const std::vector<std::string>& cols) {
+                if (cols.empty())
+                    throw std::invalid_argument("Select: No columns given.");
+
+                // Encoded columns are decoded into the new matrix
+                if (std::any_of(cols.begin(), cols.end(), [&](const string& col) { return this->IsEncoded(col); })) {
+                    arma::Mat<float> decoded(rows, cols.size());
+                    for (size_t i = 0; i < cols.size(); ++i) this->GetSource(cols[i]).Gather(nullptr, rows, decoded.colptr(i));
+
+                    return Tensor<float>(std::move(decoded));
+                }
+
+                std::vector<size_t> positions;
+                for (const std::string& col : cols) positions.push_back(this->GetColumnIndex(col));
+
+                bool adjacent = true;
+                for (size_t i = 1; i < positions.size(); ++i) adjacent = adjacent && positions[i] == positions[0] + i;
+
+                if (adjacent && block.n_rows == rows)
+                    return Tensor<float>(block.colptr(positions[0]), TensorShape({ rows, cols.size() }));
+
+                arma::Mat<float> gathered(rows, cols.size());
+                for (size_t i = 0; i < positions.size(); ++i)
+                    std::copy(block.colptr(positions[i]), block.colptr(positions[i]) + rows, gathered.colptr(i));
+
+                return Tensor<float>(std::move(gathered));
+            }
+
+            // A numeric column, in the block or encoded
+            ColumnSource GetSource(const string& col) const {
+                if (auto it = encoded_index.find(col); it != encoded_index.end())
+                    return ColumnSource{ nullptr, &encoded[it->second] };
+
+                return ColumnSource{ &(*this)[col], nullptr };
+            }
+
+            bool IsEncoded(const string& col) const {
+                return encoded_index.contains(col);
+            }
+
+            const EncodedColumn& GetEncoded(const string& col) const {
+                auto it = encoded_index.find(col);
+
+                if (it == encoded_index.end())
+                    throw std::invalid_argument("Encoded column does not exist");
+
+                return encoded[it->second];
+            }
+
+            std::vector<std::string> GetEncodedColumns() const {
+                std::vector<std::string> names;
+                for (const auto& column : encoded) names.push_back(column.GetName());
+                return names;
+            }
+
+            // Encodes every column EncodedColumn::Choose finds an encoding for,
+            // columns in parallel, and shrinks the block to the columns left.
+            // Returns the number of columns encoded.
+            size_t Compress(float tolerance = 0) {
+                std::vector<std::optional<EncodedColumn>> chosen(columns.size());
+
+                ParallelFor(columns.size(), rows, [&](size_t c) {
+                    chosen[c] = EncodedColumn::Choose(columns[c], block.colptr(c), rows, series[c]->GetValidity(), tolerance);
+                });
+
+                std::vector<size_t> kept;
+
+                for (size_t c = 0; c < columns.size(); ++c) {
+                    if (!chosen[c]) {
+                        kept.push_back(c);
+                        continue;
+                    }
+
+                    encoded_index[columns[c]] = encoded.size();
+                    encoded.push_back(std::move(*chosen[c]));
+                }
+
+                const size_t count = columns.size() - kept.size();
+                if (count == 0) return 0;
+
+                arma::Mat<float> compact(rows, kept.size());
+                std::vector<std::string> names;
+                std::vector<std::unique_ptr<Series>> remaining;
+
+                for (size_t i = 0; i < kept.size(); ++i) {
+                    std::copy(block.colptr(kept[i]), block.colptr(kept[i]) + rows, compact.colptr(i));
+                    names.push_back(columns[kept[i]]);
+                    remaining.push_back(std::move(series[kept[i]]));
+                }
+
+                block.reset();
+                block = std::move(compact);
+                storage.reset();
+
+                columns = std::move(names);
+                series = std::move(remaining);
+
+                index.clear();
+                for (size_t c = 0; c < columns.size(); ++c) index[columns[c]] = c;
+
+                this->Bind();
+                return count;
+            }
+
+            // Decodes a column back into the block, as its last column
+            void Decompress(const string& col) {
+                auto it = encoded_index.find(col);
+                if (it == encoded_index.end())
+                    throw std::invalid_argument("Decompress: Column '" + col + "' is not encoded.");
+
+                EncodedColumn column = std::move(encoded[it->second]);
+                encoded.erase(encoded.begin() + it->second);
+
+                encoded_index.clear();
+                for (size_t c = 0; c < encoded.size(); ++c) encoded_index[encoded[c].GetName()] = c;
+
+                this->AddColumn(col, column.GetSize());
+                column.Decode(0, rows, block.colptr(columns.size() - 1));
+
+                if (const uint64_t* validity = column.GetValidity())
+                    series.back()->SetValidity(std::vector<uint64_t>(validity, validity + ValidityWords(rows)));
+            }
+
+            void Decompress() {
+                while (!encoded.empty()) this->Decompress(encoded.front().GetName());
+            }
+
+            // Bytes held by the numeric columns, unused block capacity included
+            size_t GetMemoryUsage() const {
+                size_t bytes = block.n_elem * sizeof(float);
+
+                for (const auto& s : series) bytes += s->validity.size() * sizeof(uint64_t);
+                for (const auto& column : encoded) bytes += column.GetMemoryUsage();
+
+                return bytes;
+            }
+
+            // Contiguous values of a column, valid until columns are added or removed
+            float* GetColumnData(size_t col) {
+                return block.colptr(col);
+            }
+
+            // Room for the given number of columns without moving the block
+            void Reserve(size_t capacity) {
+                if (capacity <= block.n_cols) return;
+
+                arma::Mat<float> grown(rows, capacity);
+                for (size_t c = 0; c < columns.size(); ++c)
+                    std::copy(block.colptr(c), block.colptr(c) + rows, grown.colptr(c));
+
+                block = std::move(grown);
+                storage.reset();
+                this->Bind();
+            }
+
+            // Views a column-major block of (stride, names.size()) floats owned by
+            // storage instead of copying it. Writes stay within the frame, adding a
+            // column moves it to memory of its own.
+            void Attach(float* memory, size_t n_rows, size_t stride, const std::vector<std::string>& names, std::shared_ptr<void> owner) {
+                if (!columns.empty())
+                    throw std::invalid_argument("Attach: The frame already has columns.");
+
+                if (stride < n_rows)
+                    throw std::invalid_argument("Attach: Column stride is smaller than the row count.");
+
+                for (size_t c = 0; c < names.size(); ++c) {
+                    if (!index.emplace(names[c], c).second) {
+                        index.clear();
+                        throw std::invalid_argument("Attach: Column '" + names[c] + "' already exists.");
+                    }
+                }
+
+                block.reset();
+                block = arma::Mat<float>(memory, stride, names.size(), false, false);
+                storage = std::move(owner);
+                rows = n_rows;
+
+                columns = names;
+                for (const std::string& name : names) series.push_back(std::make_unique<Series>(name));
+
+                this->Bind();
             }
 
 
             void AddColumn(const string name) {
-                Series *series = new Series(name);
-                data[name] = *series;
-                columns.push_back(name);
+                this->AddColumn(name, rows);
             }
 
+            // The first sized column of an empty frame sets the row count
             void AddColumn(const string name, size_t size) {
-                Series *series = new Series(name, size);
-                data[name] = *series;
+                if (index.contains(name) || categorical_index.contains(name) || encoded_index.contains(name))
+                    throw std::invalid_argument("AddColumn: Column '" + name + "' already exists.");
+
+                if (rows == 0 && size != 0) this->SetRows(size);
+
+                if (size != rows)
+                    throw std::invalid_argument("AddColumn: Column size does not match the frame.");
+
+                if (columns.size() == block.n_cols)
+                    this->Reserve(std::max<size_t>(4, 2 * block.n_cols));
+
+                block.col(columns.size()).zeros();
+
+                index[name] = columns.size();
                 columns.push_back(name);
+                series.push_back(std::make_unique<Series>(name));
+
+                this->Bind();
             }
 
             void AddColumn(const Series& column) {
-                data[column.name] = column;
-                columns.push_back(column.name);
+                this->AddColumn(column.name, column.GetSize());
+                std::copy(column.data.value.begin(), column.data.value.end(), block.colptr(columns.size() - 1));
+                series.back()->validity = column.validity;
+            }
+
+            // The first categorical column of an empty frame sets the row count
+            void AddCategorical(CategoricalColumn column) {
+                const string name = column.GetName();
+
+                if (index.contains(name) || categorical_index.contains(name) || encoded_index.contains(name))
+                    throw std::invalid_argument("AddCategorical: Column '" + name + "' already exists.");
+
+                if (rows == 0 && column.GetSize() != 0) this->SetRows(column.GetSize());
+
+                if (column.GetSize() != rows)
+                    throw std::invalid_argument("AddCategorical: Column size does not match the frame.");
+
+                categorical_index[name] = categorical.size();
+                categorical.push_back(std::move(column));
             }
 
+            bool HasCategorical(const string& col) const {
+                return categorical_index.contains(col);
+            }
+
+            const CategoricalColumn& GetCategorical(const string& col) const {
+                auto it = categorical_index.find(col);
+
+                if (it == categorical_index.end())
+                    throw std::invalid_argument("Categorical column does not exist");
+
+                return categorical[it->second];
+            }
+
+            std::vector<std::string> GetCategoricalColumns() const {
+                std::vector<std::string> names;
+                for (const auto& column : categorical) names.push_back(column.GetName());
+                return names;
+            }
+
+            // Later columns move one to the left
             void RemoveColumn(const string name) {
-                auto pos = std::find(columns.begin(), columns.end(), name);
-                if (pos == columns.end())
-                    throw "RemoveColumn: Column not found.";
-                
-                columns.erase(pos);
+                if (auto it = categorical_index.find(name); it != categorical_index.end()) {
+                    categorical.erase(categorical.begin() + it->second);
+
+                    categorical_index.clear();
+                    for (size_t c = 0; c < categorical.size(); ++c) categorical_index[categorical[c].GetName()] = c;
+                    return;
+                }
+
+                if (auto it = encoded_index.find(name); it != encoded_index.end()) {
+                    encoded.erase(encoded.begin() + it->second);
+
+                    encoded_index.clear();
+                    for (size_t c = 0; c < encoded.size(); ++c) encoded_index[encoded[c].GetName()] = c;
+                    return;
+                }
+
+                auto it = index.find(name);
+                if (it == index.end())
+                    throw std::invalid_argument("RemoveColumn: Column not found.");
+
+                const size_t col = it->second;
+
+                for (size_t c = col + 1; c < columns.size(); ++c)
+                    std::copy(block.colptr(c), block.colptr(c) + rows, block.colptr(c - 1));
+
+                columns.erase(columns.begin() + col);
+                series.erase(series.begin() + col);
+
+                index.clear();
+                for (size_t c = 0; c < columns.size(); ++c) index[columns[c]] = c;
+
+                this->Bind();
             }
 
+            // Every column by its own statistics, columns in parallel
             void Scale(Scaler scaler) {
-                for (auto [name, series]: data) {
-                    series.Scale(scaler);
+                ParallelFor(series.size(), rows, [&](size_t c) { series[c]->Scale(scaler); });
+
+                this->Recode(this->GetEncodedColumns(), [&](size_t, float* values, std::vector<uint64_t>& validity) {
+                    auto [shift, divisor] = ScaleParams(ColumnStats(values, rows, validity.empty() ? nullptr : validity.data()), scaler);
+                    ScaleColumn(values, rows, shift, divisor);
+                });
+            }
+
+            // Fills the nulls of every column, columns in parallel
+            void Impute(Imputer imputer, float constant = 0) {
+                ParallelFor(series.size(), rows, [&](size_t c) { series[c]->Impute(imputer, constant); });
+
+                std::vector<std::string> with_nulls;
+                for (const auto& column : encoded) {
+                    if (column.GetValidity()) with_nulls.push_back(column.GetName());
+                }
+
+                this->Recode(with_nulls, [&](size_t, float* values, std::vector<uint64_t>& validity) {
+                    float fill = constant;
+                    if (imputer == Imputer::Mean) fill = ColumnStats(values, rows, validity.data()).mean;
+                    if (imputer == Imputer::Median) fill = Median(values, rows, validity.data());
+
+                    ImputeColumn(values, rows, validity.data(), fill);
+                    validity.clear();
+                });
+            }
+
+            /*
+             * Rewrites encoded columns in place: each one is decoded, apply(i, values,
+             * validity) changes the values and bitmap of cols[i] (an empty bitmap has
+             * no nulls), and the result is encoded again, columns in parallel. A
+             * column no encoding fits any more moves into the block.
+             */
+            template<typename Apply>
+            void Recode(const std::vector<std::string>& cols, Apply apply) {
+                for (const string& col : cols) {
+                    if (!this->IsEncoded(col))
+                        throw std::invalid_argument("Recode: Column '" + col + "' is not encoded.");
+                }
+
+                std::vector<std::vector<float>> values(cols.size());
+                std::vector<std::vector<uint64_t>> validity(cols.size());
+                std::vector<std::optional<EncodedColumn>> chosen(cols.size());
+
+                ParallelFor(cols.size(), rows, [&](size_t i) {
+                    const EncodedColumn& column = encoded[encoded_index.at(cols[i])];
+
+                    values[i].resize(rows);
+                    column.Decode(0, rows, values[i].data());
+
+                    if (const uint64_t* bits = column.GetValidity())
+                        validity[i].assign(bits, bits + ValidityWords(rows));
+
+                    apply(i, values[i].data(), validity[i]);
+
+                    chosen[i] = EncodedColumn::Choose(cols[i], values[i].data(), rows, validity[i].empty() ? nullptr : validity[i].data(), 0);
+                });
+
+                for (size_t i = 0; i < cols.size(); ++i) {
+                    if (chosen[i]) {
+                        encoded[encoded_index.at(cols[i])] = std::move(*chosen[i]);
+                        continue;
+                    }
+
+                    this->RemoveColumn(cols[i]);
+                    this->AddColumn(cols[i], rows);
+
+                    std::copy(values[i].begin(), values[i].end(), block.colptr(columns.size() - 1));
+                    series.back()->SetValidity(std::move(validity[i]));
                 }
             }
 
@@ -188,24 +737,56 @@ namespace stratos {
 
                 stream << left << setw(7) << " ";
 
-                for (string label : df.columns) {
+                for (string label : df.GetColumns()) {
                     stream << left << setw(20) << label;
                 }
                 stream << "\n";
 
-                auto [rows, cols] = df.GetShape();
+                // Encoded columns are printed decoded, after the block's
+                std::vector<std::vector<float>> decoded;
+                for (const auto& column : df.encoded) {
+                    decoded.emplace_back(df.rows);
+                    column.Decode(0, df.rows, decoded.back().data());
+                }
 
-                for (size_t row = 0; row < rows; row++) {
+                for (size_t row = 0; row < df.rows; row++) {
                     stream  << left << setw(7) << row;
-                    for (size_t col = 0; col < cols; col++) {
+                    for (size_t col = 0; col < df.columns.size(); col++) {
                          stream << left << setw(20) << df(row, col);
                     }
+                    for (const auto& values : decoded) {
+                         stream << left << setw(20) << values[row];
+                    }
                     stream << "\n";
                 }
 
                 return stream;
             }
 
+        private:
+
+            // Row count of a frame without rows yet, its numeric columns become zeros
+            void SetRows(size_t n) {
+                const size_t capacity = std::max<size_t>(block.n_cols, columns.size() + 1);
+
+                rows = n;
+                block.reset();
+                block.zeros(rows, capacity);
+                storage.reset();
+
+                this->Bind();
+            }
+
+            // Points every Series at its column of the current block. The views are
+            // fixed-size, so they are rebuilt in place rather than assigned.
+            void Bind() {
+                for (size_t c = 0; c < series.size(); ++c) {
+                    Tensor<float>& data = series[c]->data;
+                    std::destroy_at(&data);
+                    std::construct_at(&data, block.colptr(c), TensorShape({ rows }));
+                }
+            }
+
         };
 
         
@@ -229,59 +810,65 @@ namespace stratos {
 
 
 
-        // template<typename... DataFrames, typename... Args>
-        // typename std::enable_if<(is_dataframe_or_series<DataFrames>::value && ...), std::tuple<DataFrames...>>::type
-        // Split(
-        //     const std::tuple<DataFrames...>& dfs,
-        //     const float test_ratio = 0.25f,
-        //     const size_t random_state,
-        //     const bool shuffle = true,)
-        // {
-        //     cout << sizeof(dfs);
-        //     return false;
-        // }
-
         bool LoadCSV(fstream& stream, DataFrame& df);
 
-        bool Load(const string& filename, DataFrame& df) {
+        // Memory mapped parallel parser, see csv.hpp. threads = 0 uses every core.
+        // Columns listed in categorical, or whose first cell is not a number, are
+        // dictionary encoded.
+        inline bool LoadCSV(const string& filename, DataFrame& df, size_t threads = 0, const std::vector<std::string>& categorical = {});
 
-            
-            const int ext_pos = filename.rfind(".");
+        // Memory mapped columnar files, see binary.hpp
+        inline bool LoadBinary(const string& filename, DataFrame& df);
+        inline bool SaveBinary(const string& filename, const DataFrame& df);
+
+        // Extension without the dot, empty without one
+        inline string GetExtension(const string& filename) {
+            const size_t ext_pos = filename.rfind(".");
+            return ext_pos == string::npos ? "" : filename.substr(ext_pos + 1);
+        }
+
+        // .csv files are parsed, .stratos files are mapped. With compress, columns
+        // that allow it are encoded once loaded, see DataFrame::Compress.
+        bool Load(const string& filename, DataFrame& df, bool compress = false) {
 
-            if (ext_pos == string::npos) {
+            const string ext = GetExtension(filename);
+
+            if (ext.empty()) {
                 cerr << "Error loading the dataset: no extension." << endl;
                 return false;
             }
 
-            const string ext = filename.substr(ext_pos + 1, filename.length());
-            
-            if (ext != "csv") {
+            if (ext != "csv" && ext != "stratos") {
                 cerr << "Error loading the dataset: unknown extension." << endl;
                 return false;
             }
             
-            fstream stream;
-
-            stream.open(filename, fstream::in);
-
-            if (!stream.is_open()) { 
+            if (!(ext == "csv" ? LoadCSV(filename, df) : LoadBinary(filename, df))) {
                 cerr << "Error loading the dataset!" << endl; 
                 return false; 
-            } 
+            }
+
+            if (compress) df.Compress();
 
             cout << "Successfully loaded the dataset!" << endl;
 
-            if (ext == "csv") {
-                if (!LoadCSV(stream, df)) {
-                    cerr << "Error loading the dataset: failed reading csv format." << endl; 
-                    return false; 
-                }
+            return true;
+        };
+
+        inline bool Save(const string& filename, const DataFrame& df) {
+
+            if (GetExtension(filename) != "stratos") {
+                cerr << "Error saving the dataset: only the .stratos format can be written." << endl;
+                return false;
             }
 
-            stream.close();
+            if (!SaveBinary(filename, df)) {
+                cerr << "Error saving the dataset!" << endl;
+                return false;
+            }
 
             return true;
-        };
+        }
 
         vector<string> GetColumnLabels(fstream& f) {
 
@@ -371,5 +958,9 @@ namespace stratos {
         
 
     }
+}
 
-}
\ No newline at end of file
+#include <stratosml/core/data/csv.hpp>
+#include <stratosml/core/data/binary.hpp>
+#include <stratosml/core/data/split.hpp>
+#include <stratosml/core/data/scaler.hpp>
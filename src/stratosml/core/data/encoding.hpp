@@ -0,0 +1,385 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <type_traits>
+#include <string>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#include <stratosml/core/data/column.hpp>
+
+/*
+ *
+ * ENCODING - Compressed in-memory numeric columns
+ *
+ * A column that is low precision or low cardinality is stored in one of:
+ *
+ *   Float16       half precision bits, values that survive the round trip
+ *   Scaled8/16    integer codes of a decimal step, value = (base + code) * step
+ *   RunLength     run values and the row each run ends at
+ *   Dictionary    8 or 16-bit codes into a table of the distinct values
+ *
+ * Choose() only picks encodings that decode every value bit for bit, unless
+ * a Float16 tolerance is given. Batches are decoded straight into the
+ * caller's float buffer, the column is never expanded as a whole.
+ *
+ */
+
+namespace stratos {
+
+    namespace data {
+
+        enum class Encoding {
+            Float16,
+            Scaled8,
+            Scaled16,
+            RunLength,
+            Dictionary
+        };
+
+        inline float HalfToFloat(uint16_t h) {
+            constexpr uint32_t shifted_exp = 0x7c00u << 13;
+
+            uint32_t bits = (h & 0x7fffu) << 13;
+            const uint32_t exp = bits & shifted_exp;
+            bits += (127 - 15) << 23;
+
+            if (exp == shifted_exp) {
+                bits += (128 - 16) << 23;       // Inf or NaN
+            } else if (exp == 0) {
+                bits += 1 << 23;                // Subnormal, renormalized
+                bits = std::bit_cast<uint32_t>(std::bit_cast<float>(bits) - std::bit_cast<float>(113u << 23));
+            }
+
+            return std::bit_cast<float>(bits | (uint32_t)(h & 0x8000u) << 16);
+        }
+
+        // Half bits of a value, exact only when the value fits, truncated otherwise
+        inline uint16_t FloatToHalf(float value) {
+            const uint32_t bits = std::bit_cast<uint32_t>(value);
+            const uint16_t sign = (bits >> 16) & 0x8000u;
+            const int exp = (bits >> 23) & 0xff;
+            uint32_t mantissa = bits & 0x7fffff;
+
+            if (exp == 0xff) return sign | 0x7c00u | (mantissa ? 0x200u : 0);
+
+            const int half_exp = exp - 127 + 15;
+
+            if (half_exp >= 31) return sign | 0x7c00u;
+            if (half_exp <= 0) {
+                if (half_exp < -10) return sign;
+
+                mantissa |= 0x800000;
+                return sign | (mantissa >> (14 - half_exp));
+            }
+
+            return sign | (half_exp << 10) | (mantissa >> 13);
+        }
+
+        // Same value, NaNs of any payload included
+        inline bool SameValue(float a, float b) {
+            return std::bit_cast<uint32_t>(a) == std::bit_cast<uint32_t>(b) || (std::isnan(a) && std::isnan(b));
+        }
+
+        class EncodedColumn {
+
+            std::string name;
+            Encoding encoding = Encoding::Float16;
+            size_t size = 0;
+
+            // Float16 bits, scaled or dictionary codes
+            std::variant<std::vector<uint8_t>, std::vector<uint16_t>> codes;
+
+            // Dictionary values or run values
+            std::vector<float> table;
+            std::vector<uint32_t> run_ends;     // run r covers [run_ends[r - 1], run_ends[r])
+
+            int64_t base = 0;
+            double step = 1;
+
+            std::vector<uint64_t> validity;
+
+        public:
+
+            EncodedColumn() {}
+
+            std::string GetName() const {
+                return name;
+            }
+
+            Encoding GetEncoding() const {
+                return encoding;
+            }
+
+            size_t GetSize() const {
+                return size;
+            }
+
+            const uint64_t* GetValidity() const {
+                return validity.empty() ? nullptr : validity.data();
+            }
+
+            // Bytes held by the encoded values
+            size_t GetMemoryUsage() const {
+                const size_t code_bytes = std::visit([](const auto& c) { return c.size() * sizeof(c[0]); }, codes);
+                return code_bytes + table.size() * sizeof(float) + run_ends.size() * sizeof(uint32_t) + validity.size() * sizeof(uint64_t);
+            }
+
+            // out[i] = value of row begin + i
+            void Decode(size_t begin, size_t count, float* out) const {
+                if (encoding == Encoding::RunLength) {
+                    size_t run = std::upper_bound(run_ends.begin(), run_ends.end(), begin) - run_ends.begin();
+
+                    for (size_t i = 0; i < count; ++run) {
+                        const size_t n = std::min<size_t>(run_ends[run] - begin - i, count - i);
+                        std::fill(out + i, out + i + n, table[run]);
+                        i += n;
+                    }
+
+                    return;
+                }
+
+                this->Read([begin](size_t i) { return begin + i; }, count, out);
+            }
+
+            // out[i] = value of row rows[i]
+            void Gather(const size_t* rows, size_t count, float* out) const {
+                if (encoding == Encoding::RunLength) {
+                    for (size_t i = 0; i < count; ++i)
+                        out[i] = table[std::upper_bound(run_ends.begin(), run_ends.end(), rows[i]) - run_ends.begin()];
+
+                    return;
+                }
+
+                this->Read([rows](size_t i) { return rows[i]; }, count, out);
+            }
+
+            // Statistics of the valid values, decoded a block at a time
+            ColumnStats GetStats(const size_t* rows = nullptr, size_t n = SIZE_MAX) const {
+                if (!rows) n = size;
+
+                ColumnStats stats;
+                float decoded[ColumnStats::block];
+
+                for (size_t begin = 0; begin < n; begin += ColumnStats::block) {
+                    const size_t count = std::min(ColumnStats::block, n - begin);
+
+                    if (rows) {
+                        this->Gather(rows + begin, count, decoded);
+
+                        size_t kept = 0;
+                        for (size_t i = 0; i < count; ++i) {
+                            const size_t row = rows[begin + i];
+                            if (validity.empty() || (validity[row / 64] >> (row % 64) & 1)) decoded[kept++] = decoded[i];
+                        }
+
+                        stats.AddBlock(decoded, kept);
+                    } else {
+                        this->Decode(begin, count, decoded);
+                        stats.Merge(ColumnStats(decoded, count, validity.empty() ? nullptr : validity.data() + begin / 64));
+                    }
+                }
+
+                return stats;
+            }
+
+            /*
+             * Smallest exact encoding of the values, none when no encoding saves a
+             * quarter of the float size. A tolerance above zero also accepts Float16
+             * values within that relative error. Null rows of the validity bitmap
+             * can take any value, they decode to NaN.
+             */
+            static std::optional<EncodedColumn> Choose(const std::string& name, const float* values, size_t n,
+                const uint64_t* validity = nullptr, float tolerance = 0) {
+                if (n == 0) return std::nullopt;
+
+                auto valid = [&](size_t row) { return !validity || (validity[row / 64] >> (row % 64) & 1); };
+                auto value = [&](size_t row) { return valid(row) ? values[row] : NAN; };
+
+                std::optional<EncodedColumn> best;
+                size_t best_bytes = n * sizeof(float) * 3 / 4;
+
+                auto consider = [&](std::optional<EncodedColumn> candidate) {
+                    if (candidate && candidate->GetMemoryUsage() < best_bytes) {
+                        best_bytes = candidate->GetMemoryUsage();
+                        best = std::move(candidate);
+                    }
+                };
+
+                // Runs, worth it only for long ones
+                size_t runs = 1;
+                for (size_t row = 1; row < n && runs * 8 < best_bytes; ++row) runs += !SameValue(value(row), value(row - 1));
+
+                if (runs * 8 < best_bytes) {
+                    EncodedColumn column(name, Encoding::RunLength, n);
+
+                    for (size_t row = 0; row < n; ++row) {
+                        if (row > 0 && SameValue(value(row), value(row - 1))) continue;
+
+                        if (row > 0) column.run_ends.push_back(row);
+                        column.table.push_back(value(row));
+                    }
+
+                    column.run_ends.push_back(n);
+                    consider(std::move(column));
+                }
+
+                consider(ChooseScaled(name, values, n, valid));
+                consider(ChooseDictionary(name, n, value));
+
+                // Float16 at two bytes a value
+                bool fits = true;
+                for (size_t row = 0; row < n && fits; ++row) {
+                    if (!valid(row)) continue;
+
+                    const float decoded = HalfToFloat(FloatToHalf(values[row]));
+                    fits = SameValue(decoded, values[row]) || std::abs(decoded - values[row]) <= tolerance * std::abs(values[row]);
+                }
+
+                if (fits) {
+                    EncodedColumn column(name, Encoding::Float16, n);
+                    std::vector<uint16_t> bits(n);
+
+                    for (size_t row = 0; row < n; ++row) bits[row] = FloatToHalf(value(row));
+
+                    column.codes = std::move(bits);
+                    consider(std::move(column));
+                }
+
+                if (best && validity) best->validity.assign(validity, validity + ValidityWords(n));
+
+                return best;
+            }
+
+        private:
+
+            EncodedColumn(std::string name, Encoding encoding, size_t size) : name(std::move(name)), encoding(encoding), size(size) {}
+
+            // Arithmetic for Float16 and scaled codes, table lookups for the
+            // dictionary. The contiguous case vectorizes.
+            template<typename RowOf>
+            void Read(RowOf row_of, size_t count, float* out) const {
+                if (encoding == Encoding::Float16) {
+                    const uint16_t* bits = std::get<std::vector<uint16_t>>(codes).data();
+                    for (size_t i = 0; i < count; ++i) out[i] = HalfToFloat(bits[row_of(i)]);
+                    return;
+                }
+
+                if (encoding == Encoding::Scaled8 || encoding == Encoding::Scaled16) {
+                    std::visit([&](const auto& code) {
+                        // The largest code is NaN
+                        constexpr auto nan = std::numeric_limits<std::decay_t<decltype(code[0])>>::max();
+
+                        for (size_t i = 0; i < count; ++i) {
+                            const auto c = code[row_of(i)];
+                            out[i] = c == nan ? NAN : (float)((double)(base + c) * step);
+                        }
+                    }, codes);
+
+                    return;
+                }
+
+                std::visit([&](const auto& c) {
+                    for (size_t i = 0; i < count; ++i) out[i] = table[c[row_of(i)]];
+                }, codes);
+            }
+
+            // Values that are integers of a decimal step 10^-d, d up to 6, as 8 or
+            // 16-bit offsets from the smallest one
+            template<typename Valid>
+            static std::optional<EncodedColumn> ChooseScaled(const std::string& name, const float* values, size_t n, Valid valid) {
+                for (int digits = 0; digits <= 6; ++digits) {
+                    const double scale = std::pow(10.0, digits), step = 1 / scale;
+
+                    int64_t lo = INT64_MAX, hi = INT64_MIN;
+                    bool exact = true;
+
+                    for (size_t row = 0; row < n && exact; ++row) {
+                        if (!valid(row)) continue;
+
+                        const double scaled = std::round((double)values[row] * scale);
+                        if (!(std::abs(scaled) < 1e15)) {
+                            exact = false;
+                            break;
+                        }
+
+                        // Checked with the decode arithmetic, so decoding is exact
+                        const int64_t k = (int64_t)scaled;
+                        lo = std::min(lo, k);
+                        hi = std::max(hi, k);
+
+                        exact = SameValue((float)((double)k * step), values[row]) && hi - lo < UINT16_MAX;
+                    }
+
+                    if (!exact) continue;
+                    if (hi == INT64_MIN) lo = hi = 0;
+
+                    EncodedColumn column(name, hi - lo < UINT8_MAX ? Encoding::Scaled8 : Encoding::Scaled16, n);
+                    column.base = lo;
+                    column.step = step;
+
+                    auto encode = [&](auto& code, uint16_t nan) {
+                        code.resize(n);
+                        for (size_t row = 0; row < n; ++row)
+                            code[row] = valid(row) ? (uint16_t)(std::round((double)values[row] * scale) - lo) : nan;
+                    };
+
+                    if (column.encoding == Encoding::Scaled8) {
+                        std::vector<uint8_t> code;
+                        encode(code, UINT8_MAX);
+                        column.codes = std::move(code);
+                    } else {
+                        std::vector<uint16_t> code;
+                        encode(code, UINT16_MAX);
+                        column.codes = std::move(code);
+                    }
+
+                    return column;
+                }
+
+                return std::nullopt;
+            }
+
+            // Codes into the distinct values, 8-bit up to 256 of them and 16-bit up to 65536
+            template<typename Value>
+            static std::optional<EncodedColumn> ChooseDictionary(const std::string& name, size_t n, Value value) {
+                std::unordered_map<uint32_t, uint16_t> index;
+                std::vector<float> distinct;
+                std::vector<uint16_t> code(n);
+
+                for (size_t row = 0; row < n; ++row) {
+                    const float v = value(row);
+                    const uint32_t key = std::isnan(v) ? 0x7fc00000u : std::bit_cast<uint32_t>(v);
+
+                    auto [it, added] = index.emplace(key, (uint16_t)distinct.size());
+
+                    if (added) {
+                        if (distinct.size() == UINT16_MAX + 1) return std::nullopt;
+                        distinct.push_back(v);
+                    }
+
+                    code[row] = it->second;
+                }
+
+                EncodedColumn column(name, Encoding::Dictionary, n);
+                column.table = std::move(distinct);
+
+                if (column.table.size() <= UINT8_MAX + 1) {
+                    column.codes = std::vector<uint8_t>(code.begin(), code.end());
+                } else {
+                    column.codes = std::move(code);
+                }
+
+                return column;
+            }
+        };
+
+    }
+
+}
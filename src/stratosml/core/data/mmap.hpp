@@ -0,0 +1,63 @@
+#pragma once
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace stratos {
+
+    namespace data {
+
+        // Mapping of a whole file, unmapped on destruction. A copy-on-write mapping
+        // can be written to, the changes stay private to the process.
+        class MappedFile {
+
+            char* begin_ = nullptr;
+            size_t size_ = 0;
+
+        public:
+
+            MappedFile(const std::string& filename, bool copy_on_write = false) {
+                const int fd = open(filename.c_str(), O_RDONLY);
+                if (fd < 0) return;
+
+                struct stat info;
+                if (fstat(fd, &info) == 0 && info.st_size > 0) {
+                    const int protection = copy_on_write ? PROT_READ | PROT_WRITE : PROT_READ;
+                    void* address = mmap(nullptr, info.st_size, protection, MAP_PRIVATE, fd, 0);
+
+                    if (address != MAP_FAILED) {
+                        begin_ = static_cast<char*>(address);
+                        size_ = info.st_size;
+                    }
+                }
+
+                close(fd);
+            }
+
+            MappedFile(const MappedFile&) = delete;
+            MappedFile& operator=(const MappedFile&) = delete;
+
+            ~MappedFile() {
+                if (begin_) munmap(begin_, size_);
+            }
+
+            bool IsOpen() const { return begin_ != nullptr; }
+
+            // Access pattern hint, e.g. MADV_SEQUENTIAL for a single scan
+            void Advise(int advice) const {
+                if (begin_) madvise(begin_, size_, advice);
+            }
+
+            char* data() const { return begin_; }
+
+            const char* begin() const { return begin_; }
+            const char* end() const { return begin_ + size_; }
+            size_t size() const { return size_; }
+        };
+
+    }
+
+}
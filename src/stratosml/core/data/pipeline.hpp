@@ -0,0 +1,710 @@
+#pragma once
+#include <armadillo>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <stratosml/core/autodiff/tensor.hpp>
+#include <stratosml/core/data/data.hpp>
+#include <stratosml/core/data/split.hpp>
+#include <stratosml/core/data/stream.hpp>
+
+using namespace stratos::autodiff;
+
+namespace stratos {
+    namespace data {
+
+        // Bounded lock-free multi-producer/multi-consumer ring queue.
+        // Every cell carries a sequence number telling whether it is free for
+        // the producer or ready for the consumer at the current lap.
+        // Pop() spins briefly on an empty queue and then sleeps until a push.
+        template<typename T>
+        class BoundedQueue {
+
+            struct Cell {
+                std::atomic<size_t> sequence;
+                T value;
+            };
+
+            std::unique_ptr<Cell[]> cells;
+            size_t mask;
+
+            alignas(64) std::atomic<size_t> head { 0 };
+            alignas(64) std::atomic<size_t> tail { 0 };
+
+            // Bumped by every push and by Wake(), sleeping consumers wait for it to change
+            alignas(64) std::atomic<uint32_t> pushes { 0 };
+
+            static constexpr size_t spin_limit = 64;
+
+        public:
+
+            // Capacity is rounded up to a power of two
+            BoundedQueue(size_t capacity) {
+                size_t size = 2;
+                while (size < capacity) size <<= 1;
+
+                cells = std::make_unique<Cell[]>(size);
+                mask = size - 1;
+
+                for (size_t i = 0; i < size; ++i) {
+                    cells[i].sequence.store(i, std::memory_order_relaxed);
+                }
+            }
+
+            bool TryPush(const T& value) {
+                size_t pos = tail.load(std::memory_order_relaxed);
+
+                while (true) {
+                    Cell& cell = cells[pos & mask];
+                    const size_t seq = cell.sequence.load(std::memory_order_acquire);
+                    const intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+                    if (diff == 0) {
+                        if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                            cell.value = value;
+                            cell.sequence.store(pos + 1, std::memory_order_release);
+
+                            pushes.fetch_add(1);
+                            pushes.notify_one();
+                            return true;
+                        }
+                    } else if (diff < 0) {
+                        return false; // full
+                    } else {
+                        pos = tail.load(std::memory_order_relaxed);
+                    }
+                }
+            }
+
+            bool TryPop(T& value) {
+                size_t pos = head.load(std::memory_order_relaxed);
+
+                while (true) {
+                    Cell& cell = cells[pos & mask];
+                    const size_t seq = cell.sequence.load(std::memory_order_acquire);
+                    const intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+
+                    if (diff == 0) {
+                        if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                            value = cell.value;
+                            cell.sequence.store(pos + mask + 1, std::memory_order_release);
+                            return true;
+                        }
+                    } else if (diff < 0) {
+                        return false; // empty
+                    } else {
+                        pos = head.load(std::memory_order_relaxed);
+                    }
+                }
+            }
+
+            // Blocking pop, false if stop is set before a value arrives.
+            // The counter is read before the last try, so a push in between
+            // changes it and the wait returns at once.
+            bool Pop(T& value, const std::atomic<bool>* stop = nullptr) {
+                for (size_t spin = 0; !this->TryPop(value); ++spin) {
+                    if (spin < spin_limit) {
+                        std::this_thread::yield();
+                        continue;
+                    }
+
+                    const uint32_t seen = pushes.load();
+                    if (stop && stop->load()) return false;
+                    if (this->TryPop(value)) break;
+
+                    pushes.wait(seen);
+                }
+
+                return true;
+            }
+
+            // Wakes every sleeping Pop() to check its stop flag
+            void Wake() {
+                pushes.fetch_add(1);
+                pushes.notify_all();
+            }
+
+            // Approximate number of queued items
+            size_t GetSize() const {
+                const size_t t = tail.load(std::memory_order_relaxed);
+                const size_t h = head.load(std::memory_order_relaxed);
+                return t > h ? t - h : 0;
+            }
+        };
+
+        // A prefetched batch, rows are samples
+        struct BatchBuffer {
+            Tensor<float> x;
+            Tensor<float> y;
+            size_t rows = 0;
+        };
+
+        // Counters for spotting an input-bound training loop
+        struct PipelineStats {
+            size_t batches = 0;
+            size_t queue_depth_sum = 0;     // ready batches seen by the consumer, summed over Next() calls
+            double consumer_stall = 0;      // seconds the trainer waited for a batch
+            double producer_stall = 0;      // seconds producers waited for a free buffer
+
+            double GetMeanQueueDepth() const {
+                return batches ? (double)queue_depth_sum / batches : 0;
+            }
+
+            friend std::ostream& operator<<(std::ostream& stream, const PipelineStats& stats) {
+                stream << "batches: " << stats.batches
+                       << " - mean queue depth: " << stats.GetMeanQueueDepth()
+                       << " - consumer stall: " << stats.consumer_stall << "s"
+                       << " - producer stall: " << stats.producer_stall << "s";
+                return stream;
+            }
+        };
+
+        /*
+         * PIPELINE - Background batch producer
+         *
+         *   data::Pipeline pipeline(df, { "YearsExperience" }, { "Salary" });
+         *
+         *   pipeline.Scale("YearsExperience", Scaler::MaxAbs)
+         *       .Shuffle(1024)
+         *       .Batch(32)
+         *       .Prefetch(4);
+         *
+         *   model.Fit(pipeline, epochs);
+         *
+         * Stages run in the order source -> map/scale -> shuffle buffer -> batch -> prefetch.
+         * Worker threads gather rows into a fixed pool of batch buffers and hand them to
+         * the trainer through a lock-free queue, buffers go back to the pool once trained on.
+         *
+         * Constructed from a file name, the pipeline streams the file instead of
+         * reading it from a frame: every epoch rescans it in chunks read ahead by a
+         * StreamReader, and one producer thread shuffles the rows through the bounded
+         * shuffle buffer. The row count is known after the first epoch.
+         */
+        class Pipeline {
+
+            using MapFn = std::function<void(Tensor<float>&, Tensor<float>&)>;
+
+            // Frame columns are looked up by name for every batch, so compressing or
+            // adding columns of the frame in between does not leave stale pointers
+            const DataFrame* df = nullptr;
+            std::vector<std::string> feature_names;
+            std::vector<std::string> target_names;
+
+            // Per feature column x' = (x - shift) * scale, identity unless Scale() is used
+            std::vector<float> shift;
+            std::vector<float> scale;
+
+            std::vector<MapFn> maps;
+
+            // Streaming source, its chunk columns of the features and the targets
+            std::unique_ptr<StreamReader> stream;
+            std::vector<size_t> feature_index;
+            std::vector<size_t> target_index;
+
+            // Frame rows of a RowView pipeline, empty for the whole frame
+            std::vector<size_t> view_rows;
+
+            size_t n_rows = 0;
+            size_t batch_size = 32;
+            size_t shuffle_buffer = 0;
+            size_t prefetch = 2;
+            size_t n_threads = 1;
+            std::mt19937_64 rng;
+
+            // Epoch state
+            std::vector<size_t> order;
+            size_t batch_count = 0;
+            size_t consumed = 0;
+            std::atomic<size_t> next_batch { 0 };
+
+            std::vector<BatchBuffer> buffers;
+            std::unique_ptr<BoundedQueue<BatchBuffer*>> free;
+            std::unique_ptr<BoundedQueue<BatchBuffer*>> ready;
+
+            std::vector<std::thread> workers;
+            std::mutex mutex;
+            std::condition_variable epoch_started;
+            size_t generation = 0;
+            std::atomic<bool> stopping { false };
+
+            PipelineStats stats;
+            std::atomic<int64_t> producer_stall_ns { 0 };
+
+        public:
+
+            Pipeline(const DataFrame& df, const std::vector<std::string>& x_cols, const std::vector<std::string>& y_cols, size_t seed = std::random_device{}())
+                : df(&df), feature_names(x_cols), target_names(y_cols), rng(seed) {
+                if (x_cols.empty() || y_cols.empty())
+                    throw std::invalid_argument("Pipeline needs at least one feature and one target column.");
+
+                // Throws for a column the frame does not have
+                for (const auto& col : x_cols) df.GetSource(col);
+                for (const auto& col : y_cols) df.GetSource(col);
+
+                n_rows = df.GetShape().first;
+                shift.assign(x_cols.size(), 0.0f);
+                scale.assign(x_cols.size(), 1.0f);
+            }
+
+            // Batches of the view's rows only, e.g. a training fold. The frame is
+            // read in place like the constructor above, nothing is copied up front.
+            Pipeline(const RowView& view, const std::vector<std::string>& x_cols, const std::vector<std::string>& y_cols, size_t seed = std::random_device{}())
+                : Pipeline(view.GetFrame(), x_cols, y_cols, seed) {
+                view_rows = view.GetRows();
+                n_rows = view_rows.size();
+            }
+
+            // Streams a .csv or .stratos file, chunk_rows rows at a time with
+            // read_ahead chunks read in the background
+            Pipeline(const std::string& filename, const std::vector<std::string>& x_cols, const std::vector<std::string>& y_cols,
+                size_t seed = std::random_device{}(), size_t chunk_rows = 65536, size_t read_ahead = 2)
+                : feature_names(x_cols), target_names(y_cols), rng(seed) {
+                stream = std::make_unique<StreamReader>(OpenSource(filename), chunk_rows, read_ahead);
+
+                const std::vector<std::string>& columns = stream->GetColumns();
+
+                auto find = [&](const std::string& col) {
+                    auto it = std::find(columns.begin(), columns.end(), col);
+                    if (it == columns.end())
+                        throw std::invalid_argument("Pipeline: Column '" + col + "' not found in '" + filename + "'.");
+
+                    return (size_t)(it - columns.begin());
+                };
+
+                for (const auto& col : x_cols) feature_index.push_back(find(col));
+                for (const auto& col : y_cols) target_index.push_back(find(col));
+
+                if (feature_index.empty() || target_index.empty())
+                    throw std::invalid_argument("Pipeline needs at least one feature and one target column.");
+
+                shift.assign(feature_index.size(), 0.0f);
+                scale.assign(feature_index.size(), 1.0f);
+            }
+
+            Pipeline(Pipeline&& other) = delete;
+
+            ~Pipeline() {
+                this->Stop();
+            }
+
+            /// ------
+            /// Stages
+            /// ------
+
+            // Scale a feature column with the statistics Series::Scale would use,
+            // applied per batch so the frame itself is left untouched.
+            Pipeline& Scale(const std::string& col, Scaler scaler) {
+                if (stream)
+                    throw std::invalid_argument("Scale: Statistics are not known ahead of a streamed file, pass a fitted ColumnScaler.");
+
+                for (size_t i = 0; i < feature_names.size(); ++i) {
+                    if (feature_names[i] != col) continue;
+
+                    const ColumnSource feature = df->GetSource(col);
+
+                    // A view is scaled by the statistics of its own rows
+                    auto [s, divisor] = ScaleParams(view_rows.empty() ? feature.GetStats() : feature.GetStats(view_rows.data(), n_rows), scaler);
+                    shift[i] = s;
+                    scale[i] = divisor != 0 ? 1.0f / divisor : 1.0f;
+                    return *this;
+                }
+
+                throw std::invalid_argument("Scale: Column is not a pipeline feature.");
+            }
+
+            // Scale the features a fitted scaler knows with its statistics, which
+            // also works for streamed files
+            Pipeline& Scale(const ColumnScaler& scaler) {
+                for (size_t i = 0; i < feature_names.size(); ++i) {
+                    if (!scaler.HasColumn(feature_names[i])) continue;
+
+                    auto [s, divisor] = scaler.GetParams(feature_names[i]);
+                    shift[i] = s;
+                    scale[i] = divisor != 0 ? 1.0f / divisor : 1.0f;
+                }
+
+                return *this;
+            }
+
+            // Arbitrary transform of a gathered batch, runs on the producer threads
+            Pipeline& Map(MapFn fn) {
+                maps.push_back(std::move(fn));
+                return *this;
+            }
+
+            // Shuffle through a buffer of the given number of rows, a buffer at
+            // least as big as the dataset is a full shuffle.
+            Pipeline& Shuffle(size_t buffer_size) {
+                shuffle_buffer = buffer_size;
+                return *this;
+            }
+
+            Pipeline& Batch(size_t size) {
+                if (size < 1)
+                    throw std::invalid_argument("Batch size should be bigger than zero.");
+
+                batch_size = size;
+                return *this;
+            }
+
+            // Number of batches kept ready ahead of the trainer
+            Pipeline& Prefetch(size_t depth) {
+                prefetch = std::max<size_t>(depth, 1);
+                return *this;
+            }
+
+            Pipeline& Threads(size_t count) {
+                n_threads = std::max<size_t>(count, 1);
+                return *this;
+            }
+
+            /// --------
+            /// Consumer
+            /// --------
+
+            size_t GetFeatureCount() const {
+                return feature_names.size();
+            }
+
+            size_t GetTargetCount() const {
+                return target_names.size();
+            }
+
+            // Rows of the last full pass over a streamed file
+            size_t GetSize() const {
+                return n_rows;
+            }
+
+            const PipelineStats& GetStats() {
+                stats.producer_stall = producer_stall_ns.load() * 1e-9;
+                return stats;
+            }
+
+            // Starts producing the batches of a new epoch
+            void BeginEpoch() {
+                if (workers.empty()) this->Start();
+
+                // A streamed epoch ends when its producer sends a null batch
+                if (stream) {
+                    batch_count = SIZE_MAX;
+                } else {
+                    this->ShuffleOrder();
+                    batch_count = (n_rows + batch_size - 1) / batch_size;
+                }
+
+                consumed = 0;
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    next_batch.store(0);
+                    generation++;
+                }
+                epoch_started.notify_all();
+            }
+
+            // Next ready batch or nullptr at the end of the epoch.
+            // The batch has to be handed back with Release().
+            BatchBuffer* Next() {
+                if (consumed == batch_count) return nullptr;
+
+                BatchBuffer* batch;
+                stats.queue_depth_sum += ready->GetSize();
+
+                if (!ready->TryPop(batch)) {
+                    auto start = std::chrono::steady_clock::now();
+                    ready->Pop(batch);
+                    stats.consumer_stall += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                }
+
+                if (!batch) {
+                    batch_count = consumed;
+                    return nullptr;
+                }
+
+                consumed++;
+                stats.batches++;
+                return batch;
+            }
+
+            void Release(BatchBuffer* batch) {
+                // The pool has room for every buffer, a full one means a buffer came back twice
+                if (batch < buffers.data() || batch >= buffers.data() + buffers.size() || !free->TryPush(batch))
+                    throw std::invalid_argument("Release: Batch is not a pending batch of this pipeline.");
+            }
+
+        private:
+
+            void Start() {
+                // Two buffers beyond the prefetch depth, one being trained on and one being filled
+                const size_t n_buffers = prefetch + 2;
+
+                buffers.resize(n_buffers);
+                free = std::make_unique<BoundedQueue<BatchBuffer*>>(n_buffers);
+                ready = std::make_unique<BoundedQueue<BatchBuffer*>>(n_buffers + 1);
+
+                for (auto& buffer : buffers) {
+                    buffer.x = Tensor<float>(arma::Mat<float>(batch_size, this->GetFeatureCount()));
+                    buffer.y = Tensor<float>(arma::Mat<float>(batch_size, this->GetTargetCount()));
+                    this->Push(*free, &buffer);
+                }
+
+                // A stream is read front to back, by a single producer
+                if (stream) {
+                    workers.emplace_back([this] { this->Stream(); });
+                    return;
+                }
+
+                for (size_t i = 0; i < n_threads; ++i) {
+                    workers.emplace_back([this] { this->Work(); });
+                }
+            }
+
+            void Stop() {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    stopping.store(true);
+                }
+                epoch_started.notify_all();
+
+                // Producers asleep on a free buffer
+                if (free) free->Wake();
+
+                for (auto& worker : workers) worker.join();
+                workers.clear();
+            }
+
+            // Epoch order of the rows, in frame rows
+            void ShuffleOrder() {
+                order.resize(n_rows);
+                std::iota(order.begin(), order.end(), 0);
+
+                if (shuffle_buffer >= n_rows) {
+                    std::shuffle(order.begin(), order.end(), rng);
+                } else if (shuffle_buffer > 1) {
+                    this->BufferShuffle();
+                }
+
+                // Positions in a view become frame rows
+                if (!view_rows.empty()) {
+                    for (size_t& row : order) row = view_rows[row];
+                }
+            }
+
+            // Order through a bounded shuffle buffer: rows stream in sequentially
+            // and each output is a random pick from the buffer.
+            void BufferShuffle() {
+                std::vector<size_t> buffer(order.begin(), order.begin() + shuffle_buffer);
+                size_t in = shuffle_buffer;
+
+                for (size_t out = 0; out < n_rows; ++out) {
+                    size_t pick = std::uniform_int_distribution<size_t>(0, buffer.size() - 1)(rng);
+                    order[out] = buffer[pick];
+
+                    if (in < n_rows) {
+                        buffer[pick] = in++;
+                    } else {
+                        buffer[pick] = buffer.back();
+                        buffer.pop_back();
+                    }
+                }
+            }
+
+            void Work() {
+                size_t seen = 0;
+
+                while (true) {
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        epoch_started.wait(lock, [&] { return stopping || generation != seen; });
+                        if (stopping) return;
+                        seen = generation;
+                    }
+
+                    size_t batch;
+                    while ((batch = next_batch.fetch_add(1)) < batch_count) {
+                        BatchBuffer* buffer = this->Acquire();
+                        if (!buffer) return;
+
+                        this->Fill(batch, *buffer);
+                        this->Push(*ready, buffer);
+                    }
+                }
+            }
+
+            // Free batch buffer, nullptr when the pipeline stops while waiting
+            BatchBuffer* Acquire() {
+                BatchBuffer* buffer;
+
+                if (!free->TryPop(buffer)) {
+                    auto start = std::chrono::steady_clock::now();
+                    if (!free->Pop(buffer, &stopping)) return nullptr;
+                    producer_stall_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+                }
+
+                return buffer;
+            }
+
+            // Producer of a streamed file. Rows go through the shuffle buffer the way
+            // ShuffleOrder walks indices, each output row is a random pick from the
+            // buffer and its slot takes the next row read.
+            void Stream() {
+                const size_t n_features = feature_index.size(), n_targets = target_index.size();
+                const size_t width = n_features + n_targets;
+                const size_t capacity = std::max<size_t>(shuffle_buffer, 1);
+
+                // Row-major shuffle buffer and the incoming row
+                std::vector<float> pool(capacity * width);
+                std::vector<float> row(width);
+
+                size_t seen = 0;
+
+                while (true) {
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        epoch_started.wait(lock, [&] { return stopping || generation != seen; });
+                        if (stopping) return;
+                        seen = generation;
+                    }
+
+                    BatchBuffer* buffer = nullptr;
+                    size_t filled = 0;
+
+                    // Appends a row to the current batch, false when stopping
+                    auto emit = [&](const float* values) {
+                        if (!buffer) {
+                            if (!(buffer = this->Acquire())) return false;
+
+                            buffer->x.value.set_size(batch_size, n_features);
+                            buffer->y.value.set_size(batch_size, n_targets);
+                            filled = 0;
+                        }
+
+                        for (size_t f = 0; f < n_features; ++f) buffer->x.value(filled, f) = (values[f] - shift[f]) * scale[f];
+                        for (size_t t = 0; t < n_targets; ++t) buffer->y.value(filled, t) = values[n_features + t];
+
+                        if (++filled == batch_size) {
+                            this->Publish(*buffer, filled);
+                            buffer = nullptr;
+                        }
+
+                        return true;
+                    };
+
+                    size_t rows = 0, pooled = 0;
+                    stream->Begin();
+
+                    while (const RowChunk* chunk = stream->Next()) {
+                        for (size_t r = 0; r < chunk->rows; ++r, ++rows) {
+                            for (size_t f = 0; f < n_features; ++f) row[f] = chunk->data(r, feature_index[f]);
+                            for (size_t t = 0; t < n_targets; ++t) row[n_features + t] = chunk->data(r, target_index[t]);
+
+                            if (pooled < capacity) {
+                                std::copy(row.begin(), row.end(), pool.begin() + pooled++ * width);
+                                continue;
+                            }
+
+                            float* pick = pool.data() + std::uniform_int_distribution<size_t>(0, capacity - 1)(rng) * width;
+                            if (!emit(pick)) return;
+                            std::copy(row.begin(), row.end(), pick);
+                        }
+
+                        stream->Release(chunk);
+                    }
+
+                    // Drain the buffer in random order
+                    while (pooled > 0) {
+                        float* pick = pool.data() + std::uniform_int_distribution<size_t>(0, pooled - 1)(rng) * width;
+                        if (!emit(pick)) return;
+
+                        --pooled;
+                        std::copy(pool.begin() + pooled * width, pool.begin() + (pooled + 1) * width, pick);
+                    }
+
+                    // The last batch is partial, resize keeps its rows in place
+                    if (buffer) {
+                        buffer->x.value.resize(filled, n_features);
+                        buffer->y.value.resize(filled, n_targets);
+                        this->Publish(*buffer, filled);
+                    }
+
+                    n_rows = rows;
+                    this->Push(*ready, nullptr);
+                }
+            }
+
+            // Hands a filled batch of the stream to the trainer
+            void Publish(BatchBuffer& buffer, size_t count) {
+                buffer.rows = count;
+                buffer.x.shape = { count, buffer.x.value.n_cols };
+                buffer.y.shape = { count, buffer.y.value.n_cols };
+
+                for (auto& map : maps) {
+                    map(buffer.x, buffer.y);
+                }
+
+                this->Push(*ready, &buffer);
+            }
+
+            // The queues are sized for every buffer plus the end-of-stream marker,
+            // so a push that does not fit is a lost batch
+            void Push(BoundedQueue<BatchBuffer*>& queue, BatchBuffer* buffer) {
+                if (!queue.TryPush(buffer))
+                    throw std::logic_error("Pipeline: Batch queue overflow.");
+            }
+
+            void Fill(size_t batch, BatchBuffer& buffer) {
+                const size_t begin = batch * batch_size;
+                const size_t count = std::min(batch_size, n_rows - begin);
+                const size_t* rows = order.data() + begin;
+
+                const size_t n_features = feature_names.size(), n_targets = target_names.size();
+
+                buffer.rows = count;
+                buffer.x.value.set_size(count, n_features);
+                buffer.y.value.set_size(count, n_targets);
+
+                for (size_t col = 0; col < n_features; ++col) {
+                    const ColumnSource feature = df->GetSource(feature_names[col]);
+                    float* out = buffer.x.value.colptr(col);
+                    const float s = shift[col], k = scale[col];
+
+                    // Encoded columns decode into the batch buffer, then scale in place
+                    if (feature.encoded) {
+                        feature.Gather(rows, count, out);
+                        for (size_t i = 0; i < count; ++i) out[i] = (out[i] - s) * k;
+                        continue;
+                    }
+
+                    const float* in = feature.series->data.value.memptr();
+
+                    for (size_t i = 0; i < count; ++i) {
+                        out[i] = (in[rows[i]] - s) * k;
+                    }
+                }
+
+                for (size_t col = 0; col < n_targets; ++col) {
+                    df->GetSource(target_names[col]).Gather(rows, count, buffer.y.value.colptr(col));
+                }
+
+                buffer.x.shape = { count, n_features };
+                buffer.y.shape = { count, n_targets };
+
+                for (auto& map : maps) {
+                    map(buffer.x, buffer.y);
+                }
+            }
+        };
+
+    }
+}
@@ -0,0 +1,202 @@
+#pragma once
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <stratosml/core/data/data.hpp>
+#include <stratosml/core/data/column.hpp>
+#include <stratosml/core/data/split.hpp>
+
+namespace stratos {
+
+    namespace data {
+
+        /*
+         * Fitted column scaling, x' = (x - shift) / divisor per column
+         *
+         *   ColumnScaler scaler(Scaler::Standart);
+         *   scaler.FitTransform(train);
+         *   scaler.Save("scaler.txt");
+         *
+         *   scaler.Transform(test);                  // same statistics, no rescan
+         *
+         * Fit reads every column once for all of its statistics, columns in parallel.
+         */
+        class ColumnScaler {
+
+            Scaler scaler;
+
+            std::vector<std::string> columns;
+            std::unordered_map<std::string, size_t> index;
+            std::vector<float> shift;
+            std::vector<float> divisor;
+
+        public:
+
+            ColumnScaler(Scaler scaler = Scaler::Standart) : scaler(scaler) {}
+
+            // Fits the given columns, all of the frame's when none are given
+            ColumnScaler& Fit(const DataFrame& df, const std::vector<std::string>& cols = {}) {
+                std::vector<std::string> fitted = cols.empty() ? df.GetColumns() : cols;
+
+                std::vector<ColumnStats> stats(fitted.size());
+
+                ParallelFor(fitted.size(), df.GetShape().first, [&](size_t c) {
+                    stats[c] = df.GetSource(fitted[c]).GetStats();
+                });
+
+                return this->SetStats(std::move(fitted), stats);
+            }
+
+            // Fits on the rows of a view only, e.g. the training fold, so test rows
+            // do not leak into the statistics
+            ColumnScaler& Fit(const RowView& view, const std::vector<std::string>& cols = {}) {
+                std::vector<std::string> fitted = cols.empty() ? view.GetFrame().GetColumns() : cols;
+
+                std::vector<ColumnStats> stats(fitted.size());
+
+                ParallelFor(fitted.size(), view.GetSize(), [&](size_t c) {
+                    stats[c] = view.GetStats(fitted[c]);
+                });
+
+                return this->SetStats(std::move(fitted), stats);
+            }
+
+            // Scales the fitted columns of the frame in place, encoded columns are
+            // rewritten through DataFrame::Recode
+            void Transform(DataFrame& df) const {
+                std::vector<Series*> plain;
+                std::vector<size_t> plain_index, encoded_index;
+                std::vector<std::string> encoded;
+
+                // Looked up here, a missing column throws on the calling thread
+                for (size_t c = 0; c < columns.size(); ++c) {
+                    if (df.IsEncoded(columns[c])) {
+                        encoded.push_back(columns[c]);
+                        encoded_index.push_back(c);
+                    } else {
+                        plain.push_back(&df[columns[c]]);
+                        plain_index.push_back(c);
+                    }
+                }
+
+                ParallelFor(plain.size(), df.GetShape().first, [&](size_t i) {
+                    const size_t c = plain_index[i];
+                    ScaleColumn(plain[i]->data.value.memptr(), plain[i]->GetSize(), shift[c], divisor[c]);
+                });
+
+                df.Recode(encoded, [&](size_t i, float* values, std::vector<uint64_t>&) {
+                    const size_t c = encoded_index[i];
+                    ScaleColumn(values, df.GetShape().first, shift[c], divisor[c]);
+                });
+            }
+
+            ColumnScaler& FitTransform(DataFrame& df, const std::vector<std::string>& cols = {}) {
+                this->Fit(df, cols);
+                this->Transform(df);
+                return *this;
+            }
+
+            // Scales a matrix whose columns are the fitted ones in fit order, e.g. a
+            // DataFrame::Select of them or an input to Predict, in place
+            void Transform(Tensor<float>& x) const {
+                if (x.value.n_cols != columns.size())
+                    throw std::invalid_argument("Transform: Matrix columns do not match the fitted columns.");
+
+                ParallelFor(columns.size(), x.value.n_rows, [&](size_t c) {
+                    ScaleColumn(x.value.colptr(c), x.value.n_rows, shift[c], divisor[c]);
+                });
+            }
+
+            bool HasColumn(const std::string& col) const {
+                return index.contains(col);
+            }
+
+            const std::vector<std::string>& GetColumns() const {
+                return columns;
+            }
+
+            // Shift and divisor fitted for a column
+            std::pair<float, float> GetParams(const std::string& col) const {
+                auto it = index.find(col);
+                if (it == index.end())
+                    throw std::invalid_argument("GetParams: Column '" + col + "' was not fitted.");
+
+                return { shift[it->second], divisor[it->second] };
+            }
+
+            // Text file with the scaler kind and one quoted column name, shift and divisor per line
+            bool Save(const std::string& filename) const {
+                std::ofstream out(filename);
+
+                if (!out.is_open()) {
+                    std::cerr << "Error saving the scaler!" << std::endl;
+                    return false;
+                }
+
+                out << "stratos-scaler 1\n" << (int)scaler << " " << columns.size() << "\n";
+                out << std::setprecision(9);
+
+                for (size_t c = 0; c < columns.size(); ++c) {
+                    out << std::quoted(columns[c]) << " " << shift[c] << " " << divisor[c] << "\n";
+                }
+
+                return out.good();
+            }
+
+            bool Load(const std::string& filename) {
+                std::ifstream in(filename);
+
+                std::string magic;
+                int version, kind;
+                size_t n;
+
+                if (!(in >> magic >> version >> kind >> n) || magic != "stratos-scaler" || version != 1) {
+                    std::cerr << "Error loading the scaler: not a scaler file." << std::endl;
+                    return false;
+                }
+
+                std::vector<std::string> names(n);
+                std::vector<float> shifts(n), divisors(n);
+
+                for (size_t c = 0; c < n; ++c) {
+                    if (!(in >> std::quoted(names[c]) >> shifts[c] >> divisors[c])) {
+                        std::cerr << "Error loading the scaler: truncated file." << std::endl;
+                        return false;
+                    }
+                }
+
+                scaler = (Scaler)kind;
+                columns = std::move(names);
+                shift = std::move(shifts);
+                divisor = std::move(divisors);
+
+                index.clear();
+                for (size_t c = 0; c < columns.size(); ++c) index[columns[c]] = c;
+
+                return true;
+            }
+
+        private:
+
+            ColumnScaler& SetStats(std::vector<std::string> fitted, const std::vector<ColumnStats>& stats) {
+                columns = std::move(fitted);
+                shift.resize(columns.size());
+                divisor.resize(columns.size());
+                index.clear();
+
+                for (size_t c = 0; c < columns.size(); ++c) {
+                    std::tie(shift[c], divisor[c]) = ScaleParams(stats[c], scaler);
+                    index[columns[c]] = c;
+                }
+
+                return *this;
+            }
+        };
+
+    }
+
+}
@@ -0,0 +1,323 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <stratosml/core/data/data.hpp>
+#include <stratosml/core/data/column.hpp>
+
+/*
+ *
+ * SPLIT - Train/test splits and k-fold views by row index
+ *
+ * A split draws one permutation of the frame's rows, and every RowView is a
+ * set of ranges of that permutation. The views of all folds share it, so a
+ * k-fold costs one index per row whatever k is, and no row is copied until a
+ * batch of the view is asked for.
+ *
+ */
+
+namespace stratos {
+
+    namespace data {
+
+        /*
+         * Rows of a frame by index, gathered into matrices on demand:
+         *
+         *   auto [train, test] = Split(df, 0.2f, seed);
+         *
+         *   Tensor<float> x = train.Batch({ "x0", "x1" }, 0, 256);   // rows 0 ... 255 of the view
+         *   Pipeline pipeline(train, { "x0", "x1" }, { "y" }, seed);
+         *
+         * The frame has to outlive its views.
+         */
+        class RowView {
+
+            const DataFrame* df = nullptr;
+            std::shared_ptr<const std::vector<size_t>> order;
+            std::vector<std::pair<size_t, size_t>> ranges;      // [begin, end) of order
+            size_t size = 0;
+
+        public:
+
+            RowView() {}
+
+            RowView(const DataFrame& df, std::shared_ptr<const std::vector<size_t>> order, std::vector<std::pair<size_t, size_t>> ranges)
+                : df(&df), order(std::move(order)), ranges(std::move(ranges)) {
+                for (auto [begin, end] : this->ranges) size += end - begin;
+            }
+
+            const DataFrame& GetFrame() const {
+                return *df;
+            }
+
+            size_t GetSize() const {
+                return size;
+            }
+
+            // Frame row of the i-th row of the view
+            size_t operator[](size_t i) const {
+                for (auto [begin, end] : ranges) {
+                    if (i < end - begin) return (*order)[begin + i];
+                    i -= end - begin;
+                }
+
+                throw std::out_of_range("RowView: Row out of range.");
+            }
+
+            // Frame rows of the view rows [begin, begin + count)
+            std::vector<size_t> GetRows(size_t begin = 0, size_t count = SIZE_MAX) const {
+                count = std::min(count, size - std::min(begin, size));
+
+                std::vector<size_t> rows;
+                rows.reserve(count);
+
+                for (auto [first, last] : ranges) {
+                    if (rows.size() == count) break;
+
+                    if (begin >= last - first) {
+                        begin -= last - first;
+                        continue;
+                    }
+
+                    const size_t take = std::min(count - rows.size(), last - first - begin);
+                    rows.insert(rows.end(), order->begin() + first + begin, order->begin() + first + begin + take);
+                    begin = 0;
+                }
+
+                return rows;
+            }
+
+            // The columns of view rows [begin, begin + count) as a new (count, n) matrix
+            Tensor<float> Batch(const std::vector<std::string>& cols, size_t begin, size_t count) const {
+                if (cols.empty())
+                    throw std::invalid_argument("Batch: No columns given.");
+
+                const std::vector<size_t> rows = this->GetRows(begin, count);
+                arma::Mat<float> out(rows.size(), cols.size());
+
+                for (size_t c = 0; c < cols.size(); ++c) {
+                    df->GetSource(cols[c]).Gather(rows.data(), rows.size(), out.colptr(c));
+                }
+
+                return Tensor<float>(std::move(out));
+            }
+
+            // Every row of the view, copied
+            Tensor<float> Select(const std::vector<std::string>& cols) const {
+                return this->Batch(cols, 0, size);
+            }
+
+            // Codes of a categorical column for view rows [begin, begin + count)
+            std::vector<uint32_t> Codes(const std::string& col, size_t begin, size_t count) const {
+                const std::vector<size_t> rows = this->GetRows(begin, count);
+                return df->GetCategorical(col).Codes(rows.data(), rows.size());
+            }
+
+            // Statistics of a column over the view's rows only, e.g. to fit a
+            // scaler on a training fold
+            ColumnStats GetStats(const std::string& col) const {
+                const ColumnSource column = df->GetSource(col);
+
+                ColumnStats stats;
+                for (auto [begin, end] : ranges) stats.Merge(column.GetStats(order->data() + begin, end - begin));
+
+                return stats;
+            }
+        };
+
+        // Rows grouped by the value of a column, a categorical column by its codes.
+        // Groups are in order of first appearance, rows ascending.
+        inline std::vector<std::vector<size_t>> Strata(const DataFrame& df, const std::string& col) {
+            const size_t rows = df.GetShape().first;
+
+            std::vector<std::vector<size_t>> strata;
+            std::unordered_map<uint32_t, size_t> group;
+
+            auto add = [&](uint32_t key, size_t row) {
+                auto [it, added] = group.emplace(key, strata.size());
+                if (added) strata.emplace_back();
+                strata[it->second].push_back(row);
+            };
+
+            if (df.HasCategorical(col)) {
+                const CategoricalColumn& column = df.GetCategorical(col);
+                for (size_t row = 0; row < rows; ++row) add(column.Code(row), row);
+                return strata;
+            }
+
+            // Encoded columns are decoded for the grouping
+            std::vector<float> decoded;
+            const float* values;
+
+            if (df.IsEncoded(col)) {
+                decoded.resize(rows);
+                df.GetEncoded(col).Decode(0, rows, decoded.data());
+                values = decoded.data();
+            } else {
+                values = df[col].data.value.memptr();
+            }
+
+            for (size_t row = 0; row < rows; ++row) {
+                // One group for every NaN and for both zeros
+                const float value = std::isnan(values[row]) ? NAN : values[row] == 0 ? 0.0f : values[row];
+                add(std::bit_cast<uint32_t>(value), row);
+            }
+
+            return strata;
+        }
+
+        // A view's rows in random order, or ascending frame order without shuffling
+        inline void OrderRows(std::vector<size_t>::iterator begin, std::vector<size_t>::iterator end, bool shuffle, std::mt19937_64& rng) {
+            if (shuffle) {
+                std::shuffle(begin, end, rng);
+            } else {
+                std::sort(begin, end);
+            }
+        }
+
+        /*
+         * Train and test views of a frame, test_ratio of the rows rounded to the
+         * nearest row go to the test view. With stratify naming a column, every
+         * class of that column is split in the same ratio.
+         */
+        inline std::pair<RowView, RowView> Split(const DataFrame& df, float test_ratio = 0.25f, size_t seed = std::random_device{}(),
+            bool shuffle = true, const std::string& stratify = "") {
+            if (!(test_ratio > 0 && test_ratio < 1))
+                throw std::invalid_argument("Split: Test ratio should be between 0 and 1.");
+
+            const size_t rows = df.GetShape().first;
+            std::mt19937_64 rng(seed);
+
+            std::vector<std::vector<size_t>> strata;
+
+            if (stratify.empty()) {
+                strata.emplace_back(rows);
+                std::iota(strata[0].begin(), strata[0].end(), 0);
+            } else {
+                strata = Strata(df, stratify);
+            }
+
+            std::vector<size_t> train, test;
+
+            for (std::vector<size_t>& stratum : strata) {
+                if (shuffle) std::shuffle(stratum.begin(), stratum.end(), rng);
+
+                const size_t n_test = std::lround(test_ratio * stratum.size());
+
+                train.insert(train.end(), stratum.begin(), stratum.end() - n_test);
+                test.insert(test.end(), stratum.end() - n_test, stratum.end());
+            }
+
+            auto order = std::make_shared<std::vector<size_t>>(std::move(train));
+            const size_t n_train = order->size();
+            order->insert(order->end(), test.begin(), test.end());
+
+            // Classes would otherwise follow each other
+            OrderRows(order->begin(), order->begin() + n_train, shuffle, rng);
+            OrderRows(order->begin() + n_train, order->end(), shuffle, rng);
+
+            return {
+                RowView(df, order, { { 0, n_train } }),
+                RowView(df, order, { { n_train, rows } })
+            };
+        }
+
+        /*
+         * k train/test views over one shared permutation, every row is in the test
+         * view of exactly one fold:
+         *
+         *   KFold folds(df, 5, seed, true, "label");
+         *
+         *   for (size_t k = 0; k < folds.GetFolds(); ++k) {
+         *       RowView train = folds.Train(k), test = folds.Test(k);
+         *       ...
+         *   }
+         *
+         * Folds differ in size by at most one row. With stratify, the rows of
+         * every class are dealt over the folds in turn.
+         */
+        class KFold {
+
+            const DataFrame* df;
+            std::shared_ptr<const std::vector<size_t>> order;
+            std::vector<size_t> bounds;         // fold k is [bounds[k], bounds[k + 1]) of order
+
+        public:
+
+            KFold(const DataFrame& df, size_t k = 5, size_t seed = std::random_device{}(), bool shuffle = true, const std::string& stratify = "")
+                : df(&df) {
+                const size_t rows = df.GetShape().first;
+
+                if (k < 2 || k > rows)
+                    throw std::invalid_argument("KFold: Fold count should be between 2 and the row count.");
+
+                std::mt19937_64 rng(seed);
+                std::vector<std::vector<size_t>> folds(k);
+
+                if (stratify.empty()) {
+                    std::vector<size_t> all(rows);
+                    std::iota(all.begin(), all.end(), 0);
+                    if (shuffle) std::shuffle(all.begin(), all.end(), rng);
+
+                    for (size_t f = 0, begin = 0; f < k; ++f) {
+                        const size_t end = begin + rows / k + (f < rows % k);
+                        folds[f].assign(all.begin() + begin, all.begin() + end);
+                        begin = end;
+                    }
+                } else {
+                    size_t next = 0;
+
+                    for (std::vector<size_t>& stratum : Strata(df, stratify)) {
+                        if (shuffle) std::shuffle(stratum.begin(), stratum.end(), rng);
+                        for (size_t row : stratum) folds[next++ % k].push_back(row);
+                    }
+                }
+
+                auto permutation = std::make_shared<std::vector<size_t>>();
+                permutation->reserve(rows);
+                bounds.push_back(0);
+
+                for (std::vector<size_t>& fold : folds) {
+                    OrderRows(fold.begin(), fold.end(), shuffle, rng);
+                    permutation->insert(permutation->end(), fold.begin(), fold.end());
+                    bounds.push_back(permutation->size());
+                }
+
+                order = std::move(permutation);
+            }
+
+            size_t GetFolds() const {
+                return bounds.size() - 1;
+            }
+
+            // Every fold but the k-th
+            RowView Train(size_t k) const {
+                this->Check(k);
+                return RowView(*df, order, { { 0, bounds[k] }, { bounds[k + 1], order->size() } });
+            }
+
+            RowView Test(size_t k) const {
+                this->Check(k);
+                return RowView(*df, order, { { bounds[k], bounds[k + 1] } });
+            }
+
+        private:
+
+            void Check(size_t k) const {
+                if (k >= this->GetFolds())
+                    throw std::out_of_range("KFold: Fold out of range.");
+            }
+        };
+
+    }
+
+}
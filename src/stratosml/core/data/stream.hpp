@@ -0,0 +1,368 @@
+#pragma once
+#include <armadillo>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <stratosml/core/data/data.hpp>
+#include <stratosml/core/data/csv.hpp>
+#include <stratosml/core/data/binary.hpp>
+
+/*
+ *
+ * STREAM - Out-of-core row sources
+ *
+ * A RowSource reads a file front to back in row chunks and can be rewound, so
+ * a dataset is scanned once per epoch without ever being held in memory. The
+ * StreamReader reads the next chunks on a background thread while the current
+ * one is consumed, memory stays at (read_ahead + 1) chunks.
+ *
+ */
+
+namespace stratos {
+
+    namespace data {
+
+        class RowSource {
+
+        public:
+
+            virtual ~RowSource() {}
+
+            virtual const std::vector<std::string>& GetColumns() const = 0;
+
+            // Reads up to max_rows rows into the first rows of chunk, which has one
+            // column per source column. Returns the rows read, 0 at the end.
+            virtual size_t Read(arma::Mat<float>& chunk, size_t max_rows) = 0;
+
+            // Back to the first row
+            virtual void Rewind() = 0;
+        };
+
+        // CSV lines parsed out of a fixed-size read buffer, empty lines are skipped
+        class CSVSource : public RowSource {
+
+            std::ifstream file;
+            std::streampos body;
+            std::vector<std::string> columns;
+
+            std::vector<char> buffer;
+            size_t begin = 0, end = 0;      // unparsed bytes in the buffer
+            bool exhausted = false;
+
+        public:
+
+            static constexpr size_t block_bytes = 1 << 22;
+
+            CSVSource(const std::string& filename) : file(filename, std::ios::binary), buffer(block_bytes) {
+                if (!file.is_open())
+                    throw std::invalid_argument("CSVSource: Cannot open '" + filename + "'.");
+
+                std::string header;
+                std::getline(file, header);
+                columns = SplitLabels(header.data(), header.data() + header.size());
+
+                body = file.tellg();
+            }
+
+            const std::vector<std::string>& GetColumns() const override {
+                return columns;
+            }
+
+            size_t Read(arma::Mat<float>& chunk, size_t max_rows) override {
+                size_t rows = 0;
+
+                while (rows < max_rows) {
+                    const char* data = buffer.data();
+                    const char* newline = static_cast<const char*>(std::memchr(data + begin, '\n', end - begin));
+
+                    const char* line = data + begin;
+                    const char* line_end;
+
+                    if (newline) {
+                        line_end = newline;
+                        begin = newline + 1 - data;
+                    } else if (this->Refill()) {
+                        continue;
+                    } else if (begin < end) {
+                        // Last line without a newline
+                        line_end = data + end;
+                        begin = end;
+                    } else {
+                        break;
+                    }
+
+                    if (line_end > line && line_end[-1] == '\r') --line_end;
+                    if (line_end == line) continue;
+
+                    for (size_t c = 0; c < columns.size(); ++c) {
+                        float value = NAN;
+
+                        if (line < line_end) {
+                            line = ParseCell(line, line_end, value);
+                            if (line < line_end) ++line;
+                        }
+
+                        chunk(rows, c) = value;
+                    }
+
+                    ++rows;
+                }
+
+                return rows;
+            }
+
+            void Rewind() override {
+                file.clear();
+                file.seekg(body);
+                begin = end = 0;
+                exhausted = false;
+            }
+
+        private:
+
+            // Moves the unparsed tail to the front and reads behind it, the buffer
+            // grows only for lines longer than itself. False at the end of the file.
+            bool Refill() {
+                if (exhausted) return false;
+
+                std::memmove(buffer.data(), buffer.data() + begin, end - begin);
+                end -= begin;
+                begin = 0;
+
+                if (end == buffer.size()) buffer.resize(buffer.size() * 2);
+
+                file.read(buffer.data() + end, buffer.size() - end);
+                const size_t read = file.gcount();
+
+                end += read;
+                exhausted = read == 0;
+
+                return read > 0;
+            }
+        };
+
+        // Rows copied out of a mapped .stratos file. Pages behind the cursor are
+        // dropped from the mapping, so resident memory does not grow with the file.
+        class BinarySource : public RowSource {
+
+            MappedFile file;
+            BinaryHeader header;
+            std::vector<std::string> columns;
+            const float* block = nullptr;
+            size_t cursor = 0;
+
+        public:
+
+            BinarySource(const std::string& filename) : file(filename) {
+                if (!file.IsOpen())
+                    throw std::invalid_argument("BinarySource: Cannot open '" + filename + "'.");
+
+                size_t data_offset;
+                if (const char* error = ReadBinaryLayout(file, header, columns, data_offset))
+                    throw std::invalid_argument(std::string("BinarySource: ") + error);
+
+                block = reinterpret_cast<const float*>(file.begin() + data_offset);
+                file.Advise(MADV_SEQUENTIAL);
+            }
+
+            const std::vector<std::string>& GetColumns() const override {
+                return columns;
+            }
+
+            size_t Read(arma::Mat<float>& chunk, size_t max_rows) override {
+                const size_t rows = std::min<size_t>(max_rows, header.rows - cursor);
+
+                for (size_t c = 0; c < columns.size(); ++c) {
+                    const float* column = block + c * header.stride;
+                    std::memcpy(chunk.colptr(c), column + cursor, rows * sizeof(float));
+
+                    this->Drop(column + cursor, column + cursor + rows);
+                }
+
+                cursor += rows;
+                return rows;
+            }
+
+            void Rewind() override {
+                cursor = 0;
+            }
+
+        private:
+
+            // Releases the whole pages inside [from, to)
+            void Drop(const float* from, const float* to) const {
+                const uintptr_t page = sysconf(_SC_PAGESIZE);
+                const uintptr_t first = ((uintptr_t)from + page - 1) / page * page;
+                const uintptr_t last = (uintptr_t)to / page * page;
+
+                if (last > first) madvise((void*)first, last - first, MADV_DONTNEED);
+            }
+        };
+
+        // Source for a .csv or .stratos file
+        inline std::unique_ptr<RowSource> OpenSource(const std::string& filename) {
+            const std::string ext = GetExtension(filename);
+
+            if (ext == "csv") return std::make_unique<CSVSource>(filename);
+            if (ext == "stratos") return std::make_unique<BinarySource>(filename);
+
+            throw std::invalid_argument("OpenSource: Unknown extension '" + ext + "'.");
+        }
+
+        // A chunk of rows read ahead, only the first rows are valid
+        struct RowChunk {
+            arma::Mat<float> data;
+            size_t rows = 0;
+        };
+
+        /*
+         * Reads the chunks of one pass over a source on a background thread:
+         *
+         *   reader.Begin();
+         *   while (const RowChunk* chunk = reader.Next()) {
+         *       ...
+         *       reader.Release(chunk);
+         *   }
+         */
+        class StreamReader {
+
+            std::unique_ptr<RowSource> source;
+            size_t chunk_rows;
+
+            std::vector<RowChunk> chunks;
+            std::vector<RowChunk*> free;
+            std::deque<RowChunk*> ready;
+
+            std::thread reader;
+            std::mutex mutex;
+            std::condition_variable changed;
+            bool finished = false;
+            bool stopping = false;
+            std::exception_ptr error;
+
+        public:
+
+            StreamReader(std::unique_ptr<RowSource> source, size_t chunk_rows = 65536, size_t read_ahead = 2)
+                : source(std::move(source)), chunk_rows(chunk_rows), chunks(read_ahead + 1) {
+                if (chunk_rows < 1)
+                    throw std::invalid_argument("Chunk size should be bigger than zero.");
+
+                for (RowChunk& chunk : chunks) {
+                    chunk.data.set_size(chunk_rows, this->source->GetColumns().size());
+                }
+            }
+
+            StreamReader(const StreamReader&) = delete;
+
+            ~StreamReader() {
+                this->Stop();
+            }
+
+            const std::vector<std::string>& GetColumns() const {
+                return source->GetColumns();
+            }
+
+            // Rewinds the source and starts reading ahead
+            void Begin() {
+                this->Stop();
+                source->Rewind();
+
+                free.clear();
+                ready.clear();
+                for (RowChunk& chunk : chunks) free.push_back(&chunk);
+
+                finished = false;
+                stopping = false;
+                error = nullptr;
+
+                reader = std::thread([this] { this->Read(); });
+            }
+
+            // Next chunk of the pass or nullptr once the source is exhausted.
+            // The chunk has to be handed back with Release().
+            const RowChunk* Next() {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&] { return !ready.empty() || finished; });
+
+                if (ready.empty()) {
+                    if (error) std::rethrow_exception(error);
+                    return nullptr;
+                }
+
+                RowChunk* chunk = ready.front();
+                ready.pop_front();
+                return chunk;
+            }
+
+            void Release(const RowChunk* chunk) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    free.push_back(const_cast<RowChunk*>(chunk));
+                }
+                changed.notify_all();
+            }
+
+        private:
+
+            void Stop() {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    stopping = true;
+                }
+                changed.notify_all();
+
+                if (reader.joinable()) reader.join();
+            }
+
+            void Read() {
+                while (true) {
+                    RowChunk* chunk;
+
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        changed.wait(lock, [&] { return !free.empty() || stopping; });
+                        if (stopping) return;
+
+                        chunk = free.back();
+                        free.pop_back();
+                    }
+
+                    try {
+                        chunk->rows = source->Read(chunk->data, chunk_rows);
+                    } catch (...) {
+                        chunk->rows = 0;
+
+                        std::lock_guard<std::mutex> lock(mutex);
+                        error = std::current_exception();
+                    }
+
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+
+                        if (chunk->rows > 0) {
+                            ready.push_back(chunk);
+                        } else {
+                            free.push_back(chunk);
+                            finished = true;
+                        }
+                    }
+                    changed.notify_all();
+
+                    if (chunk->rows == 0) return;
+                }
+            }
+        };
+
+    }
+
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cmath>
+
+namespace stratos {
+
+    namespace layers {
+
+        enum class Padding { Valid, Same };
+
+        struct ConvOptions {
+            size_t stride = 1;
+            Padding padding = Padding::Valid;
+            Layout layout = Layout::NCHW;
+            ConvAlgorithm algorithm = ConvAlgorithm::Auto;
+        };
+
+        // 2D convolution over rows of flattened (channels, height, width) samples.
+        // The input shape is only needed on the first layer of a model, the layout
+        // applies to both the input and the output of the layer.
+        class Conv2D : public Layer {
+
+            std::shared_ptr<var> biases;
+            std::shared_ptr<var> kernel;
+
+            TensorShape input_shape;
+            ConvOptions options;
+
+        protected:
+
+            ConvGeometry geometry;
+
+        public:
+
+            Conv2D(size_t filters, size_t kernel_h, size_t kernel_w, TensorShape input_shape = {}, Activation* activation = new Linear(), ConvOptions options = {}, std::string name = "")
+                : input_shape(input_shape), options(options) {
+
+                if (filters < 1 || kernel_h < 1 || kernel_w < 1 || options.stride < 1)
+                    throw std::invalid_argument("Convolution filters, kernel size and stride should be bigger than zero.");
+
+                delete this->activation;
+                this->activation = activation;
+                this->name = name;
+
+                this->geometry.filters = filters;
+                this->geometry.kernel_h = kernel_h;
+                this->geometry.kernel_w = kernel_w;
+                this->geometry.stride_h = this->geometry.stride_w = options.stride;
+                this->geometry.layout = options.layout;
+            }
+
+            void build(TensorShape shape) override {
+                if (this->input_shape.rank() == 3) {
+                    if (shape.size() != this->input_shape.size())
+                        throw std::invalid_argument("Conv2D input shape does not match the size of its input.");
+
+                    shape = this->input_shape;
+                }
+
+                if (shape.rank() != 3)
+                    throw std::invalid_argument("Conv2D needs a (channels, height, width) input shape.");
+
+                ConvGeometry& g = this->geometry;
+                g.channels = shape[0];
+                g.height = shape[1];
+                g.width = shape[2];
+
+                auto output = [this](size_t size, size_t kernel, size_t stride, size_t& pad) {
+                    if (this->options.padding == Padding::Valid) {
+                        if (size < kernel)
+                            throw std::invalid_argument("Convolution kernel is larger than its input.");
+
+                        pad = 0;
+                        return (size - kernel) / stride + 1;
+                    }
+
+                    const size_t out = (size + stride - 1) / stride;
+                    const size_t total = (out - 1) * stride + kernel > size ? (out - 1) * stride + kernel - size : 0;
+
+                    pad = total / 2;
+                    return out;
+                };
+
+                g.out_h = output(g.height, g.kernel_h, g.stride_h, g.pad_top);
+                g.out_w = output(g.width, g.kernel_w, g.stride_w, g.pad_left);
+
+                this->units = g.output_size();
+
+                this->kernel = this->add_weight({ g.channels * g.taps(), g.filters });
+                this->biases = this->add_weight({ g.filters });
+
+                // Glorot uniform, zero kernels would keep every filter identical
+                const float limit = std::sqrt(6.0f / ((g.channels + g.filters) * g.taps()));
+                this->kernel->expr->val.value.randu();
+                this->kernel->expr->val.value = (this->kernel->expr->val.value * 2.0f - 1.0f) * limit;
+                this->biases->expr->val.value.zeros();
+            }
+
+            TensorShape output_shape() const override {
+                return TensorShape({ geometry.filters, geometry.out_h, geometry.out_w });
+            }
+
+            var forward(ConstantOrVariable<float>& inputs) override {
+                if (this->activation->elementwise())
+                    return conv(inputs.expr, this->kernel->expr, this->biases->expr, this->geometry, this->activation, this->options.algorithm);
+
+                static const Linear linear;
+                var z = conv(inputs.expr, this->kernel->expr, this->biases->expr, this->geometry, &linear, this->options.algorithm);
+
+                return (*this->activation)(z);
+            }
+
+        };
+
+        // 1D convolution over rows of flattened (channels, length) samples, NCHW
+        // meaning channel-major and NHWC step-major (channels interleaved).
+        class Conv1D : public Conv2D {
+
+        public:
+
+            Conv1D(size_t filters, size_t kernel_size, TensorShape input_shape = {}, Activation* activation = new Linear(), ConvOptions options = {}, std::string name = "")
+                : Conv2D(filters, 1, kernel_size, input_shape.rank() == 2 ? TensorShape({ input_shape[0], 1, input_shape[1] }) : TensorShape(), activation, options, name) {}
+
+            void build(TensorShape shape) override {
+                if (shape.rank() == 2)
+                    shape = TensorShape({ shape[0], 1, shape[1] });
+
+                if (shape.rank() == 3 && shape[1] != 1)
+                    throw std::invalid_argument("Conv1D needs a (channels, length) input shape.");
+
+                Conv2D::build(shape);
+            }
+
+            TensorShape output_shape() const override {
+                return TensorShape({ geometry.filters, geometry.out_w });
+            }
+
+        };
+
+    }
+}
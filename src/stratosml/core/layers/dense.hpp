@@ -23,12 +23,44 @@ namespace stratos {
                 this->biases = this->add_weight({ units });
             }
 
+            Dense(size_t units, Activation* activation, std::string name = "") : Dense(units, name) {
+                delete this->activation;
+                this->activation = activation;
+            }
+
             void build(TensorShape input_shape) {
-                this->kernel = this->add_weight({ input_shape[input_shape.rank() - 1], units });
+                this->kernel = this->add_weight({ input_shape.size(), units });
+            }
+
+            // Overwrites the kernel and bias, e.g. with a closed-form solution
+            void assign_weights(const arma::Mat<float>& kernel, const arma::Mat<float>& bias) {
+                if (kernel.n_rows != this->kernel->expr->val.value.n_rows || kernel.n_cols != units || bias.n_elem != units)
+                    throw std::invalid_argument("Dense weights do not match the layer shape.");
+
+                this->kernel->expr->val.value = kernel;
+                this->biases->expr->val.value = arma::reshape(bias, units, 1);
             }
 
+            // Folds a following per-unit affine map x * scale + shift into the kernel and
+            // bias, the activation replaces this layer's own (Linear) one.
+            void fold(const arma::Mat<float>& scale, const arma::Mat<float>& shift, Activation* activation) {
+                arma::Mat<float>& w = this->kernel->expr->val.value;
+                arma::Mat<float>& b = this->biases->expr->val.value;
+
+                w.each_row() %= scale.t();
+                b = b % scale + shift;
+
+                delete this->activation;
+                this->activation = activation;
+            }
+
+            // Fused GEMM + bias + activation node, row-wise activations run on their own
             var forward(ConstantOrVariable<float>& inputs) override {
-                var z = (inputs * (*this->kernel)) + (*this->biases);
+                if (this->activation->elementwise())
+                    return dense(inputs.expr, this->kernel->expr, this->biases->expr, this->activation);
+
+                static const Linear linear;
+                var z = dense(inputs.expr, this->kernel->expr, this->biases->expr, &linear);
 
                 return (*this->activation)(z);
             }
@@ -0,0 +1,55 @@
+#pragma once
+
+namespace stratos {
+
+    namespace layers {
+
+        // Learned vectors of integer categories. Every input column holds category
+        // indices below the vocabulary size, the output is the k input columns'
+        // embeddings side by side, as a (dim, k) NHWC sample for Conv1D.
+        // The table's gradient only holds the rows looked up in the batch.
+        class Embedding : public Layer {
+
+            std::shared_ptr<var> table;
+
+            size_t vocabulary;
+            size_t dim;
+            size_t input_length = 0;
+
+        public:
+
+            Embedding(size_t vocabulary, size_t dim, std::string name = "") : vocabulary(vocabulary), dim(dim) {
+                if (vocabulary < 1 || dim < 1)
+                    throw std::invalid_argument("Embedding vocabulary and dimension should be bigger than zero.");
+
+                this->name = name;
+            }
+
+            void build(TensorShape input_shape) override {
+                this->input_length = input_shape.size();
+                this->units = this->input_length * this->dim;
+
+                this->table = this->add_weight({ vocabulary, dim });
+
+                arma::Mat<float> values(vocabulary, dim, arma::fill::randn);
+                this->table->expr = std::make_shared<SparseVariableNode<float>>(Tensor<float>(values * 0.05f));
+            }
+
+            TensorShape output_shape() const override {
+                return TensorShape({ dim, input_length });
+            }
+
+            var forward(ConstantOrVariable<float>& inputs) override {
+                return embedding(inputs.expr, this->table->expr);
+            }
+
+            // Forward from the integer codes of rows samples, e.g. CategoricalColumn::Codes,
+            // k = codes.size() / rows codes per sample
+            var lookup(std::vector<uint32_t>&& codes, size_t rows) {
+                return embedding(std::move(codes), rows, this->table->expr);
+            }
+
+        };
+
+    }
+}
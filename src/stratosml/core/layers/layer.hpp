@@ -41,6 +41,17 @@ namespace stratos {
             std::vector<std::shared_ptr<var>> weights;
             std::string name;
 
+            // Keep only this layer's output alive during training, the activations of
+            // the layers since the previous checkpointed layer are recomputed on backward.
+            bool checkpointed = false;
+
+            // Set by the model, layers behaving differently at inference (e.g. BatchNorm) read it
+            bool training = false;
+
+            // Set while a checkpointed segment is recomputed on backward. Side effects
+            // of forward (e.g. running statistics) already happened and are skipped.
+            bool rematerializing = false;
+
             Layer() {}
 
             Layer(size_t units, std::string name = "") : name(name), units(units) {
@@ -48,14 +59,21 @@ namespace stratos {
                     throw std::invalid_argument("The number of neurons in a layer should be bigger than zero.");
             }
 
-            ~Layer() {
+            // Models and FoldBatchNorm delete layers through this base
+            virtual ~Layer() {
                 delete this->activation;
             }
 
             virtual var forward(ConstantOrVariable<float>& inputs) = 0;
 
+            // input_shape is the shape of one sample
             virtual void build(TensorShape input_shape) {}
 
+            // Shape of one output sample, the input shape of the next layer
+            virtual TensorShape output_shape() const {
+                return TensorShape({ units });
+            }
+
         };
 
     }
@@ -1,3 +1,7 @@
 #pragma once
 #include "layer.hpp"
-#include "dense.hpp"
\ No newline at end of file
+#include "dense.hpp"
+#include "conv.hpp"
+#include "embedding.hpp"
+#include "recurrent.hpp"
+#include "normalization.hpp"
\ No newline at end of file
@@ -0,0 +1,124 @@
+#pragma once
+
+namespace stratos {
+
+    namespace layers {
+
+        // Normalizes every input column over the batch, then scales and shifts it by
+        // learned gamma and beta. Training uses the batch statistics and updates
+        // running ones, inference uses the running statistics. The activation is
+        // applied in the same pass, like in Dense.
+        class BatchNorm : public Layer {
+
+            std::shared_ptr<var> gamma;
+            std::shared_ptr<var> beta;
+
+            arma::Mat<float> running_mean;
+            arma::Mat<float> running_variance;
+
+            float momentum;
+            float epsilon;
+
+        public:
+
+            BatchNorm(Activation* activation = new Linear(), float momentum = 0.99f, float epsilon = 1e-3f, std::string name = "")
+                : momentum(momentum), epsilon(epsilon) {
+
+                if (momentum < 0 || momentum >= 1)
+                    throw std::invalid_argument("BatchNorm momentum must be at least zero and below one.");
+
+                delete this->activation;
+                this->activation = activation;
+                this->name = name;
+            }
+
+            void build(TensorShape input_shape) override {
+                this->units = input_shape.size();
+
+                this->gamma = this->add_weight({ units });
+                this->beta = this->add_weight({ units });
+
+                this->gamma->expr->val.value.ones();
+                this->beta->expr->val.value.zeros();
+
+                this->running_mean.zeros(units, 1);
+                this->running_variance.ones(units, 1);
+            }
+
+            var forward(ConstantOrVariable<float>& inputs) override {
+                static const Linear linear;
+                const Activation* fused = this->activation->elementwise() ? this->activation : &linear;
+
+                std::vector<float> mean, variance;
+
+                var z = batch_norm(inputs.expr, this->gamma->expr, this->beta->expr, running_mean, running_variance, epsilon, this->training, fused, &mean, &variance);
+
+                if (this->training && !this->rematerializing) {
+                    const size_t n = inputs.expr->val.value.n_rows;
+                    const float unbiased = n > 1 ? (float)n / (n - 1) : 1.0f;
+
+                    for (size_t j = 0; j < units; ++j) {
+                        running_mean(j) = momentum * running_mean(j) + (1 - momentum) * mean[j];
+                        running_variance(j) = momentum * running_variance(j) + (1 - momentum) * variance[j] * unbiased;
+                    }
+                }
+
+                return fused == this->activation ? z : (*this->activation)(z);
+            }
+
+            // Inference as the affine map x * scale + shift followed by the activation
+            void affine(arma::Mat<float>& scale, arma::Mat<float>& shift) const {
+                scale = this->gamma->expr->val.value / arma::sqrt(running_variance + epsilon);
+                shift = this->beta->expr->val.value - running_mean % scale;
+            }
+
+            // Hands the activation over to the layer this one is folded into
+            Activation* release_activation() {
+                Activation* released = this->activation;
+                this->activation = new Linear();
+                return released;
+            }
+
+        };
+
+        // Normalizes every row over its features, then scales and shifts each feature
+        // by learned gamma and beta. Behaves the same in training and inference.
+        class LayerNorm : public Layer {
+
+            std::shared_ptr<var> gamma;
+            std::shared_ptr<var> beta;
+
+            float epsilon;
+
+        public:
+
+            LayerNorm(Activation* activation = new Linear(), float epsilon = 1e-3f, std::string name = "") : epsilon(epsilon) {
+                delete this->activation;
+                this->activation = activation;
+                this->name = name;
+            }
+
+            void build(TensorShape input_shape) override {
+                this->units = input_shape.size();
+
+                this->gamma = this->add_weight({ units });
+                this->beta = this->add_weight({ units });
+
+                this->gamma->expr->val.value.ones();
+                this->beta->expr->val.value.zeros();
+            }
+
+            var forward(ConstantOrVariable<float>& inputs) override {
+                if (this->activation->elementwise())
+                    return layer_norm(inputs.expr, this->gamma->expr, this->beta->expr, epsilon, this->activation);
+
+                static const Linear linear;
+                var z = layer_norm(inputs.expr, this->gamma->expr, this->beta->expr, epsilon, &linear);
+
+                return (*this->activation)(z);
+            }
+
+        };
+
+    }
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cmath>
+
+namespace stratos {
+
+    namespace layers {
+
+        // Base of the recurrent layers. Inputs are rows of flattened (features, steps)
+        // sequences, step-major like the NHWC layout of Conv1D and the Embedding output.
+        // The input shape is only needed on the first layer of a model. With
+        // return_sequences the hidden state of every step is output, otherwise the last.
+        // bptt > 0 truncates backpropagation to chunks of bptt steps, bounding the
+        // activation memory of long sequences to one chunk.
+        class Recurrent : public Layer {
+
+        protected:
+
+            std::shared_ptr<var> kernel;
+            std::shared_ptr<var> recurrent_kernel;
+            std::shared_ptr<var> biases;
+
+            TensorShape input_shape;
+            size_t hidden;
+            size_t n_gates;
+            size_t steps = 0;
+            size_t bptt;
+            bool return_sequences;
+
+            static void glorot(std::shared_ptr<var>& weight) {
+                arma::Mat<float>& w = weight->expr->val.value;
+                const float limit = std::sqrt(6.0f / (w.n_rows + w.n_cols));
+
+                w.randu();
+                w = (w * 2.0f - 1.0f) * limit;
+            }
+
+        public:
+
+            Recurrent(size_t units, size_t n_gates, TensorShape input_shape, bool return_sequences, size_t bptt, std::string name)
+                : input_shape(input_shape), hidden(units), n_gates(n_gates), bptt(bptt), return_sequences(return_sequences) {
+
+                if (units < 1)
+                    throw std::invalid_argument("The number of units in a layer should be bigger than zero.");
+
+                this->name = name;
+            }
+
+            void build(TensorShape shape) override {
+                if (this->input_shape.rank() == 2) {
+                    if (shape.size() != this->input_shape.size())
+                        throw std::invalid_argument("Recurrent input shape does not match the size of its input.");
+
+                    shape = this->input_shape;
+                }
+
+                if (shape.rank() != 2)
+                    throw std::invalid_argument("Recurrent layers need a (features, steps) input shape.");
+
+                const size_t features = shape[0];
+                this->steps = shape[1];
+                this->units = return_sequences ? hidden * steps : hidden;
+
+                this->kernel = this->add_weight({ features, n_gates * hidden });
+                this->recurrent_kernel = this->add_weight({ hidden, n_gates * hidden });
+                this->biases = this->add_weight({ n_gates * hidden });
+
+                glorot(this->kernel);
+                glorot(this->recurrent_kernel);
+                this->biases->expr->val.value.zeros();
+            }
+
+            TensorShape output_shape() const override {
+                if (return_sequences)
+                    return TensorShape({ hidden, steps });
+
+                return TensorShape({ hidden });
+            }
+
+        };
+
+        class LSTM : public Recurrent {
+
+        public:
+
+            LSTM(size_t units, TensorShape input_shape = {}, bool return_sequences = false, size_t bptt = 0, std::string name = "")
+                : Recurrent(units, 4, input_shape, return_sequences, bptt, name) {}
+
+            void build(TensorShape shape) override {
+                Recurrent::build(shape);
+
+                // Forget gate bias of one, remembering by default
+                this->biases->expr->val.value.rows(hidden, 2 * hidden - 1).ones();
+            }
+
+            var forward(ConstantOrVariable<float>& inputs) override {
+                return lstm(inputs.expr, this->kernel->expr, this->recurrent_kernel->expr, this->biases->expr, steps, bptt, return_sequences);
+            }
+
+        };
+
+        class GRU : public Recurrent {
+
+            std::shared_ptr<var> recurrent_biases;
+
+        public:
+
+            GRU(size_t units, TensorShape input_shape = {}, bool return_sequences = false, size_t bptt = 0, std::string name = "")
+                : Recurrent(units, 3, input_shape, return_sequences, bptt, name) {}
+
+            void build(TensorShape shape) override {
+                Recurrent::build(shape);
+
+                this->recurrent_biases = this->add_weight({ n_gates * hidden });
+                this->recurrent_biases->expr->val.value.zeros();
+            }
+
+            var forward(ConstantOrVariable<float>& inputs) override {
+                return gru(inputs.expr, this->kernel->expr, this->recurrent_kernel->expr, this->biases->expr, this->recurrent_biases->expr, steps, bptt, return_sequences);
+            }
+
+        };
+
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <armadillo>
+#include <stdexcept>
+
+namespace stratos {
+
+    namespace optimizers {
+
+        // Closed-form linear least squares y = x * kernel + bias, optionally ridge
+        // regularized (the bias is not). Row blocks are accumulated into the normal
+        // equations in double precision, so data can be streamed through Add in any
+        // number of blocks and only (features + 1)^2 values are kept.
+        class LeastSquares {
+
+            arma::Mat<double> xtx;      // (features, features) sum of x^T x
+            arma::Mat<double> xty;      // (features, targets) sum of x^T y
+            arma::Mat<double> x_sum;    // (features, 1)
+            arma::Mat<double> y_sum;    // (targets, 1)
+            size_t rows = 0;
+
+            double ridge;
+
+        public:
+
+            // Rows converted to double at a time
+            static constexpr size_t block_rows = 4096;
+
+            LeastSquares(size_t features, size_t targets, double ridge = 0) : ridge(ridge) {
+                if (ridge < 0)
+                    throw std::invalid_argument("Ridge regularization must not be negative.");
+
+                xtx.zeros(features, features);
+                xty.zeros(features, targets);
+                x_sum.zeros(features, 1);
+                y_sum.zeros(targets, 1);
+            }
+
+            void Add(const arma::Mat<float>& x, const arma::Mat<float>& y) {
+                if (x.n_cols != xtx.n_rows || y.n_cols != xty.n_cols || x.n_rows != y.n_rows)
+                    throw std::invalid_argument("Least squares block does not match the problem shape.");
+
+                for (size_t begin = 0; begin < x.n_rows; begin += block_rows) {
+                    const size_t end = std::min(begin + block_rows, (size_t)x.n_rows) - 1;
+
+                    const arma::Mat<double> xb = arma::conv_to<arma::Mat<double>>::from(x.rows(begin, end));
+                    const arma::Mat<double> yb = arma::conv_to<arma::Mat<double>>::from(y.rows(begin, end));
+
+                    xtx += xb.t() * xb;
+                    xty += xb.t() * yb;
+                    x_sum += arma::sum(xb, 0).t();
+                    y_sum += arma::sum(yb, 0).t();
+                }
+
+                rows += x.n_rows;
+            }
+
+            size_t GetSize() const { return rows; }
+
+            // Solves the centered normal equations (X^T X - n mu mu^T + ridge I) w = X^T y - n mu y_mean^T
+            // by Cholesky, falling back to Armadillo's general solver for singular systems.
+            void Solve(arma::Mat<float>& kernel, arma::Mat<float>& bias) const {
+                if (rows == 0)
+                    throw std::logic_error("Least squares solve without any rows.");
+
+                const arma::Mat<double> x_mean = x_sum / (double)rows;
+                const arma::Mat<double> y_mean = y_sum / (double)rows;
+
+                arma::Mat<double> a = xtx - rows * (x_mean * x_mean.t());
+                const arma::Mat<double> b = xty - rows * (x_mean * y_mean.t());
+
+                a.diag() += ridge;
+
+                arma::Mat<double> w, r;
+
+                if (arma::chol(r, a)) {
+                    // a = r^T r, two triangular solves
+                    const arma::Mat<double> z = arma::solve(arma::trimatl(r.t()), b);
+                    w = arma::solve(arma::trimatu(r), z);
+                } else {
+                    w = arma::solve(a, b);
+                }
+
+                kernel = arma::conv_to<arma::Mat<float>>::from(w);
+                bias = arma::conv_to<arma::Mat<float>>::from(arma::Mat<double>(y_mean - w.t() * x_mean));
+            }
+
+        };
+
+    }
+}
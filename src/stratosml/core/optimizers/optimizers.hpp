@@ -2,8 +2,11 @@
 #pragma once
 #include <armadillo>
 #include <cmath>
+#include <cstring>
+#include <functional>
 #include <stratosml/core/autodiff/autodiff.hpp>
 #include <stratosml/core/optimizers/schedules.hpp>
+#include <stratosml/core/optimizers/least_squares.hpp>
 
 // using namespace arma;
 using namespace stratos::autodiff;
@@ -15,6 +18,9 @@ namespace stratos {
 
     namespace optimizers {
 
+        // Re-evaluates the loss and the parameter gradients at the current parameters
+        using Closure = std::function<float()>;
+
         class Optimizer {
 
         public:
@@ -34,8 +40,36 @@ namespace stratos {
             virtual void build(const std::vector<std::shared_ptr<var>>& params) {}
 
             virtual void step(const std::vector<std::shared_ptr<var>>& params) = 0;
+
+            // Optimizers evaluating the loss several times per step are given the
+            // closure instead of precomputed gradients
+            virtual bool uses_closure() const { return false; }
+
+            // Returns the loss before the step
+            virtual float step(const std::vector<std::shared_ptr<var>>& params, const Closure& closure) {
+                const float loss = closure();
+                this->step(params);
+                return loss;
+            }
         };
 
+        // Parameter node with a row-sparse gradient, nullptr for dense parameters
+        inline std::shared_ptr<SparseVariableNode<float>> sparse(const std::shared_ptr<var>& param) {
+            return std::dynamic_pointer_cast<SparseVariableNode<float>>(param->expr);
+        }
+
+        // Applies update(row of the parameter, gradient row) to every row in the
+        // sparse gradient, so a step costs the rows looked up instead of the table.
+        // The parameter row is a column-major slice with a stride of the row count.
+        template<typename Update>
+        void for_each_row(SparseVariableNode<float>& param, Update&& update) {
+            const RowSparseGrad<float>& grad = param.sparse_grad;
+
+            for (size_t i = 0; i < grad.size(); ++i) {
+                update(grad.rows[i], grad.row(i));
+            }
+        }
+
         class GradientDescent : public Optimizer {
 
         public:
@@ -45,6 +79,17 @@ namespace stratos {
                 for (int i = 0; i < params.size(); ++i) {
                     auto param = params[i];
 
+                    if (auto table = sparse(param)) {
+                        arma::Mat<float>& w = table->val.value;
+                        const float rate = lr;
+
+                        for_each_row(*table, [&](uint32_t row, const float* g) {
+                            for (size_t c = 0; c < w.n_cols; ++c) w(row, c) -= rate * g[c];
+                        });
+
+                        continue;
+                    }
+
                     *param -= lr * (*param)->grad;
                 }
             }
@@ -54,61 +99,403 @@ namespace stratos {
 
             float momentum;
             
-            std::vector<var> v;
+            std::vector<arma::Mat<float>> v;
 
         public:
             Momentum(float lr, float momentum) : Optimizer(lr), momentum(momentum) {}
 
             void build(const std::vector<std::shared_ptr<var>>& params) {
+                v.clear();
+
                 for (const auto& param : params) {
-                    v.emplace_back((*param)->val.shape);
+                    v.emplace_back(arma::size((*param)->val.value), arma::fill::zeros);
                 }
             }
 
+            // Velocities and parameters are updated in place. Sparse parameters are
+            // lazy: rows missing from the gradient keep their velocity until next hit.
             void step(const std::vector<std::shared_ptr<var>>& params) {
+                const float rate = lr;
+
                 for (int i = 0; i < params.size(); ++i) {
-                    auto param = params[i];
+                    arma::Mat<float>& w = (*params[i])->val.value;
+
+                    if (auto table = sparse(params[i])) {
+                        for_each_row(*table, [&](uint32_t row, const float* g) {
+                            for (size_t c = 0; c < w.n_cols; ++c) {
+                                v[i](row, c) = this->momentum * v[i](row, c) - rate * g[c];
+                                w(row, c) += v[i](row, c);
+                            }
+                        });
+
+                        continue;
+                    }
 
-                    v[i] = this->momentum * v[i] - lr * (*param)->grad;
-                    *param += v[i];
+                    v[i] = this->momentum * v[i] - rate * (*params[i])->grad.value;
+                    w += v[i];
                 }
             }
         };
 
+        // Per-step constants of the Adam update, with the bias corrections folded into
+        // the step size and epsilon: lr * m_hat / (sqrt(v_hat) + eps) equals
+        // step_size * m / (sqrt(v) + eps_hat).
+        struct AdamCoefficients {
+            float beta1, beta2;
+            float step_size;
+            float epsilon;
+            float decay;        // 1 - lr * weight_decay, decoupled (AdamW)
+        };
+
+        inline void adam_update(float& w, float& m, float& v, float g, const AdamCoefficients& c) {
+            m = c.beta1 * m + (1 - c.beta1) * g;
+            v = c.beta2 * v + (1 - c.beta2) * g * g;
+            w = w * c.decay - c.step_size * m / (std::sqrt(v) + c.epsilon);
+        }
+
+        // Moments and parameters updated in one pass over the four buffers
+        inline void adam_kernel(float* __restrict__ w, float* __restrict__ m, float* __restrict__ v, const float* __restrict__ g, size_t n, const AdamCoefficients& c) {
+            for (size_t i = 0; i < n; ++i) {
+                adam_update(w[i], m[i], v[i], g[i], c);
+            }
+        }
+
         class Adam : public Optimizer {
 
+        protected:
+
+            float weight_decay = 0;
+
+        private:
+
             double beta1 = 0.9;
             double beta2 = 0.999;
             double epsilon = std::pow(10, -8);
             size_t t = 0;
 
-            std::vector<var> v;
-            std::vector<var> m;
+            std::vector<arma::Mat<float>> v;
+            std::vector<arma::Mat<float>> m;
 
         public:
 
             Adam(float learning_rate) : Optimizer(learning_rate) {}
 
             void build(const std::vector<std::shared_ptr<var>>& parameters) {
+                v.clear();
+                m.clear();
+                t = 0;
+
                 for (const auto& param : parameters) {
-                    v.emplace_back((*param)->val.shape);
-                    m.emplace_back((*param)->val.shape);
+                    v.emplace_back(arma::size((*param)->val.value), arma::fill::zeros);
+                    m.emplace_back(arma::size((*param)->val.value), arma::fill::zeros);
                 }
             }
 
+            // Sparse parameters get lazy Adam: only the moments of the rows in the
+            // gradient decay and only those rows move, with the global step's bias correction.
             void step(const std::vector<std::shared_ptr<var>>& parameters) {
                 t += 1;
 
+                const double m_correction = 1 - std::pow(beta1, t);
+                const double v_correction = std::sqrt(1 - std::pow(beta2, t));
+
+                const AdamCoefficients c {
+                    (float)beta1,
+                    (float)beta2,
+                    (float)(lr * v_correction / m_correction),
+                    (float)(epsilon * v_correction),
+                    (float)(1 - lr * weight_decay)
+                };
+
                 for (int i = 0; i < parameters.size(); ++i) {
-                    m[i] = beta1 * m[i] + (1 - beta1) * (*parameters[i])->grad;
+                    arma::Mat<float>& w = (*parameters[i])->val.value;
+
+                    if (auto table = sparse(parameters[i])) {
+                        for_each_row(*table, [&](uint32_t row, const float* g) {
+                            for (size_t col = 0; col < w.n_cols; ++col) {
+                                adam_update(w(row, col), m[i](row, col), v[i](row, col), g[col], c);
+                            }
+                        });
+
+                        continue;
+                    }
 
-                    v[i] = beta2 * v[i] + (1 - beta2) * pow((*parameters[i])->grad, 2);
+                    adam_kernel(w.memptr(), m[i].memptr(), v[i].memptr(), (*parameters[i])->grad.value.memptr(), w.n_elem, c);
                 }
 
             }
 
         };
 
+        // Adam with decoupled weight decay, parameters shrink by lr * weight_decay
+        // every step independently of the gradient moments
+        class AdamW : public Adam {
+
+        public:
+
+            AdamW(float learning_rate, float weight_decay = 0.01f) : Adam(learning_rate) {
+                if (weight_decay < 0)
+                    throw std::invalid_argument("Weight decay must not be negative.");
+
+                this->weight_decay = weight_decay;
+            }
+
+        };
+
+        // Limited-memory BFGS for full-batch training. Every step runs up to
+        // iterations quasi-Newton iterations, re-evaluating the loss and gradients
+        // through the closure during a strong Wolfe line search. Parameters,
+        // gradients and the last history_size curvature pairs live in flat buffers,
+        // the two-loop recursion works on whole vectors.
+        class LBFGS : public Optimizer {
+
+            size_t history_size;
+            size_t iterations;
+            size_t max_evaluations = 25;    // per line search
+
+            float tolerance_grad = 1e-7f;
+            float tolerance_change = 1e-9f;
+            float c1 = 1e-4f;               // sufficient decrease
+            float c2 = 0.9f;                // curvature
+
+            std::vector<arma::Mat<float>*> values;
+            std::vector<arma::Mat<float>*> grads;
+            size_t size = 0;
+
+            arma::Mat<float> s, y;          // (size, history_size) ring of steps and gradient changes
+            std::vector<float> rho;
+            size_t stored = 0, newest = 0;
+            float gamma = 1;                // initial inverse Hessian scale
+            bool started = false;
+
+            void gather(const std::vector<arma::Mat<float>*>& from, arma::Col<float>& flat) const {
+                flat.set_size(size);
+                float* out = flat.memptr();
+
+                for (const arma::Mat<float>* m : from) {
+                    std::memcpy(out, m->memptr(), m->n_elem * sizeof(float));
+                    out += m->n_elem;
+                }
+            }
+
+            // Parameters at x + t * d, written in place
+            void assign(const arma::Col<float>& x, float t, const arma::Col<float>& d) {
+                const float* px = x.memptr();
+                const float* pd = d.memptr();
+
+                for (arma::Mat<float>* m : values) {
+                    float* out = m->memptr();
+                    for (size_t i = 0; i < m->n_elem; ++i) out[i] = px[i] + t * pd[i];
+                    px += m->n_elem;
+                    pd += m->n_elem;
+                }
+            }
+
+            // -H g by the two-loop recursion over the stored pairs
+            arma::Col<float> direction(const arma::Col<float>& g) const {
+                arma::Col<float> q = -g;
+                std::vector<float> alpha(stored);
+
+                for (size_t k = 0; k < stored; ++k) {
+                    const size_t i = (newest + history_size - k) % history_size;
+                    alpha[k] = rho[i] * arma::dot(s.col(i), q);
+                    q -= alpha[k] * y.col(i);
+                }
+
+                q *= gamma;
+
+                for (size_t k = stored; k-- > 0;) {
+                    const size_t i = (newest + history_size - k) % history_size;
+                    const float beta = rho[i] * arma::dot(y.col(i), q);
+                    q += (alpha[k] - beta) * s.col(i);
+                }
+
+                return q;
+            }
+
+            static float cubic_minimum(float x1, float f1, float g1, float x2, float f2, float g2, float lo, float hi) {
+                const float d1 = g1 + g2 - 3 * (f1 - f2) / (x1 - x2);
+                const float d2_square = d1 * d1 - g1 * g2;
+
+                if (d2_square < 0)
+                    return (lo + hi) / 2;
+
+                const float d2 = std::sqrt(d2_square);
+                const float t = x1 <= x2
+                    ? x2 - (x2 - x1) * ((g2 + d2 - d1) / (g2 - g1 + 2 * d2))
+                    : x1 - (x1 - x2) * ((g1 + d2 - d1) / (g1 - g2 + 2 * d2));
+
+                return std::isfinite(t) ? std::min(std::max(t, lo), hi) : (lo + hi) / 2;
+            }
+
+            struct Point {
+                float t, f, gtd;
+                arma::Col<float> g;
+            };
+
+            // Strong Wolfe line search along d from x, leaves the parameters at the returned point
+            Point line_search(const Closure& closure, const arma::Col<float>& x, const arma::Col<float>& d, float t, const Point& start) {
+                size_t evaluations = 0;
+
+                auto evaluate = [&](float t) {
+                    assign(x, t, d);
+                    Point p { t, closure(), 0, {} };
+                    gather(grads, p.g);
+                    p.gtd = arma::dot(p.g, d);
+                    ++evaluations;
+                    return p;
+                };
+
+                auto sufficient = [&](const Point& p) { return p.f <= start.f + c1 * p.t * start.gtd; };
+                auto curvature = [&](const Point& p) { return std::abs(p.gtd) <= -c2 * start.gtd; };
+
+                Point previous = start, current = evaluate(t);
+                Point lo, hi;
+
+                // Bracketing phase, growing the step until the minimum is bracketed
+                while (true) {
+                    if (!sufficient(current) || (evaluations > 1 && current.f >= previous.f)) {
+                        lo = previous;
+                        hi = current;
+                        break;
+                    }
+
+                    if (curvature(current))
+                        return current;
+
+                    if (current.gtd >= 0) {
+                        lo = current;
+                        hi = previous;
+                        break;
+                    }
+
+                    if (evaluations >= max_evaluations)
+                        return current;
+
+                    const float next = cubic_minimum(previous.t, previous.f, previous.gtd, current.t, current.f, current.gtd,
+                        current.t + 0.01f * (current.t - previous.t), current.t * 10);
+
+                    previous = std::move(current);
+                    current = evaluate(next);
+                }
+
+                // Zoom phase, shrinking the bracket around a point satisfying both conditions
+                const float d_max = arma::abs(d).max();
+
+                while (evaluations < max_evaluations && std::abs(hi.t - lo.t) * d_max >= tolerance_change) {
+                    const float a = std::min(lo.t, hi.t), b = std::max(lo.t, hi.t);
+                    float t = cubic_minimum(lo.t, lo.f, lo.gtd, hi.t, hi.f, hi.gtd, a, b);
+
+                    // Keep away from the bracket ends
+                    const float margin = 0.1f * (b - a);
+                    if (t - a < margin || b - t < margin)
+                        t = (a + b) / 2;
+
+                    Point p = evaluate(t);
+
+                    if (!sufficient(p) || p.f >= lo.f) {
+                        hi = std::move(p);
+                        continue;
+                    }
+
+                    if (curvature(p))
+                        return p;
+
+                    if (p.gtd * (hi.t - lo.t) >= 0)
+                        hi = std::move(lo);
+
+                    lo = std::move(p);
+                }
+
+                assign(x, lo.t, d);
+                return lo;
+            }
+
+        public:
+
+            LBFGS(float lr = 1, size_t history_size = 10, size_t iterations = 20)
+                : Optimizer(lr), history_size(history_size), iterations(iterations) {
+                if (history_size < 1 || iterations < 1)
+                    throw std::invalid_argument("L-BFGS history size and iterations should be bigger than zero.");
+            }
+
+            bool uses_closure() const override { return true; }
+
+            void build(const std::vector<std::shared_ptr<var>>& params) override {
+                values.clear();
+                grads.clear();
+                size = 0;
+
+                for (const auto& param : params) {
+                    if (sparse(param))
+                        throw std::invalid_argument("L-BFGS does not support row-sparse parameters.");
+
+                    values.push_back(&(*param)->val.value);
+                    grads.push_back(&(*param)->grad.value);
+                    size += (*param)->val.value.n_elem;
+                }
+
+                s.zeros(size, history_size);
+                y.zeros(size, history_size);
+                rho.assign(history_size, 0);
+                stored = newest = 0;
+                gamma = 1;
+                started = false;
+            }
+
+            void step(const std::vector<std::shared_ptr<var>>&) override {
+                throw std::logic_error("L-BFGS re-evaluates the loss, it has to be stepped with a closure.");
+            }
+
+            float step(const std::vector<std::shared_ptr<var>>&, const Closure& closure) override {
+                arma::Col<float> x, d;
+                Point current { 0, closure(), 0, {} };
+                gather(grads, current.g);
+
+                const float initial = current.f;
+
+                for (size_t iteration = 0; iteration < iterations; ++iteration) {
+                    if (arma::abs(current.g).max() <= tolerance_grad)
+                        break;
+
+                    d = direction(current.g);
+                    current.gtd = arma::dot(current.g, d);
+
+                    if (current.gtd > -tolerance_change)
+                        break;
+
+                    // Without curvature information the first step is scaled by the gradient
+                    const float t = started ? (float)lr : std::min(1.0f, 1.0f / arma::accu(arma::abs(current.g))) * (float)lr;
+                    started = true;
+
+                    gather(values, x);
+                    Point next = line_search(closure, x, d, t, current);
+
+                    // Curvature pair, skipped when it would break positive definiteness
+                    arma::Col<float> step_s = next.t * d;
+                    arma::Col<float> step_y = next.g - current.g;
+                    const float ys = arma::dot(step_y, step_s);
+
+                    if (ys > 1e-10f) {
+                        newest = stored ? (newest + 1) % history_size : 0;
+                        s.col(newest) = step_s;
+                        y.col(newest) = step_y;
+                        rho[newest] = 1.0f / ys;
+                        stored = std::min(stored + 1, history_size);
+                        gamma = ys / arma::dot(step_y, step_y);
+                    }
+
+                    const float change = std::abs(next.f - current.f);
+                    current = std::move(next);
+
+                    if (change < tolerance_change || arma::abs(step_s).max() <= tolerance_change)
+                        break;
+                }
+
+                return initial;
+            }
+        };
+
         // class Adam : public Optimizer {
         //     double beta1 = 0.9;
         //     double beta2 = 0.999;
@@ -0,0 +1,74 @@
+#include <stratosml/core.hpp>
+#include <stratosml/tests/check.hpp>
+#include <armadillo>
+#include <algorithm>
+#include <vector>
+
+using namespace stratos;
+using namespace stratos::layers;
+using namespace std;
+
+/*
+ * Gradient accumulation: k micro-batches of b rows give the same update as
+ * one batch of k * b rows, also when the last micro-batch of the epoch is
+ * only partly filled.
+ */
+
+// Weights of a two-layer model after one epoch over the rows in order, from
+// the same initial weights every time
+vector<arma::Mat<float>> Train(const arma::Mat<float>& x, const arma::Mat<float>& y, size_t batch_size, size_t accumulation_steps) {
+    arma::arma_rng::set_seed(5);
+
+    Model model;
+    model.shuffle = false;
+    model.accumulation_steps = accumulation_steps;
+
+    delete model.optimizer;
+    model.optimizer = new GradientDescent(0.1);
+
+    Dense* hidden = new Dense(4, new Tanh());
+    Dense* output = new Dense(1);
+    model.Add(hidden);
+    model.Add(output);
+
+    model.Fit(Tensor<float>(x), Tensor<float>(y), 1, batch_size);
+
+    vector<arma::Mat<float>> weights;
+    for (const Dense* layer : { hidden, output }) {
+        for (const auto& w : layer->weights) weights.push_back((*w)->val.value);
+    }
+
+    return weights;
+}
+
+float MaxDifference(const vector<arma::Mat<float>>& a, const vector<arma::Mat<float>>& b) {
+    float difference = 0;
+    for (size_t w = 0; w < a.size(); ++w) difference = std::max(difference, tests::MaxDifference(a[w], b[w]));
+    return difference;
+}
+
+void TestAccumulation() {
+    // 22 rows: steps of 12 and 10 rows, micro-batches of 4, 4, 4 and 4, 4, 2
+    const arma::Mat<float> x(22, 3, arma::fill::randn);
+    const arma::Mat<float> y = arma::sum(x, 1) + 0.5f;
+
+    const vector<arma::Mat<float>> large = Train(x, y, 12, 1);
+    const vector<arma::Mat<float>> accumulated = Train(x, y, 4, 3);
+
+    CHECK(MaxDifference(accumulated, large) < 1e-5f);
+
+    // Six steps of 4 rows end elsewhere, the comparison above is not trivial
+    CHECK(MaxDifference(Train(x, y, 4, 1), large) > 1e-3f);
+
+    // Fewer rows than one accumulated step: 4, 4 and 2 rows against the full batch
+    const arma::Mat<float> x_few = x.rows(0, 9), y_few = y.rows(0, 9);
+    CHECK(MaxDifference(Train(x_few, y_few, 4, 3), Train(x_few, y_few, 0, 1)) < 1e-5f);
+}
+
+int main() {
+    arma::arma_rng::set_seed(29);
+
+    TestAccumulation();
+
+    return tests::Failures();
+}
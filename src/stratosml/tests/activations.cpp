@@ -0,0 +1,106 @@
+#include <stratosml/core.hpp>
+#include <stratosml/tests/check.hpp>
+#include <armadillo>
+#include <cmath>
+
+using namespace stratos;
+using namespace stratos::autodiff;
+using namespace std;
+
+/*
+ * Activation nodes: values and gradients at points where they are known in
+ * closed form, and the in-place variants taking over their input.
+ */
+
+void TestRelu() {
+    var x = Tensor<float>(arma::Mat<float>({ { -1.0f, 0.0f, 2.0f }, { 3.0f, -0.5f, 0.25f } }));
+
+    NodePtr<float> y = relu(x.expr);
+    CHECK(tests::MaxDifference(y->val.value, arma::Mat<float>({ { 0, 0, 2 }, { 3, 0, 0.25f } })) == 0);
+
+    y->derive(Tensor<float>(arma::Mat<float>({ { 1, 2, 3 }, { 4, 5, 6 } })));
+    CHECK(tests::MaxDifference(x->grad.value, arma::Mat<float>({ { 0, 0, 3 }, { 4, 0, 6 } })) == 0);
+
+    // More than 64 elements span several mask words
+    const arma::Mat<float> wide(3, 50, arma::fill::randn);
+    var w = Tensor<float>(wide);
+    NodePtr<float> r = relu(w.expr);
+    r->derive(Tensor<float>(arma::Mat<float>(3, 50, arma::fill::ones)));
+
+    bool matches = true;
+    for (size_t i = 0; i < wide.n_elem; ++i) {
+        matches = matches && r->val.value(i) == std::max(wide(i), 0.0f) && w->grad.value(i) == (wide(i) > 0 ? 1.0f : 0.0f);
+    }
+    CHECK(matches);
+}
+
+void TestSigmoidTanh() {
+    var x = Tensor<float>(arma::Mat<float>({ { 0.0f, std::log(3.0f), -std::log(3.0f) } }));
+
+    // sigmoid(ln 3) = 3/4, sigmoid'(x) = y (1 - y)
+    NodePtr<float> s = sigmoid(x.expr);
+    CHECK_NEAR(s->val.value(0), 0.5, 1e-6);
+    CHECK_NEAR(s->val.value(1), 0.75, 1e-6);
+    CHECK_NEAR(s->val.value(2), 0.25, 1e-6);
+
+    s->derive(Tensor<float>(arma::Mat<float>({ { 1, 1, 2 } })));
+    CHECK_NEAR(x->grad.value(0), 0.25, 1e-6);
+    CHECK_NEAR(x->grad.value(1), 0.1875, 1e-6);
+    CHECK_NEAR(x->grad.value(2), 0.375, 1e-6);
+
+    // tanh(ln 3) = 4/5, tanh'(x) = 1 - y^2
+    var t_in = Tensor<float>(arma::Mat<float>({ { 0.0f, std::log(3.0f) } }));
+    NodePtr<float> t = autodiff::tanh(t_in.expr);
+    CHECK_NEAR(t->val.value(0), 0.0, 1e-6);
+    CHECK_NEAR(t->val.value(1), 0.8, 1e-6);
+
+    t->derive(Tensor<float>(arma::Mat<float>({ { 1, 1 } })));
+    CHECK_NEAR(t_in->grad.value(0), 1.0, 1e-6);
+    CHECK_NEAR(t_in->grad.value(1), 0.36, 1e-6);
+}
+
+void TestSoftMax() {
+    // Rows [0, ln 3] and [1000, 1000], the second would overflow without the row max
+    var x = Tensor<float>(arma::Mat<float>({ { 0.0f, std::log(3.0f) }, { 1000.0f, 1000.0f } }));
+
+    NodePtr<float> y = softmax(x.expr);
+    CHECK_NEAR(y->val.value(0, 0), 0.25, 1e-6);
+    CHECK_NEAR(y->val.value(0, 1), 0.75, 1e-6);
+    CHECK_NEAR(y->val.value(1, 0), 0.5, 1e-6);
+    CHECK_NEAR(y->val.value(1, 1), 0.5, 1e-6);
+
+    // dx = y * (g - rowsum(g * y))
+    y->derive(Tensor<float>(arma::Mat<float>({ { 1, 0 }, { 0, 2 } })));
+    CHECK_NEAR(x->grad.value(0, 0), 0.1875, 1e-6);
+    CHECK_NEAR(x->grad.value(0, 1), -0.1875, 1e-6);
+    CHECK_NEAR(x->grad.value(1, 0), -0.5, 1e-6);
+    CHECK_NEAR(x->grad.value(1, 1), 0.5, 1e-6);
+}
+
+// An input that does not read its own value on backward is taken over
+void TestInPlace() {
+    var x = Tensor<float>(arma::Mat<float>({ { -2.0f, 1.0f } }));
+    var h(x.expr);
+
+    NodePtr<float> y = relu(h.expr, true);
+    CHECK(h->val.value.n_elem == 0);
+    CHECK(y->val.value(0) == 0.0f && y->val.value(1) == 1.0f);
+
+    y->derive(Tensor<float>(arma::Mat<float>({ { 5, 7 } })));
+    CHECK(x->grad.value(0) == 0.0f && x->grad.value(1) == 7.0f);
+
+    // Independent variables keep their values
+    var w = Tensor<float>(arma::Mat<float>(1, 1, arma::fill::zeros));
+    NodePtr<float> s = sigmoid(w.expr, true);
+    CHECK(w->val.value.n_elem == 1);
+    CHECK_NEAR(s->val.value(0), 0.5, 1e-6);
+}
+
+int main() {
+    TestRelu();
+    TestSigmoidTanh();
+    TestSoftMax();
+    TestInPlace();
+
+    return tests::Failures();
+}
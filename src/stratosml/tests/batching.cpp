@@ -0,0 +1,153 @@
+#include <stratosml/core.hpp>
+#include <stratosml/tests/check.hpp>
+#include <armadillo>
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+using namespace stratos;
+using namespace stratos::data;
+using namespace stratos::layers;
+using namespace std;
+
+/*
+ * Mini-batches: every row once per epoch with a partial last batch, the same
+ * order for the same seed, rows gathered into the batch buffer, and Fit
+ * repeating its training for a fixed seed.
+ */
+
+// Rows of every batch of the epoch, in batch order
+vector<size_t> Epoch(const BatchSampler& sampler) {
+    vector<size_t> rows;
+
+    for (size_t batch = 0; batch < sampler.GetBatchCount(); ++batch) {
+        size_t count;
+        const size_t* begin = sampler.Batch(batch, count);
+        rows.insert(rows.end(), begin, begin + count);
+    }
+
+    return rows;
+}
+
+bool EveryRowOnce(vector<size_t> rows, size_t n) {
+    std::sort(rows.begin(), rows.end());
+
+    bool once = rows.size() == n;
+    for (size_t i = 0; once && i < n; ++i) once = rows[i] == i;
+    return once;
+}
+
+void TestSampler() {
+    const size_t n = 103;
+
+    BatchSampler sampler(n, 10, 7);
+    CHECK(sampler.GetSize() == n && sampler.GetBatchSize() == 10);
+    CHECK(sampler.GetBatchCount() == 11);
+
+    // Frame order until shuffled
+    vector<size_t> in_order(n);
+    for (size_t i = 0; i < n; ++i) in_order[i] = i;
+    CHECK(Epoch(sampler) == in_order);
+
+    // The last batch holds the 3 rows left
+    size_t count;
+    const size_t* last = sampler.Batch(10, count);
+    CHECK(count == 3 && last[0] == 100 && last[2] == 102);
+
+    BatchSampler same(n, 10, 7), other(n, 10, 8);
+    vector<size_t> previous;
+
+    for (size_t epoch = 0; epoch < 3; ++epoch) {
+        sampler.Shuffle();
+        same.Shuffle();
+        other.Shuffle();
+
+        const vector<size_t> rows = Epoch(sampler);
+
+        CHECK(EveryRowOnce(rows, n));
+        CHECK(rows == Epoch(same));
+        CHECK(rows != Epoch(other));
+
+        // Every epoch gets a new order
+        CHECK(rows != previous && rows != in_order);
+        previous = rows;
+    }
+
+    // A batch larger than the data is the whole data
+    BatchSampler whole(5, 8, 1);
+    CHECK(whole.GetBatchCount() == 1);
+    whole.Batch(0, count);
+    CHECK(count == 5);
+
+    bool thrown = false;
+    try {
+        BatchSampler(n, 0);
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+void TestGatherRows() {
+    const arma::Mat<float> values(20, 3, arma::fill::randn);
+    const Tensor<float> source(values);
+
+    BatchSampler sampler(20, 8, 3);
+    sampler.Shuffle();
+
+    Tensor<float> batch;
+    for (size_t b = 0; b < sampler.GetBatchCount(); ++b) {
+        size_t count;
+        const size_t* rows = sampler.Batch(b, count);
+
+        GatherRows(source, rows, count, batch);
+        CHECK(batch.value.n_rows == count && batch.value.n_cols == 3);
+        CHECK(batch.shape[0] == count && batch.shape[1] == 3);
+
+        bool matches = true;
+        for (size_t i = 0; i < count; ++i) matches = matches && arma::approx_equal(batch.value.row(i), values.row(rows[i]), "absdiff", 0.0f);
+        CHECK(matches);
+    }
+
+    // The last batch of 20 rows in batches of 8 is 4 rows
+    CHECK(batch.value.n_rows == 4);
+}
+
+// Weights after a few shuffled epochs, from the same initial weights
+arma::Mat<float> Train(const arma::Mat<float>& x, const arma::Mat<float>& y, size_t seed) {
+    arma::arma_rng::set_seed(5);
+
+    Model model;
+    model.seed = seed;
+
+    delete model.optimizer;
+    model.optimizer = new GradientDescent(0.05);
+
+    Dense* hidden = new Dense(4, new Tanh());
+    model.Add(hidden);
+    model.Add(new Dense(1));
+
+    model.Fit(Tensor<float>(x), Tensor<float>(y), 3, 7);
+
+    return (*hidden->weights[0])->val.value;
+}
+
+void TestFitSeed() {
+    const arma::Mat<float> x(30, 2, arma::fill::randn);
+    const arma::Mat<float> y = x.col(0) - 2.0f * x.col(1);
+
+    const arma::Mat<float> first = Train(x, y, 11);
+
+    CHECK(tests::MaxDifference(Train(x, y, 11), first) == 0);
+    CHECK(tests::MaxDifference(Train(x, y, 12), first) > 0);
+}
+
+int main() {
+    arma::arma_rng::set_seed(37);
+
+    TestSampler();
+    TestGatherRows();
+    TestFitSeed();
+
+    return tests::Failures();
+}
@@ -0,0 +1,195 @@
+#include <stratosml/core.hpp>
+#include <stratosml/tests/check.hpp>
+#include <armadillo>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+using namespace stratos;
+using namespace stratos::data;
+using namespace std;
+
+/*
+ * .stratos files: a frame saved and mapped back holds the same columns,
+ * values and nulls, the mapping is copy-on-write, and damaged or mismatched
+ * files and frames with categorical columns are refused.
+ */
+
+string TempPath(const string& name) {
+    return (filesystem::temp_directory_path() / name).string();
+}
+
+// 37 rows, so every column blob ends in padding
+void Fill(DataFrame& df) {
+    const size_t rows = 37;
+
+    df.AddColumn("x", rows);
+    df.AddColumn("long column name", rows);
+    df.AddColumn("y", rows);
+
+    for (size_t r = 0; r < rows; ++r) {
+        df["x"][r] = (float)r;
+        df["long column name"][r] = -0.5f * r;
+        df["y"][r] = r % 3 == 0 ? 1e-30f : 3.25f;
+    }
+}
+
+void TestRoundTrip() {
+    const string path = TempPath("stratos_round_trip.stratos");
+    DataFrame saved;
+    Fill(saved);
+
+    CHECK(Save(path, saved));
+
+    DataFrame loaded;
+    CHECK(Load(path, loaded));
+
+    CHECK(loaded.GetColumns() == saved.GetColumns());
+    CHECK(loaded.GetShape() == saved.GetShape());
+    CHECK(tests::MaxDifference(loaded.GetMatrix().value, saved.GetMatrix().value) == 0);
+
+    // Writes go to private pages, the file keeps the saved values
+    loaded["x"][0] = 100.0f;
+
+    DataFrame again;
+    CHECK(Load(path, again));
+    CHECK(again["x"][0] == 0.0f);
+
+    // Into a frame with columns of the same length, the file's columns are appended
+    DataFrame existing;
+    existing.AddColumn("z", 37);
+    CHECK(LoadBinary(path, existing));
+    CHECK(existing.GetColumns() == vector<string>({ "z", "x", "long column name", "y" }));
+    CHECK(existing["y"][4] == 3.25f);
+
+    // ... and refused with another row count
+    DataFrame shorter;
+    shorter.AddColumn("z", 36);
+    CHECK(!LoadBinary(path, shorter));
+
+    filesystem::remove(path);
+}
+
+void TestEmpty() {
+    const string path = TempPath("stratos_empty.stratos");
+
+    DataFrame empty;
+    empty.AddColumn("a", 0);
+    CHECK(Save(path, empty));
+
+    DataFrame loaded;
+    CHECK(Load(path, loaded));
+    CHECK(loaded.GetColumns() == vector<string>({ "a" }));
+    CHECK(loaded.GetShape().first == 0);
+
+    filesystem::remove(path);
+}
+
+// Nulls of a CSV keep their bitmaps through the file, statistics skip them
+void TestNulls() {
+    const string csv = TempPath("stratos_nulls.csv"), path = TempPath("stratos_nulls.stratos");
+
+    {
+        ofstream out(csv, ios::binary);
+        out << "v,w\n";
+        for (size_t r = 0; r < 100; ++r) out << (r % 4 == 1 ? "" : to_string(r)) << "," << r << "\n";
+    }
+
+    DataFrame df;
+    CHECK(LoadCSV(csv, df, 1));
+    CHECK(df["v"].GetNullCount() == 25);
+
+    df.Compress();
+    CHECK(Save(path, df));
+
+    DataFrame loaded, appended;
+    CHECK(Load(path, loaded));
+
+    appended.AddColumn("z", 100);
+    CHECK(LoadBinary(path, appended));
+
+    for (DataFrame* frame : { &loaded, &appended }) {
+        Series& v = (*frame)["v"];
+        CHECK(v.GetNullCount() == 25 && !v.IsValid(1) && v.IsValid(2));
+        CHECK((*frame)["w"].GetValidity() == nullptr);
+
+        // 4950 less the null rows 1, 5, ... 97 over 75 valid rows, not NaN
+        ColumnScaler scaler(Scaler::Standart);
+        scaler.Fit(*frame, { "v" });
+        CHECK_NEAR(scaler.GetParams("v").first, (4950.0 - 1225.0) / 75, 1e-4);
+
+        v.Impute(Imputer::Constant, -1.0f);
+        CHECK(v.GetNullCount() == 0 && v[5] == -1.0f && v[6] == 6.0f);
+    }
+
+    filesystem::remove(csv);
+    filesystem::remove(path);
+}
+
+void TestInvalid() {
+    const string path = TempPath("stratos_invalid.stratos");
+
+    DataFrame df;
+    Fill(df);
+    CHECK(Save(path, df));
+
+    // Only .stratos files are written
+    CHECK(!Save(TempPath("stratos_invalid.csv"), df));
+
+    // Wrong magic
+    {
+        fstream file(path, ios::in | ios::out | ios::binary);
+        file.write("NOTSTRAT", 8);
+    }
+
+    DataFrame wrong_magic;
+    CHECK(!LoadBinary(path, wrong_magic));
+
+    // Truncated data section
+    CHECK(Save(path, df));
+    filesystem::resize_file(path, filesystem::file_size(path) - 64);
+
+    DataFrame truncated;
+    CHECK(!LoadBinary(path, truncated));
+
+    filesystem::remove(path);
+}
+
+void TestCategorical() {
+    const string csv = TempPath("stratos_categorical.csv"), path = TempPath("stratos_categorical.stratos");
+
+    {
+        ofstream out(csv, ios::binary);
+        out << "x,city\n";
+        for (size_t r = 0; r < 20; ++r) out << r << "," << (r % 2 ? "Oslo" : "Lima") << "\n";
+    }
+
+    DataFrame df;
+    CHECK(LoadCSV(csv, df, 1));
+    CHECK(df.HasCategorical("city"));
+
+    filesystem::remove(path);
+
+    // Thrown before the file is created
+    bool thrown = false;
+    try {
+        Save(path, df);
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+    CHECK(!filesystem::exists(path));
+
+    filesystem::remove(csv);
+}
+
+int main() {
+    TestRoundTrip();
+    TestEmpty();
+    TestNulls();
+    TestInvalid();
+    TestCategorical();
+
+    return tests::Failures();
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <armadillo>
+#include <cmath>
+#include <cstdio>
+
+/*
+ * Assertions for the test programs in this directory. A failed check prints
+ * its line and is counted, the program keeps going and main returns
+ * Failures() so every broken check of a run shows up at once.
+ */
+
+namespace stratos {
+
+    namespace tests {
+
+        inline int failures = 0;
+
+        inline void Check(bool passed, const char* expression, const char* file, int line) {
+            if (passed) return;
+
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+            failures++;
+        }
+
+        inline void CheckNear(double actual, double expected, double tolerance, const char* expression, const char* file, int line) {
+            if (std::abs(actual - expected) <= tolerance) return;
+
+            std::fprintf(stderr, "%s:%d: check failed: %s is %.9g, expected %.9g\n", file, line, expression, actual, expected);
+            failures++;
+        }
+
+        // Largest element-wise difference, infinite for different sizes
+        inline float MaxDifference(const arma::Mat<float>& a, const arma::Mat<float>& b) {
+            if (arma::size(a) != arma::size(b)) return INFINITY;
+
+            const arma::Mat<float> difference = arma::abs(a - b);
+            return difference.n_elem ? difference.max() : 0.0f;
+        }
+
+        // Exit status of a test program
+        inline int Failures() {
+            if (failures == 0) std::printf("All checks passed.\n");
+            return failures;
+        }
+
+    }
+
+}
+
+#define CHECK(expression) stratos::tests::Check((expression), #expression, __FILE__, __LINE__)
+#define CHECK_NEAR(actual, expected, tolerance) stratos::tests::CheckNear((actual), (expected), (tolerance), #actual, __FILE__, __LINE__)
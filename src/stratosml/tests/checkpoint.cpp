@@ -0,0 +1,94 @@
+#include <stratosml/core.hpp>
+#include <stratosml/tests/check.hpp>
+#include <armadillo>
+#include <utility>
+#include <vector>
+
+using namespace stratos;
+using namespace stratos::layers;
+using namespace std;
+
+/*
+ * Activation checkpointing: segments rematerialized on backward give the same
+ * output and weight gradients as the graph kept whole.
+ */
+
+const vector<size_t> units = { 8, 8, 6, 1 };
+
+Activation* MakeActivation(size_t layer) {
+    switch (layer) {
+        case 0: return new Tanh();
+        case 1: return new Relu();
+        case 2: return new Sigmoid();
+        default: return new Linear();
+    }
+}
+
+// Output and weight gradients of an MSE loss over a four-layer model with the
+// given weights, checkpointing every n-th layer
+pair<arma::Mat<float>, vector<arma::Mat<float>>> Gradients(size_t every, const arma::Mat<float>& x_value, const arma::Mat<float>& y_value,
+    const vector<pair<arma::Mat<float>, arma::Mat<float>>>& weights) {
+    Model model;
+    vector<Dense*> layers;
+    size_t in = x_value.n_cols;
+
+    for (size_t l = 0; l < units.size(); ++l) {
+        Dense* layer = new Dense(units[l], MakeActivation(l));
+        layer->build(TensorShape({ in }));
+        layer->assign_weights(weights[l].first, weights[l].second);
+
+        model.Add(layer);
+        layers.push_back(layer);
+        in = units[l];
+    }
+
+    model.Checkpoint(every);
+
+    constant x = Tensor<float>(x_value);
+    constant y = Tensor<float>(y_value);
+
+    var output = model.forward(x);
+    var loss = MeanSquaredError()(y, output);
+    loss->derive(1.0f);
+
+    vector<arma::Mat<float>> gradients;
+    for (const Dense* layer : layers) {
+        for (const auto& w : layer->weights) gradients.push_back((*w)->grad.value);
+    }
+
+    return { output->val.value, gradients };
+}
+
+void TestCheckpoint() {
+    const arma::Mat<float> x(32, 5, arma::fill::randn);
+    const arma::Mat<float> y(32, 1, arma::fill::randn);
+
+    vector<pair<arma::Mat<float>, arma::Mat<float>>> weights;
+    size_t in = x.n_cols;
+
+    for (size_t out : units) {
+        weights.push_back({ arma::Mat<float>(in, out, arma::fill::randn) * 0.5f, arma::Mat<float>(out, 1, arma::fill::randn) * 0.1f });
+        in = out;
+    }
+
+    const auto [output, gradients] = Gradients(0, x, y, weights);
+
+    for (size_t every : { 1, 2, 3 }) {
+        const auto [checkpointed_output, checkpointed_gradients] = Gradients(every, x, y, weights);
+
+        CHECK(tests::MaxDifference(checkpointed_output, output) < 1e-6f);
+        CHECK(checkpointed_gradients.size() == gradients.size());
+
+        for (size_t w = 0; w < gradients.size(); ++w) {
+            CHECK(tests::MaxDifference(checkpointed_gradients[w], gradients[w]) < 1e-5f);
+        }
+    }
+}
+
+int main() {
+    arma::arma_rng::set_seed(31);
+
+    TestCheckpoint();
+
+    return tests::Failures();
+}
@@ -0,0 +1,133 @@
+#include <stratosml/core.hpp>
+#include <stratosml/tests/check.hpp>
+#include <armadillo>
+
+using namespace stratos;
+using namespace stratos::autodiff;
+using namespace std;
+
+/*
+ * Convolution node: im2col and the direct path against a naive loop over
+ * samples, filters, output pixels, channels and kernel taps, for the output
+ * and the input, kernel and bias gradients.
+ */
+
+struct Reference {
+    arma::Mat<float> out, dx, dw, db;
+};
+
+Reference Naive(const arma::Mat<float>& x, const arma::Mat<float>& w, const arma::Mat<float>& b, const arma::Mat<float>& grad, const ConvGeometry& g) {
+    Reference ref;
+    ref.out.zeros(x.n_rows, g.output_size());
+    ref.dx.zeros(arma::size(x));
+    ref.dw.zeros(arma::size(w));
+    ref.db.zeros(arma::size(b));
+
+    for (size_t r = 0; r < x.n_rows; ++r)
+        for (size_t f = 0; f < g.filters; ++f)
+            for (size_t oh = 0; oh < g.out_h; ++oh)
+                for (size_t ow = 0; ow < g.out_w; ++ow) {
+                    const size_t out = g.output_column(f, oh * g.out_w + ow);
+                    float sum = b(f);
+
+                    for (size_t c = 0; c < g.channels; ++c)
+                        for (size_t i = 0; i < g.kernel_h; ++i)
+                            for (size_t j = 0; j < g.kernel_w; ++j) {
+                                size_t column;
+                                if (!g.source(c, oh, ow, i, j, column)) continue;
+
+                                const size_t tap = (c * g.kernel_h + i) * g.kernel_w + j;
+                                sum += w(tap, f) * x(r, column);
+                                ref.dx(r, column) += w(tap, f) * grad(r, out);
+                                ref.dw(tap, f) += x(r, column) * grad(r, out);
+                            }
+
+                    ref.out(r, out) = sum;
+                    ref.db(f) += grad(r, out);
+                }
+
+    return ref;
+}
+
+ConvGeometry Geometry(size_t channels, size_t height, size_t width, size_t filters, size_t kernel_h, size_t kernel_w,
+    size_t stride, size_t pad, Layout layout) {
+
+    ConvGeometry g;
+    g.channels = channels;
+    g.height = height;
+    g.width = width;
+    g.filters = filters;
+    g.kernel_h = kernel_h;
+    g.kernel_w = kernel_w;
+    g.stride_h = g.stride_w = stride;
+    g.pad_top = g.pad_left = pad;
+    g.out_h = (height + 2 * pad - kernel_h) / stride + 1;
+    g.out_w = (width + 2 * pad - kernel_w) / stride + 1;
+    g.layout = layout;
+    return g;
+}
+
+void TestPaths(const ConvGeometry& g, const char* name) {
+    const size_t n = 5;
+
+    const arma::Mat<float> x_value(n, g.input_size(), arma::fill::randn);
+    const arma::Mat<float> w_value(g.channels * g.taps(), g.filters, arma::fill::randn);
+    const arma::Mat<float> b_value(g.filters, 1, arma::fill::randn);
+    const arma::Mat<float> grad(n, g.output_size(), arma::fill::randn);
+
+    const Reference ref = Naive(x_value, w_value, b_value, grad, g);
+
+    static const Linear linear;
+
+    printf("%s\n", name);
+
+    for (ConvAlgorithm algorithm : { ConvAlgorithm::Im2col, ConvAlgorithm::Direct }) {
+        var x = Tensor<float>(x_value), kernel = Tensor<float>(w_value), bias = Tensor<float>(b_value);
+
+        NodePtr<float> out = conv(x.expr, kernel.expr, bias.expr, g, &linear, algorithm);
+        out->derive(Tensor<float>(grad));
+
+        CHECK(tests::MaxDifference(out->val.value, ref.out) < 1e-4f);
+        CHECK(tests::MaxDifference(x->grad.value, ref.dx) < 1e-4f);
+        CHECK(tests::MaxDifference(kernel->grad.value, ref.dw) < 1e-4f);
+        CHECK(tests::MaxDifference(bias->grad.value, ref.db) < 1e-4f);
+    }
+}
+
+// The fused activation applies to conv + bias, its derivative to the gradient
+void TestRelu() {
+    const ConvGeometry g = Geometry(2, 6, 6, 3, 3, 3, 1, 1, Layout::NCHW);
+    const size_t n = 4;
+
+    const arma::Mat<float> x_value(n, g.input_size(), arma::fill::randn);
+    const arma::Mat<float> w_value(g.channels * g.taps(), g.filters, arma::fill::randn);
+    const arma::Mat<float> b_value(g.filters, 1, arma::fill::randn);
+    const arma::Mat<float> grad(n, g.output_size(), arma::fill::randn);
+
+    const Reference linear = Naive(x_value, w_value, b_value, grad, g);
+    const arma::Mat<float> mask = arma::conv_to<arma::Mat<float>>::from(linear.out > 0.0f);
+    const Reference masked = Naive(x_value, w_value, b_value, grad % mask, g);
+
+    static const Relu relu;
+    var x = Tensor<float>(x_value), kernel = Tensor<float>(w_value), bias = Tensor<float>(b_value);
+
+    NodePtr<float> out = conv(x.expr, kernel.expr, bias.expr, g, &relu);
+    out->derive(Tensor<float>(grad));
+
+    CHECK(tests::MaxDifference(out->val.value, linear.out % mask) < 1e-4f);
+    CHECK(tests::MaxDifference(x->grad.value, masked.dx) < 1e-4f);
+    CHECK(tests::MaxDifference(kernel->grad.value, masked.dw) < 1e-4f);
+}
+
+int main() {
+    arma::arma_rng::set_seed(3);
+
+    TestPaths(Geometry(3, 7, 6, 4, 3, 3, 1, 0, Layout::NCHW), "3x3 NCHW");
+    TestPaths(Geometry(3, 7, 6, 4, 3, 3, 1, 0, Layout::NHWC), "3x3 NHWC");
+    TestPaths(Geometry(2, 8, 8, 3, 3, 3, 1, 1, Layout::NCHW), "3x3 padded NCHW");
+    TestPaths(Geometry(2, 9, 9, 3, 3, 2, 2, 1, Layout::NHWC), "3x2 padded stride 2 NHWC");
+    TestPaths(Geometry(4, 1, 20, 5, 1, 5, 1, 2, Layout::NCHW), "1D 5 padded NCHW");
+    TestRelu();
+
+    return tests::Failures();
+}
@@ -0,0 +1,295 @@
+#include <stratosml/core.hpp>
+#include <stratosml/tests/check.hpp>
+#include <armadillo>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using namespace stratos;
+using namespace stratos::data;
+using namespace std;
+
+/*
+ * CSV loading: cells parsed on their own, CRLF files, malformed and empty
+ * cells, files without rows, the multithreaded parse against a single
+ * thread, dictionary encoded categorical columns, and null cells tracked in
+ * validity bitmaps.
+ */
+
+string WriteFile(const string& name, const string& contents) {
+    const string path = (filesystem::temp_directory_path() / name).string();
+
+    ofstream out(path, ios::binary);
+    out << contents;
+    return path;
+}
+
+void TestParseCell() {
+    auto parse = [](const string& cell, float& value) {
+        bool valid;
+        const char* end = ParseCell(cell.data(), cell.data() + cell.size(), value, valid);
+        CHECK(end == cell.data() + cell.find_first_of(",\n") || (cell.find_first_of(",\n") == string::npos && end == cell.data() + cell.size()));
+        return valid;
+    };
+
+    float value;
+    CHECK(parse("1.5,2", value) && value == 1.5f);
+    CHECK(parse(" +3e2 \r\n", value) && value == 300.0f);
+    CHECK(parse("-0.25", value) && value == -0.25f);
+
+    CHECK(!parse(",1", value) && std::isnan(value));
+    CHECK(!parse("abc,1", value) && std::isnan(value));
+    CHECK(!parse("12abc,1", value) && std::isnan(value));
+    CHECK(!parse("1 2\n", value) && std::isnan(value));
+}
+
+void TestCRLF() {
+    const string path = WriteFile("stratos_crlf.csv", "a,b,c\r\n1,2,3\r\n4.5,-5,6\r\n7,12abc,9\r\n\r\n");
+
+    DataFrame df;
+    CHECK(LoadCSV(path, df, 1));
+
+    CHECK(df.GetColumns() == vector<string>({ "a", "b", "c" }));
+    CHECK(df.GetShape().first == 3);
+
+    CHECK(df["a"][0] == 1.0f && df["a"][1] == 4.5f && df["a"][2] == 7.0f);
+    CHECK(df["b"][0] == 2.0f && df["b"][1] == -5.0f && std::isnan(df["b"][2]));
+    CHECK(df["c"][0] == 3.0f && df["c"][1] == 6.0f && df["c"][2] == 9.0f);
+
+    filesystem::remove(path);
+}
+
+void TestShapes() {
+    // Only the header, with and without its newline
+    for (const string& contents : { string("x,y"), string("x,y\n"), string("x,y\r\n") }) {
+        const string path = WriteFile("stratos_header.csv", contents);
+
+        DataFrame df;
+        CHECK(LoadCSV(path, df, 1));
+        CHECK(df.GetColumns() == vector<string>({ "x", "y" }));
+        CHECK(df.GetShape().first == 0);
+
+        filesystem::remove(path);
+    }
+
+    // A last line without newline, short rows padded with NaN
+    const string path = WriteFile("stratos_short.csv", "x,y\n1,2\n3\n5,6");
+
+    DataFrame df;
+    CHECK(LoadCSV(path, df, 1));
+    CHECK(df.GetShape().first == 3);
+    CHECK(df["x"][2] == 5.0f && df["y"][2] == 6.0f);
+    CHECK(df["x"][1] == 3.0f && std::isnan(df["y"][1]));
+
+    filesystem::remove(path);
+
+    DataFrame missing;
+    CHECK(!LoadCSV((filesystem::temp_directory_path() / "stratos_missing.csv").string(), missing, 1));
+}
+
+// Several megabytes so every thread gets a chunk, boundaries fall mid-line
+void TestThreads() {
+    const size_t rows = 200000;
+
+    string contents = "id,value,flag\r\n";
+    for (size_t r = 0; r < rows; ++r) {
+        contents += to_string(r) + "," + to_string(r * 0.5) + "," + (r % 7 == 0 ? "" : to_string(r % 3)) + "\r\n";
+    }
+
+    const string path = WriteFile("stratos_threads.csv", contents);
+
+    DataFrame single, parallel;
+    CHECK(LoadCSV(path, single, 1));
+    CHECK(LoadCSV(path, parallel, 4));
+
+    CHECK(parallel.GetShape().first == rows);
+
+    bool matches = true;
+    for (size_t r = 0; r < rows; ++r) {
+        matches = matches && parallel["id"][r] == (float)r && parallel["value"][r] == (float)(r * 0.5);
+        matches = matches && (r % 7 == 0 ? std::isnan(parallel["flag"][r]) : parallel["flag"][r] == (float)(r % 3));
+        matches = matches && single["id"][r] == parallel["id"][r] && single["value"][r] == parallel["value"][r];
+    }
+    CHECK(matches);
+
+    filesystem::remove(path);
+}
+
+void TestDictionary() {
+    StringDictionary dictionary;
+
+    CHECK(dictionary.Intern("red") == 0);
+    CHECK(dictionary.Intern("") == 1);
+    CHECK(dictionary.Intern("red") == 0);
+    CHECK(dictionary.Find("blue") == -1);
+
+    // Growing the slot array keeps every code
+    for (size_t i = 0; i < 1000; ++i) dictionary.Intern("value " + to_string(i));
+
+    CHECK(dictionary.GetSize() == 1002);
+    CHECK(dictionary.Find("value 0") == 2 && dictionary.Find("value 999") == 1001);
+    CHECK(dictionary.Get(0) == "red" && dictionary.Get(1) == "" && dictionary.Get(500) == "value 498");
+}
+
+void TestCategorical() {
+    // city holds text in its first row, zip is named categorical
+    const string path = WriteFile("stratos_categorical.csv", "city,price,zip\r\nParis,1,75001\r\nLyon,2,69001\r\nParis,3,75001\r\n,4\r\n");
+
+    DataFrame df;
+    CHECK(LoadCSV(path, df, 1, { "zip" }));
+
+    CHECK(df.GetShape().first == 4);
+    CHECK(df.GetCategoricalColumns() == vector<string>({ "city", "zip" }));
+    CHECK(df["price"][3] == 4.0f);
+
+    const CategoricalColumn& city = df.GetCategorical("city");
+    CHECK(city.GetCardinality() == 3);
+    CHECK(city.Codes() == vector<uint32_t>({ 0, 1, 0, 2 }));
+    CHECK(city.Label(1) == "Lyon" && city.Label(3) == "");
+    CHECK(city.GetCodeSize() == 1);
+
+    // The short last row gets the empty category, the CR is not part of the label
+    const CategoricalColumn& zip = df.GetCategorical("zip");
+    CHECK(zip.Codes() == vector<uint32_t>({ 0, 1, 0, 2 }));
+    CHECK(zip.Label(0) == "75001" && zip.Label(3) == "");
+
+    filesystem::remove(path);
+}
+
+// Per-thread dictionaries merged into first-seen order, codes wider than a byte
+void TestCategoricalThreads() {
+    const size_t rows = 300000;
+
+    string contents = "label,x\n";
+    for (size_t r = 0; r < rows; ++r) {
+        contents += "k" + to_string(r * 7919 % 600) + "," + to_string(r) + "\n";
+    }
+
+    const string path = WriteFile("stratos_categorical_threads.csv", contents);
+
+    DataFrame single, parallel;
+    CHECK(LoadCSV(path, single, 1));
+    CHECK(LoadCSV(path, parallel, 4));
+
+    const CategoricalColumn& a = single.GetCategorical("label");
+    const CategoricalColumn& b = parallel.GetCategorical("label");
+
+    CHECK(b.GetCardinality() == 600);
+    CHECK(b.GetCodeSize() == 2);
+    CHECK(a.Codes() == b.Codes());
+
+    bool matches = true;
+    for (size_t r = 0; r < rows; r += 97) {
+        matches = matches && b.Label(r) == "k" + to_string(r * 7919 % 600) && parallel["x"][r] == (float)r;
+    }
+    CHECK(matches);
+
+    filesystem::remove(path);
+}
+
+// v = row with nulls at rows 3, 13, ... 143, the text cell at 70 and the
+// malformed one at 149, w without nulls
+string NullContents() {
+    string contents = "v,w\n";
+    for (size_t r = 0; r < 150; ++r) {
+        const string v = r % 10 == 3 ? "" : r == 70 ? "n/a" : r == 149 ? "5x" : to_string(r);
+        contents += v + "," + to_string(r) + "\n";
+    }
+
+    return contents;
+}
+
+bool IsNullRow(size_t r) {
+    return r % 10 == 3 || r == 70 || r == 149;
+}
+
+void TestNulls() {
+    const string path = WriteFile("stratos_nulls.csv", NullContents());
+
+    DataFrame df;
+    CHECK(LoadCSV(path, df, 1));
+
+    const Series& v = df["v"];
+    CHECK(v.GetNullCount() == 17);
+    CHECK(v.GetValidity() != nullptr);
+    CHECK(df["w"].GetValidity() == nullptr && df["w"].GetNullCount() == 0);
+
+    bool matches = true;
+    double sum = 0;
+    vector<float> valid;
+
+    for (size_t r = 0; r < 150; ++r) {
+        matches = matches && v.IsValid(r) == !IsNullRow(r) && (IsNullRow(r) ? std::isnan(v[r]) : v[r] == (float)r);
+        if (!IsNullRow(r)) {
+            sum += r;
+            valid.push_back((float)r);
+        }
+    }
+    CHECK(matches);
+
+    // Statistics leave the nulls out
+    const ColumnStats stats = v.GetStats();
+    CHECK(stats.count == 133);
+    CHECK(stats.min == 0 && stats.max == 148);
+    CHECK_NEAR(stats.mean, sum / 133, 1e-4);
+
+    std::nth_element(valid.begin(), valid.begin() + 66, valid.end());
+    CHECK(v.GetMedian() == valid[66]);
+
+    ColumnScaler scaler(Scaler::MinMax);
+    scaler.Fit(df, { "v" });
+    CHECK(scaler.GetParams("v") == make_pair(0.0f, 148.0f));
+
+    // Imputing fills only the null rows and drops the bitmap
+    df["v"].Impute(Imputer::Median);
+    CHECK(df["v"].GetValidity() == nullptr);
+    CHECK(df["v"][3] == valid[66] && df["v"][149] == valid[66] && df["v"][4] == 4.0f);
+
+    DataFrame filled;
+    CHECK(LoadCSV(path, filled, 1));
+    filled.Impute(Imputer::Constant, -1.0f);
+    CHECK(filled["v"].GetNullCount() == 0);
+    CHECK(filled["v"][70] == -1.0f && filled["v"][71] == 71.0f && filled["w"][70] == 70.0f);
+
+    DataFrame mean;
+    CHECK(LoadCSV(path, mean, 1));
+    mean.Impute(Imputer::Mean);
+    CHECK_NEAR(mean["v"][13], sum / 133, 1e-4);
+
+    filesystem::remove(path);
+}
+
+// Threads clearing bits of shared bitmap words
+void TestNullThreads() {
+    const size_t rows = 200000;
+
+    string contents = "v,i\n";
+    for (size_t r = 0; r < rows; ++r) contents += (r % 5 == 0 ? string() : to_string(r)) + "," + to_string(r) + "\n";
+
+    const string path = WriteFile("stratos_null_threads.csv", contents);
+
+    DataFrame single, parallel;
+    CHECK(LoadCSV(path, single, 1));
+    CHECK(LoadCSV(path, parallel, 4));
+
+    CHECK(parallel.GetShape().first == rows);
+    CHECK(parallel["v"].GetNullCount() == rows / 5);
+    CHECK(std::equal(single["v"].GetValidity(), single["v"].GetValidity() + ValidityWords(rows), parallel["v"].GetValidity()));
+
+    filesystem::remove(path);
+}
+
+int main() {
+    TestParseCell();
+    TestCRLF();
+    TestShapes();
+    TestThreads();
+    TestDictionary();
+    TestCategorical();
+    TestCategoricalThreads();
+    TestNulls();
+    TestNullThreads();
+
+    return tests::Failures();
+}
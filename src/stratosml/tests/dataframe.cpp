@@ -0,0 +1,191 @@
+#include <stratosml/core.hpp>
+#include <stratosml/tests/check.hpp>
+#include <armadillo>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace stratos;
+using namespace stratos::data;
+using namespace std;
+
+/*
+ * The DataFrame block: GetMatrix and Select of adjacent columns viewing the
+ * frame's memory, other selections copied, and Series views that stay valid
+ * and keep their values when the block is reallocated by Reserve or
+ * AddColumn, or compacted by RemoveColumn.
+ */
+
+const size_t rows = 50;
+
+// Column c holds 100 * c + row
+void Fill(DataFrame& df, const vector<string>& names) {
+    for (const string& col : names) {
+        const size_t c = df.GetShape().second;
+        df.AddColumn(col, rows);
+        for (size_t r = 0; r < rows; ++r) df[col][r] = 100.0f * c + r;
+    }
+}
+
+// Whether the Series views column c of the block and holds the values Fill gave column filled
+bool Views(DataFrame& df, const Series& series, size_t c, size_t filled) {
+    if (series.data.value.memptr() != df.GetColumnData(c)) return false;
+
+    for (size_t r = 0; r < rows; ++r) {
+        if (series[r] != 100.0f * filled + r) return false;
+    }
+
+    return true;
+}
+
+void TestMatrix() {
+    DataFrame df;
+    Fill(df, { "a", "b", "c" });
+
+    // Columns follow each other in the block
+    CHECK(df.GetColumnData(1) == df.GetColumnData(0) + rows);
+
+    Tensor<float> matrix = df.GetMatrix();
+    CHECK(matrix.value.memptr() == df.GetColumnData(0));
+    CHECK(matrix.value.n_rows == rows && matrix.value.n_cols == 3);
+    CHECK(matrix.value(7, 2) == 207.0f && df(7, 2) == 207.0f);
+
+    // Writes go through in both directions
+    matrix.value(3, 1) = -1.0f;
+    CHECK(df["b"][3] == -1.0f);
+
+    df["c"][4] = -2.0f;
+    CHECK(matrix.value(4, 2) == -2.0f);
+}
+
+void TestSelect() {
+    DataFrame df;
+    Fill(df, { "a", "b", "c", "d" });
+
+    // Adjacent columns in frame order are a view starting at the first one
+    Tensor<float> view = df.Select({ "b", "c" });
+    CHECK(view.value.memptr() == df.GetColumnData(1));
+    CHECK(view.value.n_rows == rows && view.value.n_cols == 2);
+    CHECK(view.value(6, 1) == 206.0f);
+
+    view.value(6, 1) = -1.0f;
+    CHECK(df["c"][6] == -1.0f);
+    df["c"][6] = 206.0f;
+
+    Tensor<float> single = df.Select({ "d" });
+    CHECK(single.value.memptr() == df.GetColumnData(3));
+
+    // Gaps or another order are gathered into memory of their own
+    const float* begin = df.GetColumnData(0);
+    const float* end = df.GetColumnData(3) + rows;
+
+    for (const vector<string>& cols : { vector<string>({ "a", "c" }), vector<string>({ "c", "b" }) }) {
+        Tensor<float> copy = df.Select(cols);
+        const float* memory = copy.value.memptr();
+
+        CHECK(memory < begin || memory >= end);
+
+        bool matches = true;
+        for (size_t i = 0; i < cols.size(); ++i) {
+            for (size_t r = 0; r < rows; ++r) matches = matches && copy.value(r, i) == df[cols[i]][r];
+        }
+        CHECK(matches);
+
+        copy.value(0, 0) = -5.0f;
+        CHECK(df[cols[0]][0] != -5.0f);
+    }
+
+    // A view through a Tensor copy is deep, the frame is not written
+    Tensor<float> deep = df.Select({ "a", "b" });
+    Tensor<float> copied = deep;
+    copied.value(1, 0) = -7.0f;
+    CHECK(df["a"][1] == 1.0f);
+
+    bool thrown = false;
+    try {
+        df.Select({});
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+void TestReserve() {
+    DataFrame df;
+    Fill(df, { "a", "b" });
+
+    Series& a = df["a"];
+    Series& b = df["b"];
+    const float* before = df.GetColumnData(0);
+
+    // Room for more columns moves the block, the views follow it
+    df.Reserve(64);
+    CHECK(df.GetColumnData(0) != before);
+    CHECK(Views(df, a, 0, 0) && Views(df, b, 1, 1));
+
+    b[5] = -3.0f;
+    CHECK(df(5, 1) == -3.0f);
+    b[5] = 105.0f;
+
+    // Columns within the reserved capacity leave the block in place
+    const float* reserved = df.GetColumnData(0);
+    for (size_t c = 2; c < 10; ++c) Fill(df, { "x" + to_string(c) });
+
+    CHECK(df.GetColumnData(0) == reserved);
+    CHECK(Views(df, a, 0, 0) && Views(df, b, 1, 1));
+
+    // A smaller capacity changes nothing
+    df.Reserve(1);
+    CHECK(df.GetColumnData(0) == reserved);
+}
+
+void TestGrow() {
+    DataFrame df;
+    Fill(df, { "first" });
+
+    Series& first = df["first"];
+
+    // Adding past the capacity reallocates the block several times
+    for (size_t c = 1; c < 40; ++c) Fill(df, { "x" + to_string(c) });
+
+    CHECK(Views(df, first, 0, 0));
+    CHECK(Views(df, df["x39"], 39, 39));
+}
+
+void TestRemove() {
+    DataFrame df;
+    Fill(df, { "a", "b", "c", "d" });
+
+    Series& c = df["c"];
+    Series& d = df["d"];
+
+    df.RemoveColumn("b");
+
+    CHECK(df.GetColumns() == vector<string>({ "a", "c", "d" }));
+    CHECK(df.GetColumnIndex("c") == 1 && df.GetColumnIndex("d") == 2);
+    CHECK(Views(df, c, 1, 2) && Views(df, d, 2, 3));
+    CHECK(!df.HasColumn("b"));
+
+    // The matrix is still one view over the compacted block
+    Tensor<float> matrix = df.GetMatrix();
+    CHECK(matrix.value.memptr() == df.GetColumnData(0) && matrix.value.n_cols == 3);
+    CHECK(matrix.value(9, 2) == 309.0f);
+
+    bool thrown = false;
+    try {
+        df.RemoveColumn("b");
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+int main() {
+    TestMatrix();
+    TestSelect();
+    TestReserve();
+    TestGrow();
+    TestRemove();
+
+    return tests::Failures();
+}
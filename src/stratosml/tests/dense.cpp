@@ -0,0 +1,90 @@
+#include <stratosml/core.hpp>
+#include <stratosml/tests/check.hpp>
+#include <armadillo>
+
+using namespace stratos;
+using namespace stratos::autodiff;
+using namespace stratos::activations;
+using namespace std;
+
+/*
+ * Fused Dense node: activation(x * kernel + bias) and its gradients against
+ * the same computation written out step by step with Armadillo.
+ */
+
+// f(z) and f'(z)
+void Reference(const Activation& activation, const arma::Mat<float>& z, arma::Mat<float>& out, arma::Mat<float>& derivative) {
+    if (dynamic_cast<const Sigmoid*>(&activation)) {
+        out = 1.0f / (1.0f + arma::exp(-z));
+        derivative = out % (1.0f - out);
+    } else if (dynamic_cast<const Tanh*>(&activation)) {
+        out = arma::tanh(z);
+        derivative = 1.0f - out % out;
+    } else if (dynamic_cast<const Relu*>(&activation)) {
+        out = arma::clamp(z, 0.0f, INFINITY);
+        derivative = arma::conv_to<arma::Mat<float>>::from(z > 0.0f);
+    } else {
+        out = z;
+        derivative.ones(arma::size(z));
+    }
+}
+
+void TestActivation(const Activation& activation, const char* name) {
+    const size_t n = 37, in = 11, units = 5;
+
+    const arma::Mat<float> x_value(n, in, arma::fill::randn);
+    const arma::Mat<float> w_value(in, units, arma::fill::randn);
+    const arma::Mat<float> b_value(units, 1, arma::fill::randn);
+    const arma::Mat<float> grad(n, units, arma::fill::randn);
+
+    var x = Tensor<float>(x_value), kernel = Tensor<float>(w_value), bias = Tensor<float>(b_value);
+
+    NodePtr<float> out = dense(x.expr, kernel.expr, bias.expr, &activation);
+    out->derive(Tensor<float>(grad));
+
+    arma::Mat<float> z = x_value * w_value;
+    z.each_row() += b_value.t();
+
+    arma::Mat<float> expected, derivative;
+    Reference(activation, z, expected, derivative);
+
+    const arma::Mat<float> dz = grad % derivative;
+
+    printf("%s\n", name);
+    CHECK(tests::MaxDifference(out->val.value, expected) < 1e-5f);
+    CHECK(tests::MaxDifference(kernel->grad.value, x_value.t() * dz) < 1e-4f);
+    CHECK(tests::MaxDifference(bias->grad.value, arma::sum(dz, 0).t()) < 1e-4f);
+    CHECK(tests::MaxDifference(x->grad.value, dz * w_value.t()) < 1e-4f);
+}
+
+// Wide layers are computed in several column tiles
+void TestTiles() {
+    const size_t n = 4096, in = 3, units = 40;
+
+    const arma::Mat<float> x_value(n, in, arma::fill::randn);
+    const arma::Mat<float> w_value(in, units, arma::fill::randn);
+    const arma::Mat<float> b_value(units, 1, arma::fill::randn);
+
+    const Tanh activation;
+    constant x = Tensor<float>(x_value);
+    var kernel = Tensor<float>(w_value), bias = Tensor<float>(b_value);
+
+    NodePtr<float> out = dense(x.expr, kernel.expr, bias.expr, &activation);
+
+    arma::Mat<float> z = x_value * w_value;
+    z.each_row() += b_value.t();
+
+    CHECK(tests::MaxDifference(out->val.value, arma::tanh(z)) < 1e-5f);
+}
+
+int main() {
+    arma::arma_rng::set_seed(7);
+
+    TestActivation(Linear(), "Linear");
+    TestActivation(Relu(), "Relu");
+    TestActivation(Sigmoid(), "Sigmoid");
+    TestActivation(Tanh(), "Tanh");
+    TestTiles();
+
+    return tests::Failures();
+}
@@ -0,0 +1,114 @@
+#include <stratosml/core.hpp>
+#include <stratosml/tests/check.hpp>
+#include <armadillo>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace stratos;
+using namespace stratos::autodiff;
+using namespace stratos::optimizers;
+using namespace std;
+
+/*
+ * Embedding lookups: output rows copied from the table, the dense table
+ * gradient against a naive scatter, and the row-sparse gradient holding only
+ * the looked-up rows, which is all an optimizer step moves.
+ */
+
+const size_t vocabulary = 6, dim = 3;
+
+// (4, 2) indices, row 1 repeats in a sample and across samples, rows 4 and 5 are never hit
+const arma::Mat<float> indices = { { 1, 1 }, { 0, 3 }, { 2, 1 }, { 3, 0 } };
+
+void TestLookup() {
+    const arma::Mat<float> table_value(vocabulary, dim, arma::fill::randn);
+    const arma::Mat<float> grad(indices.n_rows, indices.n_cols * dim, arma::fill::randn);
+
+    constant x = Tensor<float>(indices);
+    var table = Tensor<float>(table_value);
+
+    NodePtr<float> out = embedding(x.expr, table.expr);
+    out->derive(Tensor<float>(grad));
+
+    arma::Mat<float> expected(indices.n_rows, indices.n_cols * dim);
+    arma::Mat<float> dt(vocabulary, dim, arma::fill::zeros);
+
+    for (size_t r = 0; r < indices.n_rows; ++r)
+        for (size_t k = 0; k < indices.n_cols; ++k)
+            for (size_t d = 0; d < dim; ++d) {
+                const size_t row = (size_t)indices(r, k);
+                expected(r, k * dim + d) = table_value(row, d);
+                dt(row, d) += grad(r, k * dim + d);
+            }
+
+    CHECK(tests::MaxDifference(out->val.value, expected) == 0);
+    CHECK(tests::MaxDifference(table->grad.value, dt) < 1e-6f);
+
+    // Integer codes give the same lookup as the float indices
+    vector<uint32_t> codes(indices.n_elem);
+    for (size_t i = 0; i < indices.n_elem; ++i) codes[i] = (uint32_t)indices(i);
+
+    var coded_table = Tensor<float>(table_value);
+    NodePtr<float> coded = embedding(std::move(codes), indices.n_rows, coded_table.expr);
+    CHECK(tests::MaxDifference(coded->val.value, expected) == 0);
+
+    // Indices outside the vocabulary
+    bool thrown = false;
+    try {
+        constant bad = Tensor<float>(arma::Mat<float>(2, 1, arma::fill::value((float)vocabulary)));
+        embedding(bad.expr, table.expr);
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+void TestSparse() {
+    const arma::Mat<float> table_value(vocabulary, dim, arma::fill::randn);
+    const arma::Mat<float> grad(indices.n_rows, indices.n_cols * dim, arma::fill::randn);
+
+    auto table = std::make_shared<var>(Tensor<float>(table_value));
+    auto node = std::make_shared<SparseVariableNode<float>>(Tensor<float>(table_value));
+    table->expr = node;
+
+    constant x = Tensor<float>(indices);
+    NodePtr<float> out = embedding(x.expr, table->expr);
+    out->derive(Tensor<float>(grad));
+
+    // The dense reference through a plain table
+    var dense_table = Tensor<float>(table_value);
+    embedding(x.expr, dense_table.expr)->derive(Tensor<float>(grad));
+    const arma::Mat<float>& dt = dense_table->grad.value;
+
+    // Rows in the order they were first hit, each once
+    const RowSparseGrad<float>& sparse_grad = node->sparse_grad;
+    CHECK(node->grad.value.n_elem == 0);
+    CHECK(sparse_grad.rows == vector<uint32_t>({ 1, 0, 2, 3 }));
+
+    float difference = 0;
+    for (size_t i = 0; i < sparse_grad.size(); ++i)
+        for (size_t d = 0; d < dim; ++d)
+            difference = std::max(difference, std::abs(sparse_grad.row(i)[d] - dt(sparse_grad.rows[i], d)));
+    CHECK(difference < 1e-6f);
+
+    // A step moves only the looked-up rows
+    GradientDescent sgd(0.5f);
+    sgd.step({ table });
+
+    const arma::Mat<float>& updated = node->val.value;
+    CHECK(tests::MaxDifference(updated.rows(0, 3), table_value.rows(0, 3) - 0.5f * dt.rows(0, 3)) < 1e-6f);
+    CHECK(tests::MaxDifference(updated.rows(4, 5), table_value.rows(4, 5)) == 0);
+
+    node->zero_grad();
+    CHECK(sparse_grad.size() == 0 && sparse_grad.values.empty());
+    CHECK(std::all_of(sparse_grad.slot.begin(), sparse_grad.slot.end(), [](int32_t slot) { return slot == -1; }));
+}
+
+int main() {
+    arma::arma_rng::set_seed(5);
+
+    TestLookup();
+    TestSparse();
+
+    return tests::Failures();
+}
@@ -0,0 +1,328 @@
+#include <stratosml/core.hpp>
+#include <stratosml/tests/check.hpp>
+#include <armadillo>
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace stratos;
+using namespace stratos::data;
+using namespace std;
+
+/*
+ * Column encodings: every encoding decoding its values bit for bit, null rows
+ * decoding to NaN, and a compressed frame read, rewritten, saved and batched
+ * as if its columns were still in the block.
+ */
+
+const size_t rows = 4096;
+
+// Columns in the order Fill adds them, each fitting one encoding best
+const vector<string> names = { "half", "tenths", "hundredths", "runs", "dict", "x", "noise" };
+
+float Value(const string& col, size_t r) {
+    // Multiples of 1/1024 below 2 fit half precision, not a decimal step
+    if (col == "half") return (r % 2048) / 1024.0f;
+
+    // Built with the decode arithmetic, 100 and 1000 codes
+    if (col == "tenths") return (float)((r % 100) * 0.1);
+    if (col == "hundredths") return (float)(((double)(r % 1000) - 500) * 0.01);
+
+    if (col == "runs") return r < 1000 ? 3.14159f : r < 3000 ? -1e30f : 2.5e-8f;
+
+    // Four values no step or half fits, never twice in a row
+    if (col == "dict") {
+        const float table[] = { 1.0f / 3, 1e-20f, 12345.678f, -7.77e10f };
+        return table[r * 7 % 4];
+    }
+
+    // Integers up to 4095, too wide for half precision
+    if (col == "x") return (float)r;
+
+    // Distinct values no encoding fits
+    return (float)(std::sin((double)r) * 1000);
+}
+
+void Fill(DataFrame& df) {
+    for (const string& col : names) {
+        df.AddColumn(col, rows);
+        for (size_t r = 0; r < rows; ++r) df[col][r] = Value(col, r);
+    }
+}
+
+bool SameColumn(const string& col, const float* values) {
+    for (size_t r = 0; r < rows; ++r) {
+        if (!SameValue(values[r], Value(col, r))) return false;
+    }
+
+    return true;
+}
+
+void TestEncodings() {
+    const vector<pair<string, Encoding>> expected = {
+        { "half", Encoding::Float16 },
+        { "tenths", Encoding::Scaled8 },
+        { "hundredths", Encoding::Scaled16 },
+        { "runs", Encoding::RunLength },
+        { "dict", Encoding::Dictionary },
+        { "x", Encoding::Scaled16 }
+    };
+
+    // Rows out of order and repeated, across runs and bitmap words
+    const vector<size_t> picked = { 4095, 0, 999, 1000, 2999, 3000, 64, 63, 1000, 2047, 2048 };
+
+    for (const auto& [col, encoding] : expected) {
+        vector<float> values(rows);
+        for (size_t r = 0; r < rows; ++r) values[r] = Value(col, r);
+
+        const optional<EncodedColumn> column = EncodedColumn::Choose(col, values.data(), rows);
+        CHECK(column && column->GetEncoding() == encoding);
+        if (!column) continue;
+
+        CHECK(column->GetName() == col && column->GetSize() == rows);
+        CHECK(column->GetValidity() == nullptr);
+        CHECK(column->GetMemoryUsage() < rows * sizeof(float) * 3 / 4);
+
+        vector<float> decoded(rows);
+        column->Decode(0, rows, decoded.data());
+        CHECK(SameColumn(col, decoded.data()));
+
+        // A range starting inside a run or a bitmap word
+        vector<float> part(1500);
+        column->Decode(990, 1500, part.data());
+
+        bool matches = true;
+        for (size_t i = 0; i < part.size(); ++i) matches = matches && SameValue(part[i], values[990 + i]);
+        CHECK(matches);
+
+        vector<float> gathered(picked.size());
+        column->Gather(picked.data(), picked.size(), gathered.data());
+
+        matches = true;
+        for (size_t i = 0; i < picked.size(); ++i) matches = matches && SameValue(gathered[i], values[picked[i]]);
+        CHECK(matches);
+
+        const ColumnStats stats = column->GetStats(), reference(values.data(), rows);
+        CHECK(stats.count == rows && stats.min == reference.min && stats.max == reference.max);
+        CHECK_NEAR(stats.mean, reference.mean, 1e-6 * std::abs(reference.mean) + 1e-6);
+    }
+
+    vector<float> noise(rows);
+    for (size_t r = 0; r < rows; ++r) noise[r] = Value("noise", r);
+    CHECK(!EncodedColumn::Choose("noise", noise.data(), rows));
+
+    // A tolerance accepts half precision within that relative error
+    vector<float> near_one(rows);
+    for (size_t r = 0; r < rows; ++r) near_one[r] = 1.0f + (float)(std::sin((double)r) * 0.5 + 0.5);
+
+    CHECK(!EncodedColumn::Choose("near_one", near_one.data(), rows));
+
+    const optional<EncodedColumn> lossy = EncodedColumn::Choose("near_one", near_one.data(), rows, nullptr, 1e-3f);
+    CHECK(lossy && lossy->GetEncoding() == Encoding::Float16);
+
+    if (lossy) {
+        vector<float> decoded(rows);
+        lossy->Decode(0, rows, decoded.data());
+
+        bool close = true;
+        for (size_t r = 0; r < rows; ++r) close = close && std::abs(decoded[r] - near_one[r]) <= 1e-3f * near_one[r];
+        CHECK(close);
+    }
+
+    CHECK(!EncodedColumn::Choose("empty", nullptr, 0));
+}
+
+// Null rows hold any value and decode to NaN, the bitmap is kept
+void TestNulls() {
+    vector<float> values(rows);
+    vector<uint64_t> validity(ValidityWords(rows), 0);
+
+    for (size_t r = 0; r < rows; ++r) {
+        const bool valid = r % 10 != 3;
+        values[r] = valid ? Value("tenths", r) : 1e30f;
+        if (valid) validity[r / 64] |= 1ull << (r % 64);
+    }
+
+    const optional<EncodedColumn> column = EncodedColumn::Choose("v", values.data(), rows, validity.data());
+    CHECK(column && column->GetEncoding() == Encoding::Scaled8);
+    if (!column) return;
+
+    CHECK(column->GetValidity() && std::equal(validity.begin(), validity.end(), column->GetValidity()));
+
+    vector<float> decoded(rows);
+    column->Decode(0, rows, decoded.data());
+
+    bool matches = true;
+    for (size_t r = 0; r < rows; ++r) matches = matches && (r % 10 == 3 ? std::isnan(decoded[r]) : decoded[r] == values[r]);
+    CHECK(matches);
+
+    const ColumnStats stats = column->GetStats();
+    CHECK(stats.count == rows - 410 && stats.min == 0.0f);
+}
+
+void TestFrame() {
+    DataFrame df;
+    Fill(df);
+
+    const size_t before = df.GetMemoryUsage();
+    CHECK(df.Compress() == 6);
+    CHECK(df.GetMemoryUsage() < before / 2);
+
+    // The block's columns first, then the encoded ones in frame order
+    CHECK(df.GetShape() == make_pair(rows, (size_t)7));
+    CHECK(df.GetColumns() == vector<string>({ "noise", "half", "tenths", "hundredths", "runs", "dict", "x" }));
+    CHECK(df.GetEncodedColumns() == vector<string>({ "half", "tenths", "hundredths", "runs", "dict", "x" }));
+    CHECK(df.GetBlockColumns() == 1);
+
+    for (const string& col : names) CHECK(df.HasColumn(col) && df.IsEncoded(col) == (col != "noise"));
+    CHECK(df.GetEncoded("runs").GetEncoding() == Encoding::RunLength);
+
+    const Tensor<float> matrix = df.GetMatrix();
+    const vector<string> order = df.GetColumns();
+
+    bool matches = matrix.value.n_rows == rows && matrix.value.n_cols == order.size();
+    for (size_t c = 0; matches && c < order.size(); ++c) matches = SameColumn(order[c], matrix.value.colptr(c));
+    CHECK(matches);
+
+    const Tensor<float> selected = df.Select({ "dict", "noise" });
+    CHECK(SameColumn("dict", selected.value.colptr(0)) && SameColumn("noise", selected.value.colptr(1)));
+
+    // A const frame hands out no Series of an encoded column
+    const DataFrame& view = df;
+
+    bool thrown = false;
+    try {
+        view["half"];
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+
+    vector<float> decoded(rows);
+    view.GetSource("half").Gather(nullptr, rows, decoded.data());
+    CHECK(SameColumn("half", decoded.data()));
+
+    // A writable Series decodes the column back into the block
+    Series& runs = df["runs"];
+    CHECK(!df.IsEncoded("runs") && df.GetBlockColumns() == 2);
+    CHECK(SameColumn("runs", runs.data.value.memptr()));
+    CHECK(df.GetColumns() == vector<string>({ "noise", "runs", "half", "tenths", "hundredths", "dict", "x" }));
+
+    df.Decompress();
+    CHECK(df.GetEncodedColumns().empty() && df.GetShape() == make_pair(rows, (size_t)7));
+    CHECK(SameColumn("dict", df["dict"].data.value.memptr()));
+}
+
+// Scale, Impute and ColumnScaler rewrite encoded columns like block ones
+void TestRecode() {
+    const vector<string> cols = { "half", "tenths", "hundredths", "runs", "dict", "noise" };
+
+    DataFrame plain, compressed;
+    Fill(plain);
+    Fill(compressed);
+    compressed.Compress();
+
+    plain.Scale(Scaler::MinMax);
+    compressed.Scale(Scaler::MinMax);
+    CHECK(tests::MaxDifference(compressed.Select(cols).value, plain.Select(cols).value) < 1e-6f);
+
+    DataFrame train, other_plain, other_compressed;
+    Fill(train);
+    Fill(other_plain);
+    Fill(other_compressed);
+    other_compressed.Compress();
+
+    ColumnScaler scaler(Scaler::Standart);
+    scaler.Fit(train, cols);
+    scaler.Transform(other_plain);
+    scaler.Transform(other_compressed);
+    CHECK(tests::MaxDifference(other_compressed.Select(cols).value, other_plain.Select(cols).value) < 1e-5f);
+
+    // Nulls of an encoded column are filled and its bitmap dropped
+    DataFrame nulls;
+    nulls.AddColumn("v", rows);
+    for (size_t r = 0; r < rows; ++r) {
+        nulls["v"][r] = Value("tenths", r);
+        if (r % 10 == 3) nulls["v"].SetNull(r);
+    }
+
+    CHECK(nulls.Compress() == 1);
+    CHECK(nulls.GetSource("v").GetValidity() != nullptr);
+    CHECK(nulls.GetSource("v").GetStats().count == rows - 410);
+
+    nulls.Impute(Imputer::Constant, -1.0f);
+    CHECK(nulls.GetSource("v").GetValidity() == nullptr);
+
+    vector<float> filled(rows);
+    nulls.GetSource("v").Gather(nullptr, rows, filled.data());
+
+    bool matches = true;
+    for (size_t r = 0; r < rows; ++r) matches = matches && filled[r] == (r % 10 == 3 ? -1.0f : Value("tenths", r));
+    CHECK(matches);
+}
+
+// A compressed frame is saved decoded and loads back as plain columns
+void TestSave() {
+    const string path = (filesystem::temp_directory_path() / "stratos_encoded.stratos").string();
+
+    DataFrame df;
+    Fill(df);
+    df.Compress();
+    CHECK(Save(path, df));
+
+    DataFrame loaded;
+    CHECK(Load(path, loaded));
+    CHECK(loaded.GetColumns() == df.GetColumns());
+    CHECK(loaded.GetEncodedColumns().empty());
+
+    for (const string& col : names) CHECK(SameColumn(col, loaded[col].data.value.memptr()));
+
+    filesystem::remove(path);
+}
+
+// Batches gather the encoded rows of every epoch
+void TestPipeline() {
+    DataFrame df;
+    Fill(df);
+    df.Compress();
+
+    Pipeline pipeline(df, { "x", "half", "dict" }, { "hundredths" }, 5);
+    pipeline.Shuffle(rows).Batch(100).Threads(2);
+
+    for (size_t epoch = 0; epoch < 2; ++epoch) {
+        pipeline.BeginEpoch();
+
+        vector<int> seen(rows, 0);
+        bool matches = true;
+
+        while (BatchBuffer* batch = pipeline.Next()) {
+            for (size_t i = 0; i < batch->rows; ++i) {
+                const size_t r = (size_t)batch->x.value(i, 0);
+                seen[r]++;
+
+                matches = matches && batch->x.value(i, 1) == Value("half", r) && batch->x.value(i, 2) == Value("dict", r);
+                matches = matches && batch->y.value(i, 0) == Value("hundredths", r);
+            }
+
+            pipeline.Release(batch);
+        }
+
+        CHECK(matches);
+        CHECK(std::all_of(seen.begin(), seen.end(), [](int count) { return count == 1; }));
+    }
+}
+
+int main() {
+    TestEncodings();
+    TestNulls();
+    TestFrame();
+    TestRecode();
+    TestSave();
+    TestPipeline();
+
+    return tests::Failures();
+}
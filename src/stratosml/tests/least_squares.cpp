@@ -0,0 +1,109 @@
+#include <stratosml/core.hpp>
+#include <stratosml/tests/check.hpp>
+#include <armadillo>
+#include <stdexcept>
+
+using namespace stratos;
+using namespace stratos::layers;
+using namespace stratos::optimizers;
+using namespace std;
+
+/*
+ * Closed-form least squares: a linear model recovering y = 2x + 1 through Fit,
+ * and the streamed normal equations against a direct solve, with and without
+ * ridge regularization.
+ */
+
+void TestFit() {
+    arma::Mat<float> x(50, 1), y(50, 1);
+    for (size_t r = 0; r < 50; ++r) {
+        x(r) = (float)r / 10.0f - 2.0f;
+        y(r) = 2.0f * x(r) + 1.0f;
+    }
+
+    Dense* dense = new Dense(1);
+
+    Model model;
+    model.Add(dense);
+    model.Fit(Tensor<float>(x), Tensor<float>(y), 1);
+
+    const auto& weights = dense->weights;
+    CHECK_NEAR((*weights[1])->val.value(0), 2.0, 1e-5);
+    CHECK_NEAR((*weights[0])->val.value(0), 1.0, 1e-5);
+
+    // An activation makes the model non-linear, the forced solver refuses it
+    Model relu;
+    relu.solver = Solver::LeastSquares;
+    relu.Add(new Dense(1, new Relu()));
+
+    bool thrown = false;
+    try {
+        relu.Fit(Tensor<float>(x), Tensor<float>(y), 1);
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+// Centered ridge solution (Xc^T Xc + ridge I) w = Xc^T yc, bias from the means
+void Reference(const arma::Mat<double>& x, const arma::Mat<double>& y, double ridge, arma::Mat<double>& w, arma::Mat<double>& b) {
+    const arma::Mat<double> x_mean = arma::mean(x, 0), y_mean = arma::mean(y, 0);
+
+    arma::Mat<double> xc = x, yc = y;
+    xc.each_row() -= x_mean;
+    yc.each_row() -= y_mean;
+
+    arma::Mat<double> a = xc.t() * xc;
+    a.diag() += ridge;
+
+    w = arma::solve(a, xc.t() * yc);
+    b = y_mean.t() - w.t() * x_mean.t();
+}
+
+void TestNormalEquations(double ridge) {
+    // More rows than one conversion block, fed in three uneven pieces
+    const size_t n = LeastSquares::block_rows * 2 + 123, features = 4, targets = 2;
+
+    arma::Mat<float> x(n, features, arma::fill::randn);
+    x.col(1) += 5.0f;
+
+    const arma::Mat<float> true_w(features, targets, arma::fill::randn);
+    arma::Mat<float> y = x * true_w + 0.1f * arma::Mat<float>(n, targets, arma::fill::randn);
+    y.col(0) += 3.0f;
+
+    LeastSquares problem(features, targets, ridge);
+    problem.Add(x.rows(0, 999), y.rows(0, 999));
+    problem.Add(x.rows(1000, 5999), y.rows(1000, 5999));
+    problem.Add(x.rows(6000, n - 1), y.rows(6000, n - 1));
+    CHECK(problem.GetSize() == n);
+
+    arma::Mat<float> kernel, bias;
+    problem.Solve(kernel, bias);
+
+    arma::Mat<double> w, b;
+    Reference(arma::conv_to<arma::Mat<double>>::from(x), arma::conv_to<arma::Mat<double>>::from(y), ridge, w, b);
+
+    printf("ridge %g\n", ridge);
+    CHECK(kernel.n_rows == features && kernel.n_cols == targets);
+    CHECK(bias.n_rows == targets && bias.n_cols == 1);
+    CHECK(tests::MaxDifference(kernel, arma::conv_to<arma::Mat<float>>::from(w)) < 1e-4f);
+    CHECK(tests::MaxDifference(bias, arma::conv_to<arma::Mat<float>>::from(b)) < 1e-4f);
+}
+
+int main() {
+    arma::arma_rng::set_seed(19);
+
+    TestFit();
+    TestNormalEquations(0);
+    TestNormalEquations(50);
+
+    bool thrown = false;
+    try {
+        LeastSquares(3, 1, -1.0);
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+
+    return tests::Failures();
+}
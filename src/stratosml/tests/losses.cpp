@@ -0,0 +1,186 @@
+#include <stratosml/core.hpp>
+#include <stratosml/tests/check.hpp>
+#include <armadillo>
+#include <cmath>
+#include <stdexcept>
+
+using namespace stratos;
+using namespace stratos::autodiff;
+using namespace stratos::layers;
+using namespace stratos::losses;
+using namespace std;
+
+/*
+ * Fused softmax/sigmoid cross-entropies: loss and logit gradients against the
+ * unfused graph of an activation node followed by the probability loss, and
+ * targets of the wrong shape or labels that are not classes rejected.
+ */
+
+template<typename NodeType>
+bool IsNode(const var& v) {
+    auto dependent = std::dynamic_pointer_cast<DependentVariableNode<float>>(v.expr);
+    return std::dynamic_pointer_cast<NodeType>(dependent ? dependent->expr : v.expr) != nullptr;
+}
+
+void TestCategorical() {
+    const size_t n = 16, k = 5;
+    const arma::Mat<float> logits(n, k, arma::fill::randn);
+
+    arma::Mat<float> labels(n, 1);
+    for (size_t i = 0; i < n; ++i) labels(i) = (float)(i % k);
+
+    constant y = Tensor<float>(labels);
+
+    // Fused, the loss finds the softmax node under the prediction
+    var z_fused = Tensor<float>(logits);
+    var p_fused = softmax(z_fused.expr);
+    var fused = CategoricalCrossentropy()(y, p_fused);
+    CHECK(IsNode<SoftmaxCrossEntropyExprNode>(fused));
+    fused->derive(1.0f);
+
+    // Unfused, the clamped probability loss back through the softmax node
+    var z_plain = Tensor<float>(logits);
+    var plain = probability_cross_entropy(softmax(z_plain.expr), y.expr, false);
+    plain->derive(1.0f);
+
+    CHECK_NEAR(fused->val.value(0, 0), plain->val.value(0, 0), 1e-5);
+    CHECK(tests::MaxDifference(z_fused->grad.value, z_plain->grad.value) < 1e-6f);
+
+    // Target probabilities instead of labels
+    arma::Mat<float> one_hot(n, k, arma::fill::zeros);
+    for (size_t i = 0; i < n; ++i) one_hot(i, i % k) = 1.0f;
+
+    constant y_probs = Tensor<float>(one_hot);
+    var z_probs = Tensor<float>(logits);
+    var from_probs = CategoricalCrossentropy(true)(y_probs, z_probs);
+    from_probs->derive(1.0f);
+
+    CHECK_NEAR(from_probs->val.value(0, 0), fused->val.value(0, 0), 1e-5);
+    CHECK(tests::MaxDifference(z_probs->grad.value, z_fused->grad.value) < 1e-6f);
+}
+
+void TestBinary() {
+    const size_t n = 32;
+    const arma::Mat<float> logits(n, 1, arma::fill::randn);
+
+    arma::Mat<float> targets(n, 1);
+    for (size_t i = 0; i < n; ++i) targets(i) = (float)(i % 3 == 0);
+
+    constant y = Tensor<float>(targets);
+
+    var z_fused = Tensor<float>(logits);
+    var fused = BinaryCrossentropy()(y, var(sigmoid(z_fused.expr)));
+    CHECK(IsNode<SigmoidCrossEntropyExprNode>(fused));
+    fused->derive(1.0f);
+
+    var z_plain = Tensor<float>(logits);
+    var plain = probability_cross_entropy(sigmoid(z_plain.expr), y.expr, true);
+    plain->derive(1.0f);
+
+    CHECK_NEAR(fused->val.value(0, 0), plain->val.value(0, 0), 1e-5);
+    CHECK(tests::MaxDifference(z_fused->grad.value, z_plain->grad.value) < 1e-6f);
+
+    // Saturated logits, where the probability form is clamped: mean of 40 and 0
+    constant y_far = Tensor<float>(arma::Col<float>({ 0.0f, 1.0f }));
+    var z_far = Tensor<float>(arma::Col<float>({ 40.0f, 40.0f }));
+    var far = BinaryCrossentropy(true)(y_far, z_far);
+    CHECK_NEAR(far->val.value(0, 0), 20.0, 1e-4);
+}
+
+// A Dense layer folds its Sigmoid into its own node, the loss still takes the
+// fused path from the logits the node kept
+void TestDenseSigmoid() {
+    const size_t n = 24, in = 6;
+
+    const arma::Mat<float> x_value(n, in, arma::fill::randn);
+    const arma::Mat<float> kernel(in, 1, arma::fill::randn);
+    const arma::Mat<float> bias(1, 1, arma::fill::randn);
+
+    arma::Mat<float> targets(n, 1);
+    for (size_t i = 0; i < n; ++i) targets(i) = (float)(i % 2);
+
+    constant x = Tensor<float>(x_value);
+    constant y = Tensor<float>(targets);
+
+    Dense layer(1, new Sigmoid());
+    layer.build(TensorShape({ in }));
+    layer.assign_weights(kernel, bias);
+
+    var fused = BinaryCrossentropy()(y, layer.forward(x));
+    CHECK(IsNode<SigmoidCrossEntropyExprNode>(fused));
+
+    // Viewed from the Dense node, not computed by a second GEMM
+    auto dependent = std::dynamic_pointer_cast<DependentVariableNode<float>>(fused.expr);
+    auto loss = std::dynamic_pointer_cast<SigmoidCrossEntropyExprNode>(dependent ? dependent->expr : fused.expr);
+    auto logits = loss ? std::dynamic_pointer_cast<DenseLogitsExprNode>(loss->logits) : nullptr;
+    CHECK(logits && logits->val.value.memptr() == logits->dense->logits.memptr());
+
+    fused->derive(1.0f);
+
+    Dense plain_layer(1);
+    plain_layer.build(TensorShape({ in }));
+    plain_layer.assign_weights(kernel, bias);
+
+    var plain = probability_cross_entropy(sigmoid(plain_layer.forward(x).expr), y.expr, true);
+    plain->derive(1.0f);
+
+    CHECK_NEAR(fused->val.value(0, 0), plain->val.value(0, 0), 1e-5);
+
+    for (size_t w = 0; w < layer.weights.size(); ++w) {
+        CHECK(tests::MaxDifference((*layer.weights[w])->grad.value, (*plain_layer.weights[w])->grad.value) < 1e-5f);
+    }
+}
+
+bool Throws(const arma::Mat<float>& targets, const arma::Mat<float>& logits) {
+    try {
+        CategoricalCrossentropy(true)(constant(Tensor<float>(targets)), var(Tensor<float>(logits)));
+    } catch (const std::invalid_argument&) {
+        return true;
+    }
+    return false;
+}
+
+void TestTargets() {
+    const size_t n = 6, k = 3;
+    const arma::Mat<float> logits(n, k, arma::fill::randn);
+
+    arma::Mat<float> labels = { 0, 2, 1, 1, 0, 2 };
+    labels = labels.t();
+    CHECK(!Throws(labels, logits));
+
+    // Labels need one row per prediction and a whole class in [0, k)
+    CHECK(Throws(labels.rows(0, n - 2), logits));
+
+    for (float label : { -1.0f, 3.0f, 1.5f, NAN }) {
+        arma::Mat<float> bad = labels;
+        bad(4) = label;
+        CHECK(Throws(bad, logits));
+    }
+
+    // Probabilities need the shape of the predictions
+    CHECK(!Throws(arma::Mat<float>(n, k, arma::fill::ones) / k, logits));
+    CHECK(Throws(arma::Mat<float>(n, k - 1, arma::fill::zeros), logits));
+    CHECK(Throws(arma::Mat<float>(n + 1, k, arma::fill::zeros), logits));
+
+    // Binary targets are probabilities, never labels
+    bool thrown = false;
+    try {
+        constant p = Tensor<float>(arma::Mat<float>(n, 1, arma::fill::ones) * 0.5f);
+        constant y = Tensor<float>(arma::Mat<float>(n, 2, arma::fill::ones));
+        probability_cross_entropy(p.expr, y.expr, true);
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+int main() {
+    arma::arma_rng::set_seed(11);
+
+    TestCategorical();
+    TestBinary();
+    TestDenseSigmoid();
+    TestTargets();
+
+    return tests::Failures();
+}
@@ -11,6 +11,7 @@ int main() {
 
     const double learning_rate = 0.001;
     const size_t epochs = 10;
+    const size_t batch_size = 8;
 
     data::DataFrame df;
     data::Load("datasets/Salary_dataset.csv", df);
@@ -30,7 +31,7 @@ int main() {
 
     model.optimizer = new GradientDescent(new StepDecay(0.001, 0.9, 2));
 
-    model.Fit(df["YearsExperience"], df["Salary"], epochs);
+    model.Fit(df["YearsExperience"], df["Salary"], epochs, batch_size);
 
     constant x_test = {0.754717};
 
@@ -0,0 +1,88 @@
+#include <stratosml/core.hpp>
+#include <stratosml/tests/check.hpp>
+#include <armadillo>
+#include <algorithm>
+#include <vector>
+
+using namespace stratos;
+using namespace stratos::autodiff;
+using namespace stratos::layers;
+using namespace std;
+
+/*
+ * Memory planner: offsets placed by hand-checked rules, and the plan of an
+ * MLP training graph where tensors alive at the same step never share bytes
+ * and the arena is no larger than one buffer per tensor.
+ */
+
+bool Overlap(const TensorLifetime& a, const TensorLifetime& b) {
+    const bool in_time = a.first <= b.last && b.first <= a.last;
+    const bool in_memory = a.offset < b.offset + b.bytes && b.offset < a.offset + a.bytes;
+    return in_time && in_memory;
+}
+
+void TestAssignOffsets() {
+    // A and B never live together and share offset 0, C overlaps both and goes after them
+    vector<TensorLifetime> tensors = {
+        { 100, 0, 2, 0, false },
+        { 100, 3, 5, 0, false },
+        { 50, 1, 4, 0, true }
+    };
+
+    CHECK(AssignOffsets(tensors) == 150);
+    CHECK(tensors[0].offset == 0 && tensors[1].offset == 0 && tensors[2].offset == 100);
+
+    // C takes the bytes B held before it, A stays below both
+    tensors = {
+        { 100, 0, 9, 0, false },
+        { 80, 0, 1, 0, false },
+        { 60, 2, 3, 0, false }
+    };
+
+    CHECK(AssignOffsets(tensors) == 180);
+    CHECK(tensors[1].offset == 100 && tensors[2].offset == 100);
+}
+
+void TestPlan() {
+    Model model;
+    model.Add(new Dense(16, new Relu()));
+    model.Add(new Dense(16, new Tanh()));
+    model.Add(new Dense(1));
+
+    constant x = Tensor<float>(arma::Mat<float>(64, 8, arma::fill::randn));
+    constant y = Tensor<float>(arma::Mat<float>(64, 1, arma::fill::randn));
+
+    const MemoryPlan plan = model.PlanMemory(x, y);
+    CHECK(!plan.tensors.empty());
+
+    size_t total = 0;
+    bool ordered = true, inside = true, disjoint = true;
+
+    for (size_t i = 0; i < plan.tensors.size(); ++i) {
+        const TensorLifetime& tensor = plan.tensors[i];
+        total += tensor.bytes;
+
+        ordered = ordered && tensor.first <= tensor.last && tensor.last < plan.steps;
+        inside = inside && tensor.offset + tensor.bytes <= plan.planned_peak;
+
+        for (size_t j = i + 1; j < plan.tensors.size(); ++j) disjoint = disjoint && !Overlap(tensor, plan.tensors[j]);
+    }
+
+    CHECK(ordered && inside && disjoint);
+
+    // Gradients of the training graph are planned as well as the values
+    CHECK(std::any_of(plan.tensors.begin(), plan.tensors.end(), [](const TensorLifetime& t) { return t.gradient; }));
+
+    CHECK(plan.naive_peak == total);
+    CHECK(plan.live_peak <= plan.planned_peak && plan.planned_peak <= plan.naive_peak);
+    CHECK(plan.persistent > 0);
+}
+
+int main() {
+    arma::arma_rng::set_seed(41);
+
+    TestAssignOffsets();
+    TestPlan();
+
+    return tests::Failures();
+}
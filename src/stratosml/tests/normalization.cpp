@@ -0,0 +1,207 @@
+#include <stratosml/core.hpp>
+#include <stratosml/tests/check.hpp>
+#include <armadillo>
+#include <cmath>
+
+using namespace stratos;
+using namespace stratos::autodiff;
+using namespace stratos::layers;
+using namespace std;
+
+/*
+ * BatchNorm and LayerNorm: normalized outputs with zero mean and unit
+ * variance, the batch-statistics gradient against finite differences,
+ * FoldBatchNorm keeping a trained model's predictions, and running statistics
+ * updated once per step under checkpointing.
+ */
+
+// Columns with different offsets and scales
+arma::Mat<float> Features(size_t n, size_t d) {
+    arma::Mat<float> x(n, d, arma::fill::randn);
+    for (size_t j = 0; j < d; ++j) x.col(j) = x.col(j) * (1.0f + j) + 3.0f * j;
+    return x;
+}
+
+void TestBatchNorm() {
+    const size_t n = 256, d = 4;
+    const arma::Mat<float> x_value = Features(n, d);
+
+    BatchNorm norm(new Linear(), 0.9f, 1e-5f);
+    norm.build(TensorShape({ d }));
+    norm.training = true;
+
+    constant x = Tensor<float>(x_value);
+    const arma::Mat<float> out = norm.forward(x)->val.value;
+
+    const arma::Mat<double> mean = arma::mean(arma::conv_to<arma::Mat<double>>::from(out), 0);
+    const arma::Mat<double> variance = arma::mean(arma::square(arma::conv_to<arma::Mat<double>>::from(out)), 0);
+
+    for (size_t j = 0; j < d; ++j) {
+        CHECK_NEAR(mean(j), 0.0, 1e-4);
+        CHECK_NEAR(variance(j), 1.0, 1e-3);
+    }
+
+    // One step of the running statistics from their initial zeros and ones:
+    // 0.1 of the batch mean and 0.9 + 0.1 of the unbiased batch variance
+    arma::Mat<float> scale, shift;
+    norm.affine(scale, shift);
+
+    for (size_t j = 0; j < d; ++j) {
+        const arma::Col<double> col = arma::conv_to<arma::Col<double>>::from(x_value.col(j));
+        const double batch_mean = arma::accu(col) / n;
+        const double batch_variance = arma::accu(arma::square(col - batch_mean)) / (n - 1);
+        const double running_variance = 0.9 + 0.1 * batch_variance;
+
+        CHECK_NEAR(scale(j), 1.0 / std::sqrt(running_variance + 1e-5), 1e-4);
+        CHECK_NEAR(shift(j), -0.1 * batch_mean * scale(j), 1e-4);
+    }
+
+    // Inference leaves the running statistics as they are
+    norm.training = false;
+    norm.forward(x);
+
+    arma::Mat<float> scale_after, shift_after;
+    norm.affine(scale_after, shift_after);
+    CHECK(tests::MaxDifference(scale, scale_after) == 0 && tests::MaxDifference(shift, shift_after) == 0);
+}
+
+// sum(out % g) of a training batch_norm node
+double Objective(const arma::Mat<float>& x, const arma::Mat<float>& gamma, const arma::Mat<float>& beta, const arma::Mat<float>& grad) {
+    static const Linear linear;
+    const arma::Mat<float> unused;
+
+    NodePtr<float> out = batch_norm(constant(Tensor<float>(x)).expr, constant(Tensor<float>(gamma)).expr, constant(Tensor<float>(beta)).expr,
+        unused, unused, 1e-3f, true, &linear);
+
+    return arma::accu(arma::conv_to<arma::Mat<double>>::from(out->val.value % grad));
+}
+
+void TestBatchNormGradient() {
+    const size_t n = 6, d = 3;
+
+    arma::Mat<float> x_value = Features(n, d);
+    arma::Mat<float> gamma_value(d, 1, arma::fill::randn), beta_value(d, 1, arma::fill::randn);
+    const arma::Mat<float> grad(n, d, arma::fill::randn);
+
+    static const Linear linear;
+    const arma::Mat<float> unused;
+
+    var x = Tensor<float>(x_value), gamma = Tensor<float>(gamma_value), beta = Tensor<float>(beta_value);
+    batch_norm(x.expr, gamma.expr, beta.expr, unused, unused, 1e-3f, true, &linear)->derive(Tensor<float>(grad));
+
+    const float eps = 1e-2f;
+
+    auto numeric = [&](arma::Mat<float>& value, size_t i) {
+        const float original = value(i);
+
+        value(i) = original + eps;
+        const double up = Objective(x_value, gamma_value, beta_value, grad);
+        value(i) = original - eps;
+        const double down = Objective(x_value, gamma_value, beta_value, grad);
+        value(i) = original;
+
+        return (up - down) / (2.0 * eps);
+    };
+
+    double worst = 0;
+    for (size_t i = 0; i < x_value.n_elem; ++i) worst = std::max(worst, std::abs(numeric(x_value, i) - x->grad.value(i)));
+    for (size_t i = 0; i < d; ++i) worst = std::max(worst, std::abs(numeric(gamma_value, i) - gamma->grad.value(i)));
+    for (size_t i = 0; i < d; ++i) worst = std::max(worst, std::abs(numeric(beta_value, i) - beta->grad.value(i)));
+
+    CHECK(worst < 5e-3);
+}
+
+void TestLayerNorm() {
+    const size_t n = 32, d = 64;
+
+    // Rows with different offsets and scales
+    arma::Mat<float> x_value(n, d, arma::fill::randn);
+    for (size_t r = 0; r < n; ++r) x_value.row(r) = x_value.row(r) * (1.0f + r % 4) - 2.0f * r;
+
+    LayerNorm norm(new Linear(), 1e-5f);
+    norm.build(TensorShape({ d }));
+
+    constant x = Tensor<float>(x_value);
+    const arma::Mat<double> out = arma::conv_to<arma::Mat<double>>::from(norm.forward(x)->val.value);
+
+    const arma::Mat<double> mean = arma::mean(out, 1);
+    const arma::Mat<double> variance = arma::mean(arma::square(out), 1);
+
+    CHECK(arma::abs(mean).max() < 1e-4);
+    CHECK(arma::abs(variance - 1.0).max() < 1e-3);
+}
+
+// Dense + BatchNorm(Relu) folds into one Dense(Relu), the predictions stay the same
+void TestFold() {
+    const size_t n = 128, d = 5;
+
+    const arma::Mat<float> x_value = Features(n, d);
+    const arma::Mat<float> y_value = arma::sum(x_value, 1);
+
+    Model model;
+    model.seed = 1;
+    model.Add(new Dense(8));
+    model.Add(new BatchNorm(new Relu(), 0.5f));
+    model.Add(new Dense(4));
+    model.Add(new BatchNorm());
+    model.Add(new Dense(1));
+
+    // A few epochs move gamma, beta and the running statistics away from their initial values
+    model.Fit(Tensor<float>(x_value), Tensor<float>(y_value), 5, 32);
+
+    const arma::Mat<float> before = model.Predict(Tensor<float>(x_value))->val.value;
+
+    model.FoldBatchNorm();
+
+    const arma::Mat<float> after = model.Predict(Tensor<float>(x_value))->val.value;
+
+    CHECK(tests::MaxDifference(before, after) < 1e-4f * std::max(1.0f, arma::abs(before).max()));
+}
+
+// Rematerializing a checkpointed segment leaves the running statistics alone
+void TestCheckpoint() {
+    const size_t n = 64, d = 4;
+
+    const arma::Mat<float> x_value = Features(n, d);
+    const arma::Mat<float> y_value = arma::sum(x_value, 1);
+
+    auto train = [&](size_t every, arma::Mat<float>& scale, arma::Mat<float>& shift) {
+        arma::arma_rng::set_seed(3);
+
+        Model model;
+        model.seed = 2;
+        model.Add(new Dense(6));
+
+        BatchNorm* norm = new BatchNorm(new Relu(), 0.5f);
+        model.Add(norm);
+        model.Add(new Dense(1));
+
+        model.Checkpoint(every);
+        model.Fit(Tensor<float>(x_value), Tensor<float>(y_value), 1, 16);
+
+        norm->affine(scale, shift);
+    };
+
+    arma::Mat<float> scale, shift;
+    train(0, scale, shift);
+
+    for (size_t every : { 1, 2 }) {
+        arma::Mat<float> checkpointed_scale, checkpointed_shift;
+        train(every, checkpointed_scale, checkpointed_shift);
+
+        CHECK(tests::MaxDifference(checkpointed_scale, scale) < 1e-5f);
+        CHECK(tests::MaxDifference(checkpointed_shift, shift) < 1e-5f);
+    }
+}
+
+int main() {
+    arma::arma_rng::set_seed(17);
+
+    TestBatchNorm();
+    TestBatchNormGradient();
+    TestLayerNorm();
+    TestFold();
+    TestCheckpoint();
+
+    return tests::Failures();
+}
@@ -0,0 +1,179 @@
+#include <stratosml/core.hpp>
+#include <stratosml/tests/check.hpp>
+#include <armadillo>
+#include <memory>
+#include <stdexcept>
+
+using namespace stratos;
+using namespace stratos::autodiff;
+using namespace stratos::optimizers;
+using namespace std;
+
+/*
+ * Optimizer steps against values worked out by hand, and L-BFGS converging
+ * on a quadratic.
+ */
+
+shared_ptr<var> Parameter(const arma::Mat<float>& value) {
+    return make_shared<var>(Tensor<float>(value));
+}
+
+// Textbook Adam in double: bias-corrected moments, then the decoupled decay
+void AdamReference(arma::Mat<double>& w, arma::Mat<double>& m, arma::Mat<double>& v, const arma::Mat<double>& g, size_t t, double lr, double weight_decay) {
+    m = 0.9 * m + 0.1 * g;
+    v = 0.999 * v + 0.001 * arma::square(g);
+
+    const arma::Mat<double> m_hat = m / (1 - std::pow(0.9, t));
+    const arma::Mat<double> v_hat = v / (1 - std::pow(0.999, t));
+
+    w = w * (1 - lr * weight_decay) - lr * m_hat / (arma::sqrt(v_hat) + 1e-8);
+}
+
+void TestAdam() {
+    // The first step moves every weight by lr against the sign of its gradient:
+    // m_hat = g and v_hat = g^2
+    auto w = Parameter(arma::Mat<float>(1, 2, arma::fill::ones));
+    (*w)->grad.value = arma::Mat<float>({ { 0.5f, -2.0f } });
+
+    Adam adam(0.1f);
+    adam.build({ w });
+    adam.step({ w });
+
+    CHECK_NEAR((*w)->val.value(0), 0.9, 1e-6);
+    CHECK_NEAR((*w)->val.value(1), 1.1, 1e-6);
+
+    // AdamW also shrinks the weights by lr * weight_decay: 1 * (1 - 0.1 * 0.01) - 0.1
+    auto decayed = Parameter(arma::Mat<float>(1, 1, arma::fill::ones));
+    (*decayed)->grad.value = arma::Mat<float>(1, 1, arma::fill::value(0.5f));
+
+    AdamW adamw(0.1f, 0.01f);
+    adamw.build({ decayed });
+    adamw.step({ decayed });
+
+    CHECK_NEAR((*decayed)->val.value(0), 0.899, 1e-6);
+
+    // Several steps with changing gradients against the textbook update
+    const arma::Mat<float> start(3, 4, arma::fill::randn);
+    auto p = Parameter(start);
+
+    arma::Mat<double> w_ref = arma::conv_to<arma::Mat<double>>::from(start);
+    arma::Mat<double> m_ref(3, 4, arma::fill::zeros), v_ref(3, 4, arma::fill::zeros);
+
+    AdamW long_run(0.05f, 0.1f);
+    long_run.build({ p });
+
+    for (size_t t = 1; t <= 10; ++t) {
+        const arma::Mat<float> g(3, 4, arma::fill::randn);
+        (*p)->grad.value = g;
+
+        long_run.step({ p });
+        AdamReference(w_ref, m_ref, v_ref, arma::conv_to<arma::Mat<double>>::from(g), t, 0.05, 0.1);
+    }
+
+    CHECK(tests::MaxDifference((*p)->val.value, arma::conv_to<arma::Mat<float>>::from(w_ref)) < 1e-5f);
+
+    // Building again starts a new run, the first step is bias-corrected from scratch
+    (*w)->val.value.ones();
+    (*w)->grad.value = arma::Mat<float>({ { 0.5f, -2.0f } });
+
+    adam.build({ w });
+    adam.step({ w });
+
+    CHECK_NEAR((*w)->val.value(0), 0.9, 1e-6);
+    CHECK_NEAR((*w)->val.value(1), 1.1, 1e-6);
+}
+
+// f(w) = (w - 3)^2 from w = 0. The first iteration has no curvature pairs, so
+// d = -g = 6 with the step scaled to 1 / |g| = 1/6: w = 1, f = 4, g = -4, which
+// passes both Wolfe conditions. The pair s = 1, y = 2 gives gamma = 1/2 and the
+// second direction 2, a unit step lands on the minimum w = 3.
+void TestLBFGSSteps() {
+    auto w = Parameter(arma::Mat<float>(1, 1, arma::fill::zeros));
+    size_t evaluations = 0;
+
+    auto closure = [&]() {
+        const float value = (*w)->val.value(0);
+        (*w)->grad.value = arma::Mat<float>(1, 1, arma::fill::value(2 * (value - 3)));
+        ++evaluations;
+        return (value - 3) * (value - 3);
+    };
+
+    LBFGS lbfgs(1, 10, 1);
+    lbfgs.build({ w });
+
+    CHECK_NEAR(lbfgs.step({ w }, closure), 9.0, 1e-6);
+    CHECK_NEAR((*w)->val.value(0), 1.0, 1e-6);
+    CHECK(evaluations == 2);
+
+    CHECK_NEAR(lbfgs.step({ w }, closure), 4.0, 1e-6);
+    CHECK_NEAR((*w)->val.value(0), 3.0, 1e-6);
+    CHECK(evaluations == 4);
+
+    // At the minimum the step stops on the gradient tolerance after one evaluation
+    CHECK_NEAR(lbfgs.step({ w }, closure), 0.0, 1e-6);
+    CHECK(evaluations == 5);
+
+    // Without a closure there is nothing to re-evaluate
+    bool thrown = false;
+    try {
+        lbfgs.step({ w });
+    } catch (const std::logic_error&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+// 0.5 w^T A w - b^T w over two parameters, minimum at A w = b
+void TestLBFGSQuadratic() {
+    const size_t n = 6;
+
+    arma::Mat<float> m(n, n, arma::fill::randn);
+    const arma::Mat<float> a = m.t() * m / (float)n + arma::Mat<float>(n, n, arma::fill::eye);
+    const arma::Col<float> b(n, arma::fill::randn);
+
+    auto first = Parameter(arma::Mat<float>(2, 1, arma::fill::zeros));
+    auto second = Parameter(arma::Mat<float>(2, 2, arma::fill::zeros));
+
+    auto closure = [&]() {
+        arma::Col<float> w(n);
+        w.rows(0, 1) = (*first)->val.value;
+        w.rows(2, 5) = arma::reshape((*second)->val.value, 4, 1);
+
+        const arma::Col<float> g = a * w - b;
+        (*first)->grad.value = g.rows(0, 1);
+        (*second)->grad.value = arma::reshape(g.rows(2, 5), 2, 2);
+
+        return 0.5f * arma::dot(w, a * w) - arma::dot(b, w);
+    };
+
+    LBFGS lbfgs;
+    lbfgs.build({ first, second });
+    lbfgs.step({ first, second }, closure);
+
+    const arma::Col<float> solution = arma::solve(a, b);
+
+    CHECK(tests::MaxDifference((*first)->val.value, solution.rows(0, 1)) < 1e-3f);
+    CHECK(tests::MaxDifference((*second)->val.value, arma::reshape(solution.rows(2, 5), 2, 2)) < 1e-3f);
+
+    // Row-sparse parameters are refused
+    auto table = Parameter(arma::Mat<float>(3, 2, arma::fill::zeros));
+    table->expr = make_shared<SparseVariableNode<float>>(Tensor<float>(arma::Mat<float>(3, 2, arma::fill::zeros)));
+
+    bool thrown = false;
+    try {
+        lbfgs.build({ table });
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+int main() {
+    arma::arma_rng::set_seed(23);
+
+    TestAdam();
+    TestLBFGSSteps();
+    TestLBFGSQuadratic();
+
+    return tests::Failures();
+}
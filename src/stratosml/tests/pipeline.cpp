@@ -0,0 +1,235 @@
+#include <stratosml/core.hpp>
+#include <stratosml/tests/check.hpp>
+#include <armadillo>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace stratos;
+using namespace stratos::data;
+using namespace std;
+
+/*
+ * Pipeline: the lock-free queue on its own, its blocking Pop woken by a push
+ * or a stop, then batches of a frame handed
+ * from the producer threads to the trainer over several epochs, and files
+ * streamed through the shuffle buffer.
+ */
+
+void TestQueue() {
+    // Capacity 3 rounds up to 4
+    BoundedQueue<int> queue(3);
+
+    for (int i = 0; i < 4; ++i) CHECK(queue.TryPush(i));
+    CHECK(!queue.TryPush(4));
+    CHECK(queue.GetSize() == 4);
+
+    int value;
+    for (int i = 0; i < 4; ++i) {
+        CHECK(queue.TryPop(value));
+        CHECK(value == i);
+    }
+    CHECK(!queue.TryPop(value));
+
+    // Producers and a consumer at once, every value arrives exactly once
+    const int producers = 4, per_producer = 20000;
+    BoundedQueue<int> shared(64);
+    vector<thread> threads;
+
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p] {
+            for (int i = 0; i < per_producer; ++i) {
+                while (!shared.TryPush(p * per_producer + i)) this_thread::yield();
+            }
+        });
+    }
+
+    vector<int> seen(producers * per_producer, 0);
+    for (int received = 0; received < producers * per_producer;) {
+        if (shared.TryPop(value)) {
+            seen[value]++;
+            received++;
+        }
+    }
+
+    for (auto& t : threads) t.join();
+
+    CHECK(std::all_of(seen.begin(), seen.end(), [](int count) { return count == 1; }));
+}
+
+void TestBlockingPop() {
+    BoundedQueue<int> queue(4);
+    atomic<bool> stop { false };
+
+    // A consumer asleep on the empty queue wakes for a push made long after its spin
+    int value = 0;
+    thread consumer([&] { CHECK(queue.Pop(value)); });
+
+    this_thread::sleep_for(chrono::milliseconds(50));
+    CHECK(queue.TryPush(7));
+    consumer.join();
+    CHECK(value == 7);
+
+    // And for a stop without any value
+    bool popped = true;
+    thread stopped([&] { popped = queue.Pop(value, &stop); });
+
+    this_thread::sleep_for(chrono::milliseconds(50));
+    stop = true;
+    queue.Wake();
+    stopped.join();
+    CHECK(!popped);
+
+    // A queued value is popped even once stopping
+    CHECK(queue.TryPush(8));
+    CHECK(queue.Pop(value, &stop) && value == 8);
+}
+
+void TestEpochs() {
+    const size_t rows = 100;
+
+    DataFrame df;
+    df.AddColumn("x", rows);
+    df.AddColumn("y", rows);
+
+    for (size_t r = 0; r < rows; ++r) {
+        df["x"][r] = (float)r;
+        df["y"][r] = 2.0f * r;
+    }
+
+    Pipeline pipeline(df, { "x" }, { "y" }, 42);
+    pipeline.Shuffle(rows).Batch(16).Prefetch(2).Threads(3);
+
+    for (size_t epoch = 0; epoch < 3; ++epoch) {
+        pipeline.BeginEpoch();
+
+        vector<int> seen(rows, 0);
+        size_t batches = 0, total = 0;
+
+        while (BatchBuffer* batch = pipeline.Next()) {
+            CHECK(batch->rows <= 16);
+            CHECK(batch->x.value.n_rows == batch->rows);
+
+            for (size_t i = 0; i < batch->rows; ++i) {
+                const float x = batch->x.value(i, 0);
+                CHECK(batch->y.value(i, 0) == 2.0f * x);
+                seen[(size_t)x]++;
+            }
+
+            batches++;
+            total += batch->rows;
+            pipeline.Release(batch);
+        }
+
+        // Once the epoch is over Next keeps returning nullptr
+        CHECK(pipeline.Next() == nullptr);
+
+        CHECK(batches == 7);
+        CHECK(total == rows);
+        CHECK(std::all_of(seen.begin(), seen.end(), [](int count) { return count == 1; }));
+    }
+
+    CHECK(pipeline.GetStats().batches == 21);
+
+    // Only batches of the pipeline go back to its pool
+    BatchBuffer foreign;
+    bool thrown = false;
+    try {
+        pipeline.Release(&foreign);
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+// Every row of the file once per epoch, read in chunks smaller than the shuffle buffer
+void TestStreamEpochs(const string& path, size_t rows) {
+    Pipeline pipeline(path, { "x" }, { "y" }, 7, 64, 2);
+    pipeline.Shuffle(100).Batch(32);
+
+    for (size_t epoch = 0; epoch < 2; ++epoch) {
+        pipeline.BeginEpoch();
+
+        vector<int> seen(rows, 0);
+        size_t total = 0, in_order = 0;
+        float previous = -1;
+
+        while (BatchBuffer* batch = pipeline.Next()) {
+            for (size_t i = 0; i < batch->rows; ++i) {
+                const float x = batch->x.value(i, 0);
+                CHECK(batch->y.value(i, 0) == 2.0f * x);
+                seen[(size_t)x]++;
+
+                in_order += x > previous;
+                previous = x;
+            }
+
+            total += batch->rows;
+            pipeline.Release(batch);
+        }
+
+        CHECK(total == rows);
+        CHECK(std::all_of(seen.begin(), seen.end(), [](int count) { return count == 1; }));
+
+        // The buffer shuffles, rows do not come out in file order
+        CHECK(in_order < rows);
+    }
+
+    CHECK(pipeline.GetSize() == rows);
+}
+
+void TestStream() {
+    const size_t rows = 1000;
+    const string csv = (filesystem::temp_directory_path() / "stratos_stream.csv").string();
+    const string binary = (filesystem::temp_directory_path() / "stratos_stream.stratos").string();
+
+    {
+        ofstream out(csv);
+        out << "x,y\n";
+        for (size_t r = 0; r < rows; ++r) out << r << "," << 2 * r << "\n";
+    }
+
+    DataFrame df;
+    CHECK(LoadCSV(csv, df, 1));
+    CHECK(Save(binary, df));
+
+    printf("csv\n");
+    TestStreamEpochs(csv, rows);
+    printf("stratos\n");
+    TestStreamEpochs(binary, rows);
+
+    // Columns are checked against the file, statistics are not known ahead of it
+    bool thrown = false;
+    try {
+        Pipeline missing(csv, { "z" }, { "y" });
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+
+    thrown = false;
+    try {
+        Pipeline stream(csv, { "x" }, { "y" });
+        stream.Scale("x", Scaler::Standart);
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+
+    filesystem::remove(csv);
+    filesystem::remove(binary);
+}
+
+int main() {
+    TestQueue();
+    TestBlockingPop();
+    TestEpochs();
+    TestStream();
+
+    return tests::Failures();
+}
@@ -0,0 +1,126 @@
+#include <stratosml/core.hpp>
+#include <stratosml/tests/check.hpp>
+#include <armadillo>
+#include <cmath>
+#include <functional>
+#include <vector>
+
+using namespace stratos;
+using namespace stratos::autodiff;
+using namespace std;
+
+/*
+ * LSTM and GRU nodes: every gradient of the input and the weights against
+ * central finite differences of sum(out % g), with and without sequence
+ * outputs, and truncated backpropagation keeping the forward pass unchanged.
+ */
+
+const size_t n = 3, features = 3, units = 2, steps = 4;
+
+// Node from the input and the weights, in the order of its inputs
+using Cell = function<NodePtr<float>(const vector<NodePtr<float>>&)>;
+
+double Objective(const Cell& cell, const vector<arma::Mat<float>>& values, const arma::Mat<float>& grad) {
+    vector<NodePtr<float>> nodes;
+    for (const auto& value : values) nodes.push_back(constant(Tensor<float>(value)).expr);
+
+    return arma::accu(arma::conv_to<arma::Mat<double>>::from(cell(nodes)->val.value % grad));
+}
+
+void TestGradients(const Cell& cell, vector<arma::Mat<float>> values, size_t out_cols, const char* name) {
+    const arma::Mat<float> grad(n, out_cols, arma::fill::randn);
+
+    vector<var> params;
+    vector<NodePtr<float>> nodes;
+    for (const auto& value : values) {
+        params.emplace_back(Tensor<float>(value));
+        nodes.push_back(params.back().expr);
+    }
+
+    NodePtr<float> out = cell(nodes);
+    CHECK(out->val.value.n_rows == n && out->val.value.n_cols == out_cols);
+    out->derive(Tensor<float>(grad));
+
+    printf("%s\n", name);
+
+    const float eps = 1e-2f;
+
+    for (size_t p = 0; p < values.size(); ++p) {
+        double worst = 0;
+
+        for (size_t i = 0; i < values[p].n_elem; ++i) {
+            const float original = values[p](i);
+
+            values[p](i) = original + eps;
+            const double up = Objective(cell, values, grad);
+            values[p](i) = original - eps;
+            const double down = Objective(cell, values, grad);
+            values[p](i) = original;
+
+            const double numeric = (up - down) / (2.0 * eps);
+            const double analytic = params[p]->grad.value(i);
+            worst = std::max(worst, std::abs(numeric - analytic) / std::max(1.0, std::abs(numeric)));
+        }
+
+        CHECK(worst < 2e-3);
+    }
+}
+
+vector<arma::Mat<float>> Weights(size_t gates, bool recurrent_bias) {
+    vector<arma::Mat<float>> values = {
+        arma::Mat<float>(n, steps * features, arma::fill::randn),
+        arma::Mat<float>(features, gates * units, arma::fill::randn) * 0.5f,
+        arma::Mat<float>(units, gates * units, arma::fill::randn) * 0.5f,
+        arma::Mat<float>(gates * units, 1, arma::fill::randn) * 0.5f,
+    };
+
+    if (recurrent_bias) values.push_back(arma::Mat<float>(gates * units, 1, arma::fill::randn) * 0.5f);
+    return values;
+}
+
+Cell LSTMCell(size_t bptt, bool sequences) {
+    return [=](const vector<NodePtr<float>>& v) { return lstm(v[0], v[1], v[2], v[3], steps, bptt, sequences); };
+}
+
+Cell GRUCell(size_t bptt, bool sequences) {
+    return [=](const vector<NodePtr<float>>& v) { return gru(v[0], v[1], v[2], v[3], v[4], steps, bptt, sequences); };
+}
+
+// Chunks of 2 steps compute the same states, only the last chunk of a
+// last-step output gets gradients
+void TestTruncation() {
+    const vector<arma::Mat<float>> values = Weights(4, false);
+    const arma::Mat<float> grad(n, units, arma::fill::randn);
+
+    vector<var> params;
+    vector<NodePtr<float>> nodes;
+    for (const auto& value : values) {
+        params.emplace_back(Tensor<float>(value));
+        nodes.push_back(params.back().expr);
+    }
+
+    NodePtr<float> full = LSTMCell(0, true)(nodes);
+    NodePtr<float> chunked = LSTMCell(2, true)(nodes);
+    CHECK(tests::MaxDifference(full->val.value, chunked->val.value) < 1e-6f);
+
+    NodePtr<float> last = LSTMCell(2, false)(nodes);
+    CHECK(tests::MaxDifference(last->val.value, full->val.value.cols((steps - 1) * units, steps * units - 1)) < 1e-6f);
+
+    last->derive(Tensor<float>(grad));
+    const arma::Mat<float>& dx = params[0]->grad.value;
+
+    CHECK(arma::accu(arma::abs(dx.cols(0, 2 * features - 1))) == 0);
+    CHECK(arma::accu(arma::abs(dx.cols(2 * features, steps * features - 1))) > 0);
+}
+
+int main() {
+    arma::arma_rng::set_seed(13);
+
+    TestGradients(LSTMCell(0, false), Weights(4, false), units, "LSTM");
+    TestGradients(LSTMCell(0, true), Weights(4, false), steps * units, "LSTM sequences");
+    TestGradients(GRUCell(0, false), Weights(3, true), units, "GRU");
+    TestGradients(GRUCell(0, true), Weights(3, true), steps * units, "GRU sequences");
+    TestTruncation();
+
+    return tests::Failures();
+}
@@ -0,0 +1,176 @@
+#include <stratosml/core.hpp>
+#include <stratosml/tests/check.hpp>
+#include <armadillo>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+using namespace stratos;
+using namespace stratos::data;
+using namespace std;
+
+/*
+ * ColumnScaler: fitted shift and divisor of every scaler kind, transforms of
+ * frames and matrices with the training statistics, and the saved text file
+ * loading back to the same parameters.
+ */
+
+// a = 0, 1, ... 9 and b = -4, -2, ... 14
+void Fill(DataFrame& df) {
+    df.AddColumn("a", 10);
+    df.AddColumn("b", 10);
+
+    for (size_t r = 0; r < 10; ++r) {
+        df["a"][r] = (float)r;
+        df["b"][r] = 2.0f * r - 4.0f;
+    }
+}
+
+void TestParams() {
+    DataFrame df;
+    Fill(df);
+
+    // Sample variance of 0..9 is 55 / 6
+    const double a_std = std::sqrt(55.0 / 6.0);
+
+    ColumnScaler standard(Scaler::Standart);
+    standard.Fit(df);
+    CHECK(standard.GetColumns() == vector<string>({ "a", "b" }));
+    CHECK_NEAR(standard.GetParams("a").first, 4.5, 1e-6);
+    CHECK_NEAR(standard.GetParams("a").second, a_std, 1e-5);
+    CHECK_NEAR(standard.GetParams("b").first, 5.0, 1e-6);
+    CHECK_NEAR(standard.GetParams("b").second, 2 * a_std, 1e-5);
+
+    ColumnScaler min_max(Scaler::MinMax);
+    min_max.Fit(df, { "b" });
+    CHECK(!min_max.HasColumn("a"));
+    CHECK(min_max.GetParams("b") == make_pair(-4.0f, 18.0f));
+
+    ColumnScaler max_abs(Scaler::MaxAbs);
+    max_abs.Fit(df);
+    CHECK(max_abs.GetParams("a") == make_pair(0.0f, 9.0f));
+    CHECK(max_abs.GetParams("b") == make_pair(0.0f, 14.0f));
+
+    ColumnScaler mean(Scaler::Mean);
+    mean.Fit(df);
+    CHECK(mean.GetParams("a") == make_pair(4.5f, 9.0f));
+
+    bool thrown = false;
+    try {
+        min_max.GetParams("a");
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+void TestTransform() {
+    DataFrame train, test;
+    Fill(train);
+    Fill(test);
+
+    ColumnScaler scaler(Scaler::MinMax);
+    scaler.FitTransform(train);
+
+    for (size_t r = 0; r < 10; ++r) {
+        CHECK_NEAR(train["a"][r], r / 9.0, 1e-6);
+        CHECK_NEAR(train["b"][r], r / 9.0, 1e-6);
+    }
+
+    // Other data is scaled with the training statistics, not its own
+    test["a"][0] = 18.0f;
+    scaler.Transform(test);
+    CHECK_NEAR(test["a"][0], 2.0, 1e-6);
+    CHECK_NEAR(test["b"][9], 1.0, 1e-6);
+
+    // A matrix of the fitted columns in fit order, e.g. an input to Predict
+    DataFrame raw;
+    Fill(raw);
+
+    Tensor<float> x = raw.Select({ "a", "b" });
+    scaler.Transform(x);
+    CHECK(tests::MaxDifference(x.value, train.Select({ "a", "b" }).value) < 1e-6f);
+
+    Tensor<float> wrong = raw.Select({ "a" });
+    bool thrown = false;
+    try {
+        scaler.Transform(wrong);
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+
+    // A frame without a fitted column
+    DataFrame missing;
+    missing.AddColumn("a", 10);
+
+    thrown = false;
+    try {
+        scaler.Transform(missing);
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+// Statistics of the training rows only
+void TestFitView() {
+    DataFrame df;
+    Fill(df);
+
+    auto [train, test] = Split(df, 0.5f, 3);
+
+    ColumnScaler scaler(Scaler::MinMax);
+    scaler.Fit(train, { "a" });
+
+    float low = INFINITY, high = -INFINITY;
+    for (size_t i = 0; i < train.GetSize(); ++i) {
+        low = std::min(low, df["a"][train[i]]);
+        high = std::max(high, df["a"][train[i]]);
+    }
+
+    CHECK(scaler.GetParams("a") == make_pair(low, high - low));
+}
+
+void TestSaveLoad() {
+    DataFrame df;
+    Fill(df);
+    df.AddColumn("name with \"quotes\" and spaces", 10);
+    for (size_t r = 0; r < 10; ++r) df["name with \"quotes\" and spaces"][r] = 0.1f * r * r;
+
+    const string path = (filesystem::temp_directory_path() / "stratos_scaler.txt").string();
+
+    ColumnScaler scaler(Scaler::Standart);
+    scaler.Fit(df);
+    CHECK(scaler.Save(path));
+
+    ColumnScaler loaded;
+    CHECK(loaded.Load(path));
+    CHECK(loaded.GetColumns() == scaler.GetColumns());
+
+    for (const string& col : scaler.GetColumns()) {
+        CHECK(loaded.GetParams(col) == scaler.GetParams(col));
+    }
+
+    // Not a scaler file, the loaded scaler is left as it was
+    {
+        ofstream out(path);
+        out << "a,b\n1,2\n";
+    }
+
+    CHECK(!loaded.Load(path));
+    CHECK(loaded.GetColumns() == scaler.GetColumns());
+
+    filesystem::remove(path);
+}
+
+int main() {
+    TestParams();
+    TestTransform();
+    TestFitView();
+    TestSaveLoad();
+
+    return tests::Failures();
+}
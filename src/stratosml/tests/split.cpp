@@ -0,0 +1,172 @@
+#include <stratosml/core.hpp>
+#include <stratosml/tests/check.hpp>
+#include <armadillo>
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+using namespace stratos;
+using namespace stratos::data;
+using namespace std;
+
+/*
+ * Split and KFold: train and test views that are disjoint and cover every
+ * row, stratification keeping the class ratios, and views reading the
+ * frame's values at their rows.
+ */
+
+const size_t rows = 103;
+
+// x = row, label 0 for 60 rows, 1 for 30 and 2 for 13, interleaved
+void Fill(DataFrame& df) {
+    df.AddColumn("x", rows);
+    df.AddColumn("label", rows);
+
+    for (size_t r = 0; r < rows; ++r) {
+        df["x"][r] = (float)r;
+        df["label"][r] = r < 90 ? (float)(r % 3 == 0) : 2.0f;
+    }
+}
+
+// Whether the views' rows are disjoint and together are every row of the frame
+bool Partition(const vector<RowView>& views) {
+    vector<int> seen(rows, 0);
+
+    for (const RowView& view : views) {
+        for (size_t row : view.GetRows()) {
+            if (row >= rows) return false;
+            seen[row]++;
+        }
+    }
+
+    return std::all_of(seen.begin(), seen.end(), [](int count) { return count == 1; });
+}
+
+vector<size_t> ClassCounts(const DataFrame& df, const RowView& view) {
+    vector<size_t> counts(3, 0);
+    for (size_t row : view.GetRows()) counts[(size_t)df["label"][row]]++;
+    return counts;
+}
+
+void TestSplit() {
+    DataFrame df;
+    Fill(df);
+
+    auto [train, test] = Split(df, 0.25f, 5);
+
+    // 25.75 test rows round to 26
+    CHECK(test.GetSize() == 26 && train.GetSize() == 77);
+    CHECK(Partition({ train, test }));
+
+    // The same seed gives the same views
+    auto [train_again, test_again] = Split(df, 0.25f, 5);
+    CHECK(train_again.GetRows() == train.GetRows() && test_again.GetRows() == test.GetRows());
+
+    // Views read the frame at their rows
+    const vector<size_t> test_rows = test.GetRows();
+    const Tensor<float> x = test.Select({ "x", "label" });
+
+    bool matches = x.value.n_rows == test_rows.size();
+    for (size_t i = 0; matches && i < test_rows.size(); ++i) {
+        matches = x.value(i, 0) == (float)test_rows[i] && x.value(i, 1) == df["label"][test_rows[i]] && test[i] == test_rows[i];
+    }
+    CHECK(matches);
+
+    const Tensor<float> batch = train.Batch({ "x" }, 70, 10);
+    CHECK(batch.value.n_rows == 7 && batch.value(0, 0) == (float)train[70]);
+
+    // Without shuffling the rows keep frame order
+    auto [first, last] = Split(df, 0.25f, 5, false);
+    const vector<size_t> first_rows = first.GetRows(), last_rows = last.GetRows();
+    CHECK(std::is_sorted(first_rows.begin(), first_rows.end()) && std::is_sorted(last_rows.begin(), last_rows.end()));
+    CHECK(first_rows.back() < last_rows.front());
+
+    bool thrown = false;
+    try {
+        Split(df, 1.0f);
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+void TestStratifiedSplit() {
+    DataFrame df;
+    Fill(df);
+
+    auto [train, test] = Split(df, 0.2f, 9, true, "label");
+    CHECK(Partition({ train, test }));
+
+    // 20% of every class: 12 of 60, 6 of 30 and 2.6 of 13 rounded to 3
+    CHECK(ClassCounts(df, test) == vector<size_t>({ 12, 6, 3 }));
+    CHECK(ClassCounts(df, train) == vector<size_t>({ 48, 24, 10 }));
+}
+
+void TestKFold() {
+    DataFrame df;
+    Fill(df);
+
+    KFold folds(df, 5, 11);
+    CHECK(folds.GetFolds() == 5);
+
+    vector<RowView> test_folds;
+    for (size_t k = 0; k < 5; ++k) {
+        RowView train = folds.Train(k), test = folds.Test(k);
+
+        // 103 rows are folds of 21, 21, 21, 20 and 20
+        CHECK(test.GetSize() == (k < 3 ? 21u : 20u));
+        CHECK(train.GetSize() + test.GetSize() == rows);
+        CHECK(Partition({ train, test }));
+
+        test_folds.push_back(test);
+    }
+
+    // Every row is in exactly one test fold
+    CHECK(Partition(test_folds));
+
+    bool thrown = false;
+    try {
+        folds.Test(5);
+    } catch (const std::out_of_range&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+
+    thrown = false;
+    try {
+        KFold(df, 1);
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+void TestStratifiedKFold() {
+    DataFrame df;
+    Fill(df);
+
+    KFold folds(df, 4, 13, true, "label");
+
+    vector<RowView> test_folds;
+    for (size_t k = 0; k < 4; ++k) test_folds.push_back(folds.Test(k));
+    CHECK(Partition(test_folds));
+
+    // Classes of 60, 30 and 13 rows dealt over 4 folds, at most one row apart
+    const vector<double> expected = { 15.0, 7.5, 3.25 };
+
+    bool balanced = true;
+    for (const RowView& test : test_folds) {
+        const vector<size_t> counts = ClassCounts(df, test);
+        for (size_t c = 0; c < 3; ++c) balanced = balanced && std::abs(counts[c] - expected[c]) < 1.0;
+    }
+    CHECK(balanced);
+}
+
+int main() {
+    TestSplit();
+    TestStratifiedSplit();
+    TestKFold();
+    TestStratifiedKFold();
+
+    return tests::Failures();
+}